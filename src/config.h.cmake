@@ -94,6 +94,9 @@
 /* Define if NSM support is available. */
 #cmakedefine CONFIG_NSM @CONFIG_NSM@
 
+/* Define if audio thread trace recorder is enabled. */
+#cmakedefine CONFIG_TRACE @CONFIG_TRACE@
+
 /* Define if Wayland is supported */
 #cmakedefine CONFIG_WAYLAND @CONFIG_WAYLAND@
 
@@ -38,6 +38,8 @@
 #include "drumkv1_controls.h"
 #include "drumkv1_programs.h"
 #include "drumkv1_tuning.h"
+#include "drumkv1_load.h"
+#include "drumkv1_trace.h"
 
 #include "drumkv1_sched.h"
 
@@ -48,6 +50,18 @@
 
 #include <cstring>
 
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <chrono>
+
+
+//-------------------------------------------------------------------------
+// drumkv1_fx_tail - Silence and tail detector (not busy by default).
+//
+
+bool drumkv1_fx_tail::g_busy = false;
+
 
 //-------------------------------------------------------------------------
 // drumkv1_impl
@@ -118,6 +132,19 @@ inline float drumkv1_sigmoid_1 ( const float x, const float t0 = 0.01f )
 }
 
 
+// soft-clip limiter (block)
+
+inline void drumkv1_limiter ( float *buf, uint32_t nframes )
+{
+	// saturate where the sigmoid approximation peaks (|2x| = 3);
+	// branch-free, so that the compiler may vectorize it.
+	for (uint32_t n = 0; n < nframes; ++n) {
+		const float x = buf[n];
+		buf[n] = drumkv1_sigmoid(x < -1.5f ? -1.5f : (x > 1.5f ? 1.5f : x));
+	}
+}
+
+
 // velocity hard-split curve
 
 inline float drumkv1_velocity ( const float x, const float p = 0.2f )
@@ -462,6 +489,9 @@ public:
 			offset_1(this, drumkv1::GEN1_OFFSET_1),
 			offset_2(this, drumkv1::GEN1_OFFSET_2) {}
 
+	~drumkv1_gen()
+		{ sync_drain(); }
+
 	drumkv1_port  sample;
 	drumkv1_port3 reverse;
 	drumkv1_port3 offset;
@@ -964,6 +994,9 @@ public:
 		: drumkv1_sched(pDrumk, MidiIn),
 			m_enabled(false), m_count(0) {}
 
+	~drumkv1_midi_in ()
+		{ sync_drain(); }
+
 	void schedule_event()
 		{ if (m_enabled && ++m_count < 2) schedule(-1); }
 	void schedule_note(int key, int vel)
@@ -988,6 +1021,48 @@ private:
 };
 
 
+// effects lazy allocation (worker/schedule)
+
+class drumkv1_impl;
+
+class drumkv1_fx_sched : public drumkv1_sched
+{
+public:
+
+	drumkv1_fx_sched (drumkv1 *pDrumk, drumkv1_impl *pImpl)
+		: drumkv1_sched(pDrumk, Effects), m_pImpl(pImpl) {}
+
+	~drumkv1_fx_sched ()
+		{ sync_drain(); }
+
+	void process(int);
+
+private:
+
+	drumkv1_impl *m_pImpl;
+};
+
+
+// staged element set disposal (worker/schedule)
+
+class drumkv1_kit_sched : public drumkv1_sched
+{
+public:
+
+	drumkv1_kit_sched (drumkv1 *pDrumk, drumkv1_impl *pImpl)
+		: drumkv1_sched(pDrumk, Elements), m_pImpl(pImpl) {}
+
+	~drumkv1_kit_sched ()
+		{ sync_drain(); }
+
+	void process(int);
+
+private:
+
+	drumkv1_impl *m_pImpl;
+};
+
+
 // micro-tuning/instance implementation
 
 class drumkv1_tun
@@ -999,11 +1074,74 @@ public:
 	bool    enabled;
 	float   refPitch;
 	int     refNote;
-	QString scaleFile;
-	QString keyMapFile;
+
+	// file names, kept UTF-8 encoded (getters hand out their data).
+	QByteArray scaleFile;
+	QByteArray keyMapFile;
 };
 
 
+// staged element set (off-thread program changes)
+
+class drumkv1_kit
+{
+public:
+
+	drumkv1_kit(const drumkv1_impl *pImpl, float fSampleRate, const drumkv1_tun& tuning)
+		: impl(pImpl), srate(fSampleRate), tun(tuning), hold(false), next(nullptr)
+	{
+		for (int note = 0; note < MAX_NOTES; ++note)
+			elems[note] = nullptr;
+		for (uint32_t i = 0; i < drumkv1::NUM_PARAMS; ++i)
+			params_set[i] = false;
+	}
+
+	~drumkv1_kit() { clear(); }
+
+	void clear()
+	{
+		for (int note = 0; note < MAX_NOTES; ++note)
+			elems[note] = nullptr;
+		drumkv1_elem *elem = elem_list.next();
+		while (elem) {
+			elem_list.remove(elem);
+			delete elem;
+			elem = elem_list.next();
+		}
+	}
+
+	bool owns ( const drumkv1_elem *elem ) const
+	{
+		const int key = int(elem->gen1.sample0);
+		return (key >= 0 && key < MAX_NOTES && elems[key] == elem);
+	}
+
+	const drumkv1_impl *impl;
+
+	float srate;
+
+	drumkv1_elem *elems[MAX_NOTES];
+
+	drumkv1_list<drumkv1_elem> elem_list;
+
+	float params[drumkv1::NUM_PARAMS];
+	bool  params_set[drumkv1::NUM_PARAMS];
+
+	drumkv1_tun tun;
+
+	float freqs[MAX_NOTES];
+
+	bool hold;
+
+	drumkv1_kit *next; // retired chain.
+};
+
+
+// staged element set being prepared, per loader thread.
+
+static thread_local drumkv1_kit *g_kit_staged = nullptr;
+
+
 // drum-kit sampler implementation
 
 class drumkv1_impl
@@ -1035,6 +1173,14 @@ public:
 
 	void clearElements();
 
+	void beginElements();
+	void commitElements(bool bHold);
+
+	drumkv1_kit *takeElements();
+	bool adoptElements(drumkv1_kit *kit, bool bHold);
+	void freeElements(drumkv1_kit *kit);
+	uint64_t elementsMemory(const drumkv1_kit *kit) const;
+
 	void setSampleFile(const char *pszSampleFile);
 	const char *sampleFile() const;
 
@@ -1061,6 +1207,7 @@ public:
 
 	drumkv1_controls *controls();
 	drumkv1_programs *programs();
+	drumkv1_load     *load();
 
 	void setTuningEnabled(bool enabled);
 	bool isTuningEnabled() const;
@@ -1103,6 +1250,52 @@ public:
 
 	bool running(bool on);
 
+	void setActive(bool bActive);
+	bool isActive() const;
+
+	// effect units (lazy allocation).
+	enum FxUnit {
+		FxChorus  = (1 << 0),
+		FxFlanger = (1 << 1),
+		FxPhaser  = (1 << 2),
+		FxDelay   = (1 << 3),
+		FxReverb  = (1 << 4),
+		FxComp    = (1 << 5)
+	};
+
+	uint32_t fx_active();
+	void fx_request(uint32_t units);
+	void fx_alloc(uint32_t units);
+	void fx_free();
+	bool fx_idle() const;
+
+	uint32_t fx_pending() const
+		{ return m_fx_pending.load(); }
+
+	// stereo-pair effect units (flanger, phaser, delay).
+	uint16_t fx_pairs() const
+		{ return (m_nchannels + 1) >> 1; }
+
+	void memoryUsage(drumkv1::MemoryUsage& mem) const;
+
+	// runtime counters.
+	enum Count {
+
+		CountAllocFailures = 0,
+		CountChokeCuts,
+		CountFastReleases,
+		CountControllers,
+		CountFiltered,
+
+		NumCounts
+	};
+
+	void counters(drumkv1::Counters& counters) const;
+	void resetCounters();
+
+	// staged element set disposal (worker/non-realtime thread).
+	void kit_free();
+
 protected:
 
 	void allSoundOff();
@@ -1123,10 +1316,15 @@ protected:
 		if (elem) {
 			pv = m_free_list.next();
 			if (pv) {
+				DRUMKV1_TRACE_EVENT("alloc_voice", key);
 				pv->reset(elem);
 				m_free_list.remove(pv);
 				m_play_list.append(pv);
 				++m_nvoices;
+				count_voices();
+			} else {
+				DRUMKV1_TRACE_EVENT("alloc_voice_failed", key);
+				count(CountAllocFailures);
 			}
 		}
 		return pv;
@@ -1134,6 +1332,7 @@ protected:
 
 	void free_voice ( drumkv1_voice *pv )
 	{
+		DRUMKV1_TRACE_EVENT("free_voice", pv->note);
 		m_play_list.remove(pv);
 		m_free_list.append(pv);
 		pv->reset(0);
@@ -1142,6 +1341,48 @@ protected:
 
 	void alloc_sfxs(uint32_t nsize);
 
+	// runtime counters (audio thread, single writer).
+	void count ( Count index )
+	{
+		std::atomic<uint32_t>& counter = m_counts[index];
+		counter.store(counter.load(std::memory_order_relaxed) + 1,
+			std::memory_order_relaxed);
+	}
+
+	void count_voices ()
+	{
+		const uint32_t nvoices = m_nvoices;
+		if (m_peak_voices.load(std::memory_order_relaxed) < nvoices)
+			m_peak_voices.store(nvoices, std::memory_order_relaxed);
+	}
+
+	// staged element set on this (loader) thread, if any.
+	drumkv1_kit *kit_staged() const
+	{
+		drumkv1_kit *kit = g_kit_staged;
+		return (kit && kit->impl == this ? kit : nullptr);
+	}
+
+	// current or staged micro-tuning state.
+	drumkv1_tun& tun()
+	{
+		drumkv1_kit *kit = kit_staged();
+		return (kit ? kit->tun : m_tun);
+	}
+
+	const drumkv1_tun& tun() const
+	{
+		const drumkv1_kit *kit = kit_staged();
+		return (kit ? kit->tun : m_tun);
+	}
+
+	// staged element set swap (audio thread).
+	void kit_swap(drumkv1_kit *kit);
+	void kit_adopt();
+	void kit_release();
+	void kit_notes_off(drumkv1_kit *kit);
+	bool kit_playing(drumkv1_kit *kit) const;
+
 private:
 
 	drumkv1 *m_pDrumk;
@@ -1149,9 +1390,13 @@ private:
 	drumkv1_config   m_config;
 	drumkv1_controls m_controls;
 	drumkv1_programs m_programs;
+	drumkv1_load     m_load;
 	drumkv1_midi_in  m_midi_in;
 	drumkv1_tun      m_tun;
 
+	// guards current micro-tuning state (non-RT only).
+	mutable std::mutex m_tun_mutex;
+
 	uint16_t m_nchannels;
 	float    m_srate;
 	float    m_bpm;
@@ -1191,13 +1436,32 @@ private:
 	float  **m_sfxs;
 	uint32_t m_nsize;
 
-	drumkv1_fx_chorus   m_chorus;
-	drumkv1_fx_flanger *m_flanger;
-	drumkv1_fx_phaser  *m_phaser;
-	drumkv1_fx_delay   *m_delay;
-	drumkv1_fx_comp    *m_comp;
+	// effect units, allocated on demand and
+	// published to the audio thread atomically.
+	std::atomic<drumkv1_fx_chorus *>  m_chorus;
+	std::atomic<drumkv1_fx_flanger *> m_flanger;
+	std::atomic<drumkv1_fx_phaser *>  m_phaser;
+	std::atomic<drumkv1_fx_delay *>   m_delay;
+	std::atomic<drumkv1_fx_comp *>    m_comp;
+	std::atomic<drumkv1_reverb *>     m_reverb;
+
+	std::atomic<uint32_t> m_fx_pending;
+
+	drumkv1_fx_sched m_fx_sched;
+
+	// staged element set: ready to be adopted (RT),
+	// still ringing (RT) and retired chain (non-RT).
+	std::atomic<drumkv1_kit *> m_kit_pending;
+	drumkv1_kit               *m_kit_held;
+	std::atomic<drumkv1_kit *> m_kit_retired;
+	std::atomic<uint32_t>      m_kit_serial;
 
-	drumkv1_reverb m_reverb;
+	// host processing state (blocks only ever processed while
+	// active) and held by loaders adopting off the audio thread.
+	std::atomic<bool>          m_active;
+	std::atomic<bool>          m_kit_lock;
+
+	drumkv1_kit_sched m_kit_sched;
 
 	// process direct note on/off...
 	volatile uint16_t m_direct_note;
@@ -1208,6 +1472,12 @@ private:
 
 	volatile int  m_nvoices;
 
+	// runtime counters (monotonic) and reset baselines.
+	std::atomic<uint32_t> m_counts[NumCounts];
+	std::atomic<uint32_t> m_counts0[NumCounts];
+	std::atomic<uint32_t> m_overruns0;
+	std::atomic<uint32_t> m_peak_voices;
+
 	volatile bool m_running;
 };
 
@@ -1234,8 +1504,17 @@ drumkv1_voice::drumkv1_voice ( drumkv1_elem *pElem ) :
 drumkv1_impl::drumkv1_impl (
 	drumkv1 *pDrumk, uint16_t nchannels, float srate, uint32_t nsize )
 	: m_pDrumk(pDrumk),	m_controls(pDrumk), m_programs(pDrumk),
-		m_midi_in(pDrumk), m_bpm(180.0f), m_nvoices(0), m_running(false)
+		m_midi_in(pDrumk), m_bpm(180.0f), m_chorus(nullptr), m_flanger(nullptr),
+		m_phaser(nullptr), m_delay(nullptr), m_comp(nullptr), m_reverb(nullptr),
+		m_fx_pending(0), m_fx_sched(pDrumk, this),
+		m_kit_pending(nullptr), m_kit_held(nullptr), m_kit_retired(nullptr),
+		m_kit_serial(0), m_active(false), m_kit_lock(false),
+		m_kit_sched(pDrumk, this), m_nvoices(0),
+		m_overruns0(0), m_peak_voices(0), m_running(false)
 {
+	// trace recorder, if enabled.
+	DRUMKV1_TRACE_OPEN();
+
 	// allocate voice pool.
 	m_voices = new drumkv1_voice * [MAX_VOICES];
 
@@ -1250,6 +1529,12 @@ drumkv1_impl::drumkv1_impl (
 	for (int group = 0; group < MAX_GROUP; ++group)
 		m_group[group] = nullptr;
 
+	// runtime counters
+	for (int i = 0; i < NumCounts; ++i) {
+		m_counts[i].store(0);
+		m_counts0[i].store(0);
+	}
+
 	// reset all current param ports
 	for (uint32_t i = 0; i < drumkv1::NUM_ELEMENT_PARAMS; ++i)
 		m_params[i] = nullptr;
@@ -1261,21 +1546,20 @@ drumkv1_impl::drumkv1_impl (
 	m_sfxs = nullptr;
 	m_nsize = 0;
 
-	// flangers none yet
-	m_flanger = nullptr;
-
-	// phasers none yet
-	m_phaser = nullptr;
-
-	// delays none yet
-	m_delay = nullptr;
-
-	// compressors none yet
-	m_comp = nullptr;
+	// effects none yet (allocated on demand)
+	m_nchannels = 0;
 
 	// Micro-tuning support, if any...
 	resetTuning();
 
+	// worker/schedule thread pool size.
+	if (m_config.iWorkerThreads > 0)
+		drumkv1_sched::setThreads(m_config.iWorkerThreads);
+
+	// sample resampler quality.
+	drumkv1_sample::setQuality(
+		drumkv1_sample::Quality(m_config.iResamplerQuality));
+
 	// load controllers & programs database...
 	m_config.loadControls(&m_controls);
 	m_config.loadPrograms(&m_programs);
@@ -1310,6 +1594,13 @@ drumkv1_impl::~drumkv1_impl (void)
 	m_config.savePrograms(&m_programs);
 #endif
 
+	// stop prefetching programs (uses this very instance).
+	m_programs.prefetch_clear();
+
+	// let any worker/schedule work of this instance finish,
+	// before tearing down anything it might use...
+	drumkv1_sched::sync_drain_lane(m_pDrumk);
+
 	// deallocate sample filenames
 	setSampleFile(nullptr);
 
@@ -1328,38 +1619,28 @@ drumkv1_impl::~drumkv1_impl (void)
 	// deallocate channels
 	setChannels(0);
 
+	// deallocate staged elements
+	freeElements(kit_staged());
+	delete m_kit_pending.exchange(nullptr);
+	delete m_kit_held;
+	kit_free();
+
 	// deallocate elements
 	clearElements();
+
+	DRUMKV1_TRACE_CLOSE();
 }
 
 
 void drumkv1_impl::setChannels ( uint16_t nchannels )
 {
-	m_nchannels = nchannels;
+	// let any effects allocation still running finish first...
+	drumkv1_sched::sync_drain_lane(m_pDrumk);
 
-	// deallocate flangers
-	if (m_flanger) {
-		delete [] m_flanger;
-		m_flanger = nullptr;
-	}
-
-	// deallocate phasers
-	if (m_phaser) {
-		delete [] m_phaser;
-		m_phaser = nullptr;
-	}
-
-	// deallocate delays
-	if (m_delay) {
-		delete [] m_delay;
-		m_delay = nullptr;
-	}
+	// deallocate effects
+	fx_free();
 
-	// deallocate compressors
-	if (m_comp) {
-		delete [] m_comp;
-		m_comp = nullptr;
-	}
+	m_nchannels = nchannels;
 }
 
 
@@ -1373,6 +1654,8 @@ void drumkv1_impl::setSampleRate ( float srate )
 {
 	// set internal sample rate
 	m_srate = srate;
+
+	m_load.setSampleRate(m_srate);
 }
 
 
@@ -1428,15 +1711,267 @@ void drumkv1_impl::alloc_sfxs ( uint32_t nsize )
 }
 
 
+// effect units currently enabled (ticks the ports)
+uint32_t drumkv1_impl::fx_active (void)
+{
+	uint32_t units = 0;
+
+	if (m_nchannels > 1) {
+		if (*m_cho.wet > 0.0f)
+			units |= FxChorus;
+		if (*m_rev.wet > 0.0f)
+			units |= FxReverb;
+	}
+
+	if (*m_fla.wet > 0.0f)
+		units |= FxFlanger;
+	if (*m_pha.wet > 0.0f)
+		units |= FxPhaser;
+	if (*m_del.wet > 0.0f)
+		units |= FxDelay;
+	if (int(*m_dyn.compress) > 0)
+		units |= FxComp;
+
+	return units;
+}
+
+
+// request effect units allocation (audio thread)
+void drumkv1_impl::fx_request ( uint32_t units )
+{
+	if ((m_fx_pending.load(std::memory_order_relaxed) & units) == units)
+		return;
+
+	const uint32_t pending = m_fx_pending.fetch_or(units);
+	if ((pending & units) != units)
+		m_fx_sched.schedule();
+}
+
+
+// publish a newly allocated effect unit, unless already there
+template <typename T>
+static void drumkv1_fx_publish ( std::atomic<T *>& unit, T *p )
+{
+	T *expected = nullptr;
+	if (!unit.compare_exchange_strong(expected, p,
+			std::memory_order_release, std::memory_order_relaxed))
+		delete [] p;
+}
+
+
+// allocate effect units (worker/non-realtime thread)
+void drumkv1_impl::fx_alloc ( uint32_t units )
+{
+	DRUMKV1_TRACE_SCOPE("fx_alloc", units);
+
+	uint16_t k;
+
+	if ((units & FxChorus) && m_chorus.load() == nullptr) {
+		drumkv1_fx_chorus *chorus = new drumkv1_fx_chorus [1];
+		chorus->setSampleRate(m_srate);
+		chorus->reset();
+		drumkv1_fx_publish(m_chorus, chorus);
+	}
+
+	if ((units & FxFlanger) && m_flanger.load() == nullptr) {
+		drumkv1_fx_flanger *flanger = new drumkv1_fx_flanger [fx_pairs()];
+		for (k = 0; k < fx_pairs(); ++k)
+			flanger[k].reset();
+		drumkv1_fx_publish(m_flanger, flanger);
+	}
+
+	if ((units & FxPhaser) && m_phaser.load() == nullptr) {
+		drumkv1_fx_phaser *phaser = new drumkv1_fx_phaser [fx_pairs()];
+		for (k = 0; k < fx_pairs(); ++k) {
+			phaser[k].setSampleRate(m_srate);
+			phaser[k].reset();
+		}
+		drumkv1_fx_publish(m_phaser, phaser);
+	}
+
+	if ((units & FxDelay) && m_delay.load() == nullptr) {
+		drumkv1_fx_delay *delay = new drumkv1_fx_delay [fx_pairs()];
+		for (k = 0; k < fx_pairs(); ++k) {
+			delay[k].setSampleRate(m_srate);
+			delay[k].reset();
+		}
+		drumkv1_fx_publish(m_delay, delay);
+	}
+
+	if ((units & FxComp) && m_comp.load() == nullptr) {
+		drumkv1_fx_comp *comp = new drumkv1_fx_comp [fx_pairs()];
+		for (k = 0; k < fx_pairs(); ++k) {
+			comp[k].setSampleRate(m_srate);
+			comp[k].reset();
+		}
+		drumkv1_fx_publish(m_comp, comp);
+	}
+
+	if ((units & FxReverb) && m_reverb.load() == nullptr) {
+		drumkv1_reverb *reverb = new drumkv1_reverb [1];
+		reverb->setSampleRate(m_srate);
+		reverb->setMode(m_config.iReverbMode > 0
+			? drumkv1_reverb::Fdn : drumkv1_reverb::Comb);
+		reverb->reset();
+		drumkv1_fx_publish(m_reverb, reverb);
+	}
+}
+
+
+// deallocate all effect units
+void drumkv1_impl::fx_free (void)
+{
+	m_fx_pending.store(0);
+
+	delete [] m_chorus.exchange(nullptr);
+	delete [] m_flanger.exchange(nullptr);
+	delete [] m_phaser.exchange(nullptr);
+	delete [] m_delay.exchange(nullptr);
+	delete [] m_comp.exchange(nullptr);
+	delete [] m_reverb.exchange(nullptr);
+}
+
+
+// whether all effect units are silent (no tails left)
+bool drumkv1_impl::fx_idle (void) const
+{
+	const drumkv1_fx_chorus *chorus = m_chorus.load(std::memory_order_acquire);
+	if (chorus && !chorus->idle())
+		return false;
+
+	const drumkv1_fx_flanger *flanger = m_flanger.load(std::memory_order_acquire);
+	const drumkv1_fx_phaser  *phaser  = m_phaser.load(std::memory_order_acquire);
+	const drumkv1_fx_delay   *delay   = m_delay.load(std::memory_order_acquire);
+	const drumkv1_fx_comp    *comp    = m_comp.load(std::memory_order_acquire);
+	if (int(m_dyn.compress.value()) < 1)
+		comp = nullptr; // disabled, not processed.
+	uint16_t k;
+	for (k = 0; k < fx_pairs(); ++k) {
+		if (flanger && !flanger[k].idle())
+			return false;
+		if (phaser && !phaser[k].idle())
+			return false;
+		if (delay && !delay[k].idle())
+			return false;
+		if (comp && !comp[k].idle())
+			return false;
+	}
+
+	const drumkv1_reverb *reverb = m_reverb.load(std::memory_order_acquire);
+	if (reverb && !reverb->idle())
+		return false;
+
+	return true;
+}
+
+
+// effects lazy allocation (worker/schedule)
+void drumkv1_fx_sched::process ( int )
+{
+	m_pImpl->fx_alloc(m_pImpl->fx_pending());
+}
+
+
+// element list memory usage (bytes)
+static void drumkv1_elems_memory (
+	const drumkv1_list<drumkv1_elem>& elem_list,
+	uint64_t& elements, uint64_t& samples )
+{
+	const drumkv1_elem *elem = elem_list.next();
+	while (elem) {
+		elements += sizeof(drumkv1_elem);
+		const drumkv1_sample& sample = elem->gen1_sample;
+		if (sample.filename()) {
+			samples += uint64_t(sample.channels())
+				* (sample.length() + 4) * sizeof(float);
+		}
+		elem = elem->next();
+	}
+}
+
+
+// per-instance memory usage report
+void drumkv1_impl::memoryUsage ( drumkv1::MemoryUsage& mem ) const
+{
+	mem.voices = MAX_VOICES * sizeof(drumkv1_voice);
+
+	mem.samples = 0;
+	mem.elements = 0;
+	drumkv1_elems_memory(m_elem_list, mem.elements, mem.samples);
+
+	mem.buffers = uint64_t(m_nsize) * m_nchannels * sizeof(float);
+
+	mem.effects = 0;
+	if (m_chorus.load())
+		mem.effects += sizeof(drumkv1_fx_chorus);
+	if (m_flanger.load())
+		mem.effects += fx_pairs() * sizeof(drumkv1_fx_flanger);
+	if (m_phaser.load())
+		mem.effects += fx_pairs() * sizeof(drumkv1_fx_phaser);
+	if (m_delay.load())
+		mem.effects += fx_pairs() * sizeof(drumkv1_fx_delay);
+	if (m_comp.load())
+		mem.effects += fx_pairs() * sizeof(drumkv1_fx_comp);
+	const drumkv1_reverb *reverb = m_reverb.load();
+	if (reverb)
+		mem.effects += sizeof(drumkv1_reverb) + reverb->bufferSize();
+}
+
+
+// runtime counters (since last reset)
+void drumkv1_impl::counters ( drumkv1::Counters& counters ) const
+{
+	uint32_t counts[NumCounts];
+	for (int i = 0; i < NumCounts; ++i) {
+		counts[i] = m_counts[i].load(std::memory_order_relaxed)
+			- m_counts0[i].load(std::memory_order_relaxed);
+	}
+
+	counters.voices = (m_nvoices > 0 ? uint32_t(m_nvoices) : 0);
+	counters.peak_voices = m_peak_voices.load(std::memory_order_relaxed);
+	if (counters.peak_voices < counters.voices)
+		counters.peak_voices = counters.voices;
+
+	counters.alloc_failures = counts[CountAllocFailures];
+	counters.choke_cuts = counts[CountChokeCuts];
+	counters.fast_releases = counts[CountFastReleases];
+	counters.cc_events = counts[CountControllers];
+	counters.filtered = counts[CountFiltered];
+
+	counters.overruns = m_load.overruns()
+		- m_overruns0.load(std::memory_order_relaxed);
+}
+
+
+void drumkv1_impl::resetCounters (void)
+{
+	for (int i = 0; i < NumCounts; ++i) {
+		m_counts0[i].store(m_counts[i].load(std::memory_order_relaxed),
+			std::memory_order_relaxed);
+	}
+
+	m_overruns0.store(m_load.overruns(), std::memory_order_relaxed);
+
+	// peak restarts from the current voice count.
+	m_peak_voices.store(m_nvoices > 0 ? uint32_t(m_nvoices) : 0,
+		std::memory_order_relaxed);
+}
+
+
 drumkv1_element *drumkv1_impl::addElement ( int key )
 {
+	drumkv1_kit *kit = kit_staged();
+	drumkv1_elem **elems = (kit ? kit->elems : m_elems);
+	drumkv1_list<drumkv1_elem>& elem_list
+		= (kit ? kit->elem_list : m_elem_list);
+
 	drumkv1_elem *elem = nullptr;
 	if (key >= 0 && key < MAX_NOTES) {
-		elem = m_elems[key];
+		elem = elems[key];
 		if (elem == nullptr) {
 			elem = new drumkv1_elem(m_pDrumk, m_srate, key);
-			m_elem_list.append(elem);
-			m_elems[key] = elem;
+			elem_list.append(elem);
+			elems[key] = elem;
 		}
 	}
 	return (elem ? &(elem->element) : nullptr);
@@ -1543,6 +2078,13 @@ int drumkv1_impl::currentElementTest (void)
 
 void drumkv1_impl::clearElements (void)
 {
+	// staged element set?
+	drumkv1_kit *kit = kit_staged();
+	if (kit) {
+		kit->clear();
+		return;
+	}
+
 	// reset element map
 	for (int note = 0; note < MAX_NOTES; ++note)
 		m_elems[note] = nullptr;
@@ -1718,6 +2260,14 @@ drumkv1_port *drumkv1_impl::paramPort ( drumkv1::ParamIndex index )
 
 void drumkv1_impl::setParamValue ( drumkv1::ParamIndex index, float fValue )
 {
+	// staged element set?
+	drumkv1_kit *kit = kit_staged();
+	if (kit && index >= drumkv1::NUM_ELEMENT_PARAMS) {
+		kit->params[index] = fValue;
+		kit->params_set[index] = true;
+		return;
+	}
+
 	drumkv1_port *pParamPort = paramPort(index);
 	if (pParamPort)
 		pParamPort->set_value(fValue);
@@ -1735,6 +2285,8 @@ float drumkv1_impl::paramValue ( drumkv1::ParamIndex index )
 
 void drumkv1_impl::process_midi ( uint8_t *data, uint32_t size )
 {
+	DRUMKV1_TRACE_SCOPE("process_midi", size);
+
 	for (uint32_t i = 0; i < size; ++i) {
 
 		// channel status
@@ -1757,13 +2309,19 @@ void drumkv1_impl::process_midi ( uint8_t *data, uint32_t size )
 
 		// program change
 		if (status == 0xc0) {
-			if (on) m_programs.prog_change(key);
+			if (on)
+				m_programs.prog_change(key);
+			else
+				count(CountFiltered);
 			continue;
 		}
 
 		// channel aftertouch
 		if (status == 0xd0) {
-			if (on) m_ctl.pressure = float(key) / 127.0f;
+			if (on)
+				m_ctl.pressure = float(key) / 127.0f;
+			else
+				count(CountFiltered);
 			continue;
 		}
 
@@ -1778,6 +2336,8 @@ void drumkv1_impl::process_midi ( uint8_t *data, uint32_t size )
 		if (!on) {
 			if (status == 0xb0)
 				m_controls.process_enqueue(channel, key, value);
+			else
+				count(CountFiltered);
 			continue;
 		}
 
@@ -1792,6 +2352,7 @@ void drumkv1_impl::process_midi ( uint8_t *data, uint32_t size )
 				elem->dca1.env.note_off_fast(&pv->dca1_env);
 				m_notes[key] = nullptr;
 				pv->note = -1;
+				count(CountFastReleases);
 			}
 			// find free voice
 			pv = alloc_voice(key);
@@ -1865,6 +2426,7 @@ void drumkv1_impl::process_midi ( uint8_t *data, uint32_t size )
 						elem_group->dca1.env.note_off_fast(&pv_group->dca1_env);
 						m_notes[pv_group->note] = nullptr;
 						pv_group->note = -1;
+						count(CountChokeCuts);
 					}
 					m_group[pv->group] = pv;
 				}
@@ -1901,6 +2463,7 @@ void drumkv1_impl::process_midi ( uint8_t *data, uint32_t size )
 		}
 		// control change
 		else if (status == 0xb0) {
+			count(CountControllers);
 		switch (key) {
 			case 0x00:
 				// bank-select MSB (cc#0)
@@ -1966,6 +2529,254 @@ void drumkv1_impl::process_midi ( uint8_t *data, uint32_t size )
 }
 
 
+// staged element set preparation (non-RT)
+
+void drumkv1_impl::beginElements (void)
+{
+	// dispose of any previously retired set...
+	kit_free();
+
+	delete g_kit_staged;
+
+	// may be called from any (loader) thread...
+	const std::lock_guard<std::mutex> lock(m_tun_mutex);
+	g_kit_staged = new drumkv1_kit(this, m_srate, m_tun);
+}
+
+
+drumkv1_kit *drumkv1_impl::takeElements (void)
+{
+	drumkv1_kit *kit = kit_staged();
+	if (kit == nullptr)
+		return nullptr;
+
+	// consolidate tuning for the new set...
+	resetTuning();
+
+	g_kit_staged = nullptr;
+
+	// reset all new elements
+	drumkv1_elem *elem = kit->elem_list.next();
+	while (elem) {
+		resetElement(elem);
+		elem->element.resetParamValues(false);
+		elem = elem->next();
+	}
+
+	return kit;
+}
+
+
+void drumkv1_impl::commitElements ( bool bHold )
+{
+	adoptElements(takeElements(), bHold);
+}
+
+
+bool drumkv1_impl::adoptElements ( drumkv1_kit *kit, bool bHold )
+{
+	if (kit == nullptr)
+		return false;
+
+	// stale (eg. prefetched before a sample rate change)?
+	if (kit->impl != this || kit->srate != m_srate) {
+		freeElements(kit);
+		return false;
+	}
+
+	kit->hold = bHold;
+
+	// micro-tuning state goes along (copied before publishing).
+	{
+		const std::lock_guard<std::mutex> lock(m_tun_mutex);
+		m_tun = kit->tun;
+	}
+
+	// publish to the audio thread, replacing any not yet adopted...
+	delete m_kit_pending.exchange(kit, std::memory_order_acq_rel);
+
+	// not processing: adopt it right here, right now;
+	// otherwise it's adopted at the next block boundary.
+	kit_adopt();
+
+	return true;
+}
+
+
+void drumkv1_impl::freeElements ( drumkv1_kit *kit )
+{
+	if (kit == g_kit_staged)
+		g_kit_staged = nullptr;
+
+	delete kit;
+}
+
+
+uint64_t drumkv1_impl::elementsMemory ( const drumkv1_kit *kit ) const
+{
+	uint64_t elements = 0;
+	uint64_t samples = 0;
+
+	if (kit)
+		drumkv1_elems_memory(kit->elem_list, elements, samples);
+
+	return elements + samples;
+}
+
+
+// staged element set adoption, off the audio thread (non-RT)
+
+void drumkv1_impl::kit_adopt (void)
+{
+	// one loader at a time, never while activating...
+	bool kit_lock = false;
+	while (!m_kit_lock.compare_exchange_weak(kit_lock, true)) {
+		kit_lock = false;
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	// only while no blocks are being processed, at all.
+	if (!m_active.load()) {
+		drumkv1_kit *kit = m_kit_pending.exchange(nullptr, std::memory_order_acq_rel);
+		if (kit) {
+			kit_swap(kit);
+			m_kit_serial.fetch_add(1, std::memory_order_release);
+		}
+	}
+
+	m_kit_lock.store(false);
+}
+
+
+// staged element set swap (RT)
+
+void drumkv1_impl::kit_swap ( drumkv1_kit *kit )
+{
+	DRUMKV1_TRACE_SCOPE("kit_swap", m_kit_serial.load(std::memory_order_relaxed));
+
+	// still ringing from the one before? cut it now.
+	if (m_kit_held) {
+		kit_notes_off(m_kit_held);
+		kit_release();
+	}
+
+	if (!kit->hold)
+		allNotesOff();
+
+	// swap element map and list
+	for (int note = 0; note < MAX_NOTES; ++note) {
+		drumkv1_elem *elem = m_elems[note];
+		m_elems[note] = kit->elems[note];
+		kit->elems[note] = elem;
+	}
+
+	const drumkv1_list<drumkv1_elem> elem_list = m_elem_list;
+	m_elem_list = kit->elem_list;
+	kit->elem_list = elem_list;
+
+	// reset current element
+	m_elem = nullptr;
+	m_key0 = -1;
+	m_key1 = m_key0;
+	m_key->set_value(float(m_key0));
+
+	// global params and tuning
+	for (uint32_t i = drumkv1::NUM_ELEMENT_PARAMS; i < drumkv1::NUM_PARAMS; ++i) {
+		if (!kit->params_set[i])
+			continue;
+		drumkv1_port *pParamPort = paramPort(drumkv1::ParamIndex(i));
+		if (pParamPort)
+			pParamPort->set_value(kit->params[i]);
+	}
+
+	::memcpy(m_freqs, kit->freqs, MAX_NOTES * sizeof(float));
+
+	// old elements now held until their voices are gone...
+	m_kit_held = kit;
+
+	kit_release();
+
+	// tell the world (non-RT)...
+	m_kit_sched.schedule(1);
+}
+
+
+// hand over the held element set for disposal, when silent (RT)
+
+void drumkv1_impl::kit_release (void)
+{
+	drumkv1_kit *kit = m_kit_held;
+	if (kit == nullptr || kit_playing(kit))
+		return;
+
+	m_kit_held = nullptr;
+
+	// push onto the retired chain (lock-free)...
+	kit->next = m_kit_retired.load(std::memory_order_relaxed);
+	while (!m_kit_retired.compare_exchange_weak(kit->next, kit,
+			std::memory_order_release, std::memory_order_relaxed))
+		;
+
+	m_kit_sched.schedule();
+}
+
+
+// cut all voices from a held element set (RT)
+
+void drumkv1_impl::kit_notes_off ( drumkv1_kit *kit )
+{
+	drumkv1_voice *pv = m_play_list.next();
+	while (pv) {
+		drumkv1_voice *pv_next = pv->next();
+		if (kit->owns(pv->elem)) {
+			if (pv->note >= 0 && m_notes[pv->note] == pv)
+				m_notes[pv->note] = nullptr;
+			if (pv->group >= 0 && m_group[pv->group] == pv)
+				m_group[pv->group] = nullptr;
+			free_voice(pv);
+		}
+		pv = pv_next;
+	}
+}
+
+
+// whether any voice still plays from a held element set (RT)
+
+bool drumkv1_impl::kit_playing ( drumkv1_kit *kit ) const
+{
+	drumkv1_voice *pv = m_play_list.next();
+	while (pv) {
+		if (kit->owns(pv->elem))
+			return true;
+		pv = pv->next();
+	}
+	return false;
+}
+
+
+// staged element set disposal (worker/non-realtime thread)
+
+void drumkv1_impl::kit_free (void)
+{
+	drumkv1_kit *kit = m_kit_retired.exchange(nullptr, std::memory_order_acquire);
+	while (kit) {
+		drumkv1_kit *kit_next = kit->next;
+		delete kit;
+		kit = kit_next;
+	}
+}
+
+
+void drumkv1_kit_sched::process ( int sid )
+{
+	m_pImpl->kit_free();
+
+	// a new element set has just been adopted.
+	if (sid > 0)
+		drumkv1_sched::sync_notify(instance(), drumkv1_sched::Sample, 1);
+}
+
+
 // all controllers off
 
 void drumkv1_impl::allControllersOff (void)
@@ -1978,21 +2789,41 @@ void drumkv1_impl::allControllersOff (void)
 
 void drumkv1_impl::allSoundOff (void)
 {
-	m_chorus.setSampleRate(m_srate);
-	m_chorus.reset();
+	drumkv1_fx_chorus *chorus = m_chorus.load(std::memory_order_acquire);
+	if (chorus) {
+		chorus->setSampleRate(m_srate);
+		chorus->reset();
+	}
 
-	for (uint16_t k = 0; k < m_nchannels; ++k) {
-		m_phaser[k].setSampleRate(m_srate);
-		m_delay[k].setSampleRate(m_srate);
-		m_comp[k].setSampleRate(m_srate);
-		m_flanger[k].reset();
-		m_phaser[k].reset();
-		m_delay[k].reset();
-		m_comp[k].reset();
+	drumkv1_fx_flanger *flanger = m_flanger.load(std::memory_order_acquire);
+	drumkv1_fx_phaser  *phaser  = m_phaser.load(std::memory_order_acquire);
+	drumkv1_fx_delay   *delay   = m_delay.load(std::memory_order_acquire);
+	drumkv1_fx_comp    *comp    = m_comp.load(std::memory_order_acquire);
+
+	uint16_t k;
+
+	for (k = 0; k < fx_pairs(); ++k) {
+		if (flanger)
+			flanger[k].reset();
+		if (phaser) {
+			phaser[k].setSampleRate(m_srate);
+			phaser[k].reset();
+		}
+		if (delay) {
+			delay[k].setSampleRate(m_srate);
+			delay[k].reset();
+		}
+		if (comp) {
+			comp[k].setSampleRate(m_srate);
+			comp[k].reset();
+		}
 	}
 
-	m_reverb.setSampleRate(m_srate);
-	m_reverb.reset();
+	drumkv1_reverb *reverb = m_reverb.load(std::memory_order_acquire);
+	if (reverb) {
+		reverb->setSampleRate(m_srate);
+		reverb->reset();
+	}
 }
 
 
@@ -2111,77 +2942,102 @@ drumkv1_programs *drumkv1_impl::programs (void)
 }
 
 
+// load meter accessor
+
+drumkv1_load *drumkv1_impl::load (void)
+{
+	return &m_load;
+}
+
+
 // Micro-tuning support
 
 void drumkv1_impl::setTuningEnabled ( bool enabled )
 {
-	m_tun.enabled = enabled;
+	const std::lock_guard<std::mutex> lock(m_tun_mutex);
+	tun().enabled = enabled;
 }
 
 bool drumkv1_impl::isTuningEnabled (void) const
 {
-	return m_tun.enabled;
+	const std::lock_guard<std::mutex> lock(m_tun_mutex);
+	return tun().enabled;
 }
 
 
 void drumkv1_impl::setTuningRefPitch ( float refPitch )
 {
-	m_tun.refPitch = refPitch;
+	const std::lock_guard<std::mutex> lock(m_tun_mutex);
+	tun().refPitch = refPitch;
 }
 
 float drumkv1_impl::tuningRefPitch (void) const
 {
-	return m_tun.refPitch;
+	const std::lock_guard<std::mutex> lock(m_tun_mutex);
+	return tun().refPitch;
 }
 
 
 void drumkv1_impl::setTuningRefNote ( int refNote )
 {
-	m_tun.refNote = refNote;
+	const std::lock_guard<std::mutex> lock(m_tun_mutex);
+	tun().refNote = refNote;
 }
 
 int drumkv1_impl::tuningRefNote (void) const
 {
-	return m_tun.refNote;
+	const std::lock_guard<std::mutex> lock(m_tun_mutex);
+	return tun().refNote;
 }
 
 
 void drumkv1_impl::setTuningScaleFile ( const char *pszScaleFile )
 {
-	m_tun.scaleFile = QString::fromUtf8(pszScaleFile);
+	const std::lock_guard<std::mutex> lock(m_tun_mutex);
+	tun().scaleFile = QByteArray(pszScaleFile);
 }
 
 const char *drumkv1_impl::tuningScaleFile (void) const
 {
-	return m_tun.scaleFile.toUtf8().constData();
+	const std::lock_guard<std::mutex> lock(m_tun_mutex);
+	return tun().scaleFile.constData();
 }
 
 
 void drumkv1_impl::setTuningKeyMapFile ( const char *pszKeyMapFile )
 {
-	m_tun.keyMapFile = QString::fromUtf8(pszKeyMapFile);
+	const std::lock_guard<std::mutex> lock(m_tun_mutex);
+	tun().keyMapFile = QByteArray(pszKeyMapFile);
 }
 
 const char *drumkv1_impl::tuningKeyMapFile (void) const
 {
-	return m_tun.keyMapFile.toUtf8().constData();
+	const std::lock_guard<std::mutex> lock(m_tun_mutex);
+	return tun().keyMapFile.constData();
 }
 
 
 void drumkv1_impl::resetTuning (void)
 {
-	if (m_tun.enabled) {
+	// staged element set?
+	drumkv1_kit *kit = kit_staged();
+	float *freqs = (kit ? kit->freqs : m_freqs);
+
+	const std::lock_guard<std::mutex> lock(m_tun_mutex);
+	const drumkv1_tun& tun = (kit ? kit->tun : m_tun);
+
+	if (tun.enabled) {
 		// Instance micro-tuning, possibly from Scala keymap and scale files...
 		drumkv1_tuning tuning(
-			m_tun.refPitch,
-			m_tun.refNote);
-		if (m_tun.keyMapFile.isEmpty())
-		if (!m_tun.keyMapFile.isEmpty())
-			tuning.loadKeyMapFile(m_tun.keyMapFile);
-		if (!m_tun.scaleFile.isEmpty())
-			tuning.loadScaleFile(m_tun.scaleFile);
+			tun.refPitch,
+			tun.refNote);
+		if (tun.keyMapFile.isEmpty())
+		if (!tun.keyMapFile.isEmpty())
+			tuning.loadKeyMapFile(QString::fromUtf8(tun.keyMapFile));
+		if (!tun.scaleFile.isEmpty())
+			tuning.loadScaleFile(QString::fromUtf8(tun.scaleFile));
 		for (int note = 0; note < MAX_NOTES; ++note)
-			m_freqs[note] = tuning.noteToPitch(note);
+			freqs[note] = tuning.noteToPitch(note);
 		// Done instance tuning.
 	}
 	else
@@ -2195,12 +3051,12 @@ void drumkv1_impl::resetTuning (void)
 		if (!m_config.sTuningScaleFile.isEmpty())
 			tuning.loadScaleFile(m_config.sTuningScaleFile);
 		for (int note = 0; note < MAX_NOTES; ++note)
-			m_freqs[note] = tuning.noteToPitch(note);
+			freqs[note] = tuning.noteToPitch(note);
 		// Done global/config tuning.
 	} else {
 		// Native/default tuning, 12-tone equal temperament western standard...
 		for (int note = 0; note < MAX_NOTES; ++note)
-			m_freqs[note] = drumkv1_freq(note);
+			freqs[note] = drumkv1_freq(note);
 		// Done native/default tuning.
 	}
 }
@@ -2230,24 +3086,8 @@ void drumkv1_impl::reset (void)
 		elem = elem->next();
 	}
 
-	// flangers
-	if (m_flanger == nullptr)
-		m_flanger = new drumkv1_fx_flanger [m_nchannels];
-
-	// phasers
-	if (m_phaser == nullptr)
-		m_phaser = new drumkv1_fx_phaser [m_nchannels];
-
-	// delays
-	if (m_delay == nullptr)
-		m_delay = new drumkv1_fx_delay [m_nchannels];
-
-	// compressors
-	if (m_comp == nullptr)
-		m_comp = new drumkv1_fx_comp [m_nchannels];
-
-	// reverbs
-	m_reverb.reset();
+	// effects (only the ones currently enabled)
+	fx_alloc(fx_active());
 
 	// controllers reset.
 	m_controls.reset();
@@ -2277,18 +3117,50 @@ void drumkv1_impl::process ( float **ins, float **outs, uint32_t nframes )
 {
 	if (!m_running) return;
 
+	DRUMKV1_TRACE_SCOPE("process", nframes);
+
+	uint16_t k;
+
+	// host block exceeds the preallocated maximum:
+	// process in chunks, never reallocate here...
+	if (nframes > m_nsize) {
+		if (m_nsize < 1)
+			return;
+		float *ins1[m_nchannels];
+		float *outs1[m_nchannels];
+		for (k = 0; k < m_nchannels; ++k) {
+			ins1[k]  = ins[k];
+			outs1[k] = outs[k];
+		}
+		while (nframes > 0) {
+			const uint32_t nchunk = (nframes < m_nsize ? nframes : m_nsize);
+			process(ins1, outs1, nchunk);
+			for (k = 0; k < m_nchannels; ++k) {
+				ins1[k]  += nchunk;
+				outs1[k] += nchunk;
+			}
+			nframes -= nchunk;
+		}
+		return;
+	}
+
 	float *v_outs[m_nchannels];
 	float *v_sfxs[m_nchannels];
 
-	// FIXME: fx-send buffer reallocation... seriously?
-	if (m_nsize < nframes) alloc_sfxs(nframes);
-
-	uint16_t k;
+	// adopt a newly staged element set, at the block boundary...
+	if (m_kit_pending.load(std::memory_order_relaxed)) {
+		drumkv1_kit *kit = m_kit_pending.exchange(nullptr, std::memory_order_acq_rel);
+		if (kit) {
+			kit_swap(kit);
+			m_kit_serial.fetch_add(1, std::memory_order_release);
+		}
+	}
+	else
+	if (m_kit_held)
+		kit_release();
 
-	for (k = 0; k < m_nchannels; ++k) {
-		::memset(m_sfxs[k], 0, nframes * sizeof(float));
+	for (k = 0; k < m_nchannels; ++k)
 		::memcpy(outs[k], ins[k], nframes * sizeof(float));
-	}
 
 	// process direct note on/off...
 	while (m_direct_note > 0) {
@@ -2297,6 +3169,17 @@ void drumkv1_impl::process ( float **ins, float **outs, uint32_t nframes )
 		process_midi((uint8_t *) &data, sizeof(data));
 	}
 
+	// effects lazy allocation
+	fx_request(fx_active());
+
+	// no voices and no effect tails left: bypass the fx-send section
+	const bool fx_bypass = (m_play_list.next() == nullptr && fx_idle());
+
+	if (!fx_bypass) {
+		for (k = 0; k < m_nchannels; ++k)
+			::memset(m_sfxs[k], 0, nframes * sizeof(float));
+	}
+
 	drumkv1_elem *elem = m_elem_list.next();
 	while (elem) {
 	#if 0
@@ -2318,6 +3201,8 @@ void drumkv1_impl::process ( float **ins, float **outs, uint32_t nframes )
 
 	// per voice
 
+	m_load.start();
+
 	drumkv1_voice *pv = m_play_list.next();
 
 	while (pv) {
@@ -2383,6 +3268,13 @@ void drumkv1_impl::process ( float **ins, float **outs, uint32_t nframes )
 				pv->gen1.next(pv->gen1_freq
 					* (m_ctl.pitchbend + modwheel1 * lfo1));
 
+				// sample over: voice ends right here, sample accurate
+				// (ie. not at the end of the current block).
+				if (pv->gen1.isOver()) {
+					ngen = j;
+					break;
+				}
+
 				float gen1 = pv->gen1.value(k1);
 				float gen2 = pv->gen1.value(k2);
 
@@ -2486,50 +3378,83 @@ void drumkv1_impl::process ( float **ins, float **outs, uint32_t nframes )
 		pv = pv_next;
 	}
 
-	// chorus
-	if (m_nchannels > 1) {
-		m_chorus.process(m_sfxs[0], m_sfxs[1], nframes, *m_cho.wet,
-			*m_cho.delay, *m_cho.feedb, *m_cho.rate, *m_cho.mod);
-	}
+	m_load.mark(drumkv1_load::Voices);
 
-	// effects
-	for (k = 0; k < m_nchannels; ++k) {
-		float *in = m_sfxs[k];
-		// flanger
-		m_flanger[k].process(in, nframes, *m_fla.wet,
-			*m_fla.delay, *m_fla.feedb, *m_fla.daft * float(k));
-		// phaser
-		m_phaser[k].process(in, nframes, *m_pha.wet,
-			*m_pha.rate, *m_pha.feedb, *m_pha.depth, *m_pha.daft * float(k));
-		// delay
-		m_delay[k].process(in, nframes, *m_del.wet,
-			*m_del.delay, *m_del.feedb, get_bpm(*m_del.bpm));
-	}
+	// fx-send section
+	if (!fx_bypass) {
+		// chorus
+		drumkv1_fx_chorus *chorus = m_chorus.load(std::memory_order_acquire);
+		if (chorus && m_nchannels > 1) {
+			chorus->process(m_sfxs[0], m_sfxs[1], nframes, *m_cho.wet,
+				*m_cho.delay, *m_cho.feedb, *m_cho.rate, *m_cho.mod);
+		}
 
-	// reverb
-	if (m_nchannels > 1) {
-		m_reverb.process(m_sfxs[0], m_sfxs[1], nframes, *m_rev.wet,
-			*m_rev.feedb, *m_rev.room, *m_rev.damp, *m_rev.width);
-	}
-
-	// output mix-down
-	for (k = 0; k < m_nchannels; ++k) {
-		uint32_t n;
-		float *sfx = m_sfxs[k];
-		// compressor
-		if (int(*m_dyn.compress) > 0)
-			m_comp[k].process(sfx, nframes);
-		// limiter
-		if (int(*m_dyn.limiter) > 0) {
-			float *p = sfx;
-			float *q = sfx;
+		// effects
+		drumkv1_fx_flanger *flanger = m_flanger.load(std::memory_order_acquire);
+		drumkv1_fx_phaser  *phaser  = m_phaser.load(std::memory_order_acquire);
+		drumkv1_fx_delay   *delay   = m_delay.load(std::memory_order_acquire);
+		for (k = 0; k < m_nchannels; k += 2) {
+			// stereo pairs (odd channel out is mono)
+			const uint16_t k2 = k + 1;
+			float *in1 = m_sfxs[k];
+			float *in2 = (k2 < m_nchannels ? m_sfxs[k2] : nullptr);
+			// flanger
+			if (flanger) {
+				const float daft = *m_fla.daft;
+				flanger[k >> 1].process(in1, in2, nframes, *m_fla.wet,
+					*m_fla.delay, *m_fla.feedb, daft * float(k), daft * float(k2));
+			}
+			// phaser
+			if (phaser) {
+				const float daft = *m_pha.daft;
+				phaser[k >> 1].process(in1, in2, nframes, *m_pha.wet,
+					*m_pha.rate, *m_pha.feedb, *m_pha.depth, daft * float(k), daft * float(k2));
+			}
+			// delay
+			if (delay) {
+				delay[k >> 1].process(in1, in2, nframes, *m_del.wet,
+					*m_del.delay, *m_del.feedb, get_bpm(*m_del.bpm));
+			}
+		}
+
+		m_load.mark(drumkv1_load::Effects);
+
+		// reverb
+		drumkv1_reverb *reverb = m_reverb.load(std::memory_order_acquire);
+		if (reverb && m_nchannels > 1) {
+			reverb->process(m_sfxs[0], m_sfxs[1], nframes, *m_rev.wet,
+				*m_rev.feedb, *m_rev.room, *m_rev.damp, *m_rev.width);
+		}
+
+		m_load.mark(drumkv1_load::Reverb);
+
+		// compressor (stereo pairs)
+		drumkv1_fx_comp *comp = m_comp.load(std::memory_order_acquire);
+		if (comp && int(*m_dyn.compress) > 0) {
+			for (k = 0; k < m_nchannels; k += 2) {
+				const uint16_t k2 = k + 1;
+				comp[k >> 1].process(m_sfxs[k],
+					(k2 < m_nchannels ? m_sfxs[k2] : nullptr), nframes);
+			}
+		}
+
+		m_load.mark(drumkv1_load::Effects);
+
+		// output mix-down
+		const bool limiter = (int(*m_dyn.limiter) > 0);
+		for (k = 0; k < m_nchannels; ++k) {
+			uint32_t n;
+			float *sfx = m_sfxs[k];
+			// limiter
+			if (limiter)
+				drumkv1_limiter(sfx, nframes);
+			// mix-down
+			float *out = outs[k];
 			for (n = 0; n < nframes; ++n)
-				*q++ = drumkv1_sigmoid(*p++);
+				*out++ += *sfx++;
 		}
-		// mix-down
-		float *out = outs[k];
-		for (n = 0; n < nframes; ++n)
-			*out++ += *sfx++;
+
+		m_load.mark(drumkv1_load::Mixdown);
 	}
 
 	// post-processing
@@ -2594,6 +3519,28 @@ bool drumkv1_impl::running ( bool on )
 }
 
 
+// host processing state...
+void drumkv1_impl::setActive ( bool bActive )
+{
+	m_active.store(bActive);
+
+	if (bActive) {
+		// wait for any loader adopting off the audio thread...
+		while (m_kit_lock.load())
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	} else {
+		// adopt whatever was left for the (now gone) audio thread.
+		kit_adopt();
+	}
+}
+
+
+bool drumkv1_impl::isActive (void) const
+{
+	return m_active.load();
+}
+
+
 //-------------------------------------------------------------------------
 // drumkv1 - decl.
 //
@@ -2698,6 +3645,38 @@ void drumkv1::clearElements (void)
 }
 
 
+void drumkv1::beginElements (void)
+{
+	m_pImpl->beginElements();
+}
+
+void drumkv1::commitElements ( bool bHold )
+{
+	m_pImpl->commitElements(bHold);
+}
+
+
+drumkv1_kit *drumkv1::takeElements (void)
+{
+	return m_pImpl->takeElements();
+}
+
+bool drumkv1::adoptElements ( drumkv1_kit *pKit, bool bHold )
+{
+	return m_pImpl->adoptElements(pKit, bHold);
+}
+
+void drumkv1::freeElements ( drumkv1_kit *pKit )
+{
+	m_pImpl->freeElements(pKit);
+}
+
+uint64_t drumkv1::elementsMemory ( const drumkv1_kit *pKit ) const
+{
+	return m_pImpl->elementsMemory(pKit);
+}
+
+
 void drumkv1::setSampleFile ( const char *pszSampleFile, bool bSync )
 {
 	m_pImpl->setSampleFile(pszSampleFile);
@@ -2846,6 +3825,14 @@ drumkv1_programs *drumkv1::programs (void) const
 }
 
 
+// load meter accessor
+
+drumkv1_load *drumkv1::load (void) const
+{
+	return m_pImpl->load();
+}
+
+
 // process state
 
 bool drumkv1::running ( bool on )
@@ -2854,6 +3841,20 @@ bool drumkv1::running ( bool on )
 }
 
 
+// host processing state (activation)
+
+void drumkv1::setActive ( bool bActive )
+{
+	m_pImpl->setActive(bActive);
+}
+
+
+bool drumkv1::isActive (void) const
+{
+	return m_pImpl->isActive();
+}
+
+
 // all stabilize
 
 void drumkv1::stabilize (void)
@@ -2899,6 +3900,28 @@ void drumkv1_element::setSampleFile ( const char *pszSampleFile )
 }
 
 
+void drumkv1_element::setSampleData ( const char *pszSampleFile,
+	uint16_t iChannels, float fRate, uint32_t iFrames,
+	float *const *ppFrames, drumkv1_sample_data *pData )
+{
+	if (m_pElem) {
+		m_pElem->gen1_sample.attach(pszSampleFile,
+			iChannels, fRate, iFrames, ppFrames, pData,
+			drumkv1_freq(m_pElem->gen1.sample0));
+	}
+}
+
+
+bool drumkv1_element::shareSample ( const drumkv1_element *pElement )
+{
+	if (m_pElem == nullptr || pElement == nullptr || pElement->m_pElem == nullptr)
+		return false;
+
+	return m_pElem->gen1_sample.share(pElement->m_pElem->gen1_sample,
+		drumkv1_freq(m_pElem->gen1.sample0));
+}
+
+
 const char *drumkv1_element::sampleFile (void) const
 {
 	return (m_pElem ? m_pElem->gen1_sample.filename() : nullptr);
@@ -3151,6 +4174,26 @@ void drumkv1::directNoteOn ( int note, int vel )
 }
 
 
+// Per-instance memory usage report.
+void drumkv1::memoryUsage ( MemoryUsage& mem ) const
+{
+	m_pImpl->memoryUsage(mem);
+}
+
+
+// Runtime counters.
+void drumkv1::counters ( Counters& counters ) const
+{
+	m_pImpl->counters(counters);
+}
+
+
+void drumkv1::resetCounters (void)
+{
+	m_pImpl->resetCounters();
+}
+
+
 // Micro-tuning support
 void drumkv1::setTuningEnabled ( bool enabled )
 {
@@ -32,9 +32,12 @@ class drumkv1_impl;
 class drumkv1_port;
 class drumkv1_elem;
 class drumkv1_element;
+class drumkv1_kit;
 class drumkv1_sample;
+class drumkv1_sample_data;
 class drumkv1_controls;
 class drumkv1_programs;
+class drumkv1_load;
 
 
 //-------------------------------------------------------------------------
@@ -70,6 +73,15 @@ public:
 
 	void clearElements();
 
+	// staged element set (off-thread kit preparation).
+	void beginElements();
+	void commitElements(bool bHold = false);
+
+	drumkv1_kit *takeElements();
+	bool adoptElements(drumkv1_kit *pKit, bool bHold = false);
+	void freeElements(drumkv1_kit *pKit);
+	uint64_t elementsMemory(const drumkv1_kit *pKit) const;
+
 	void setSampleFile(const char *pszSampleFile, bool bSync = false);
 	const char *sampleFile() const;
 
@@ -183,11 +195,17 @@ public:
 
 	bool running(bool on);
 
+	// host processing state: blocks are only processed while active;
+	// staged element sets get adopted right away when inactive.
+	void setActive(bool bActive);
+	bool isActive() const;
+
 	void stabilize();
 	void reset();
 
 	drumkv1_controls *controls() const;
 	drumkv1_programs *programs() const;
+	drumkv1_load *load() const;
 
 	void process_midi(uint8_t *data, uint32_t size);
 	void process(float **ins, float **outs, uint32_t nframes);
@@ -226,6 +244,37 @@ public:
 
 	virtual void updateTuning() = 0;
 
+	// per-instance memory usage report (bytes).
+	struct MemoryUsage
+	{
+		uint64_t voices;
+		uint64_t elements;
+		uint64_t samples;
+		uint64_t buffers;
+		uint64_t effects;
+
+		uint64_t total() const
+			{ return voices + elements + samples + buffers + effects; }
+	};
+
+	void memoryUsage(MemoryUsage& mem) const;
+
+	// runtime counters (since last reset).
+	struct Counters
+	{
+		uint32_t voices;		// current.
+		uint32_t peak_voices;
+		uint32_t alloc_failures;	// no free voice.
+		uint32_t choke_cuts;		// group choke.
+		uint32_t fast_releases;		// same note retrigger.
+		uint32_t cc_events;
+		uint32_t filtered;			// dropped off-channel.
+		uint32_t overruns;			// cycle over deadline.
+	};
+
+	void counters(Counters& counters) const;
+	void resetCounters();
+
 private:
 
 	drumkv1_impl *m_pImpl;
@@ -247,6 +296,12 @@ public:
 	void setSampleFile(const char *pszSampleFile);
 	const char *sampleFile() const;
 
+	void setSampleData(const char *pszSampleFile,
+		uint16_t iChannels, float fRate, uint32_t iFrames,
+		float *const *ppFrames, drumkv1_sample_data *pData);
+
+	bool shareSample(const drumkv1_element *pElement);
+
 	drumkv1_sample *sample() const;
 
 	void setReverse(bool bReverse);
@@ -0,0 +1,940 @@
+// drumkv1_bench.cpp
+//
+/****************************************************************************
+   Copyright (C) 2012-2021, rncbc aka Rui Nuno Capela. All rights reserved.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*****************************************************************************/
+
+#include "drumkv1_render.h"
+#include "drumkv1_sample.h"
+#include "drumkv1_resampler.h"
+#include "drumkv1_controls.h"
+#include "drumkv1_param.h"
+#include "drumkv1_bundle.h"
+#include "drumkv1_sched.h"
+#include "drumkv1_denormal.h"
+#include "drumkv1_fx.h"
+#include "drumkv1_config.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QCommandLineOption>
+#include <QTemporaryDir>
+#include <QFileInfo>
+
+#include <vector>
+#include <algorithm>
+#include <chrono>
+
+#include <cstdio>
+#include <cmath>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define DRUMKV1_BENCH_TSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define DRUMKV1_BENCH_TSC
+#endif
+
+
+//-------------------------------------------------------------------------
+// drumkv1_bench - timing helpers.
+//
+
+static inline uint64_t drumkv1_bench_nsecs (void)
+{
+	return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds> (
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+
+// time-stamp counter (reference cycles), zero where not available.
+static inline uint64_t drumkv1_bench_cycles (void)
+{
+#if defined(DRUMKV1_BENCH_TSC)
+	return uint64_t(__rdtsc());
+#else
+	return 0;
+#endif
+}
+
+
+//-------------------------------------------------------------------------
+// drumkv1_bench_data - shared synthetic sample frames.
+//
+
+class drumkv1_bench_data : public drumkv1_sample_data
+{
+public:
+
+	drumkv1_bench_data(uint16_t nchannels, uint32_t nframes, float srate)
+		: m_nchannels(nchannels), m_nframes(nframes)
+	{
+		// decaying partials, channels slightly detuned;
+		// padded as drumkv1_sample expects (+4 frames).
+		m_frames = new float * [nchannels];
+		for (uint16_t k = 0; k < nchannels; ++k) {
+			float *frames = new float [nframes + 4];
+			const float w0 = 2.0f * float(M_PI) * (110.0f + 3.0f * k) / srate;
+			for (uint32_t i = 0; i < nframes; ++i) {
+				const float env = ::expf(-3.0f * float(i) / float(nframes));
+				frames[i] = env * (0.5f * ::sinf(w0 * i)
+					+ 0.3f * ::sinf(2.7f * w0 * i) + 0.2f * ::sinf(5.1f * w0 * i));
+			}
+			::memset(frames + nframes, 0, 4 * sizeof(float));
+			m_frames[k] = frames;
+		}
+	}
+
+	uint16_t channels() const { return m_nchannels; }
+	uint32_t length() const { return m_nframes; }
+
+	float *const *frames() const { return m_frames; }
+
+protected:
+
+	~drumkv1_bench_data()
+	{
+		for (uint16_t k = 0; k < m_nchannels; ++k)
+			delete [] m_frames[k];
+		delete [] m_frames;
+	}
+
+private:
+
+	uint16_t m_nchannels;
+	uint32_t m_nframes;
+	float  **m_frames;
+};
+
+
+//-------------------------------------------------------------------------
+// drumkv1_bench - scenarios and results.
+//
+
+// effect units (bitmask).
+enum drumkv1_bench_fx
+{
+	FxNone     = 0,
+	FxChorus   = 1,
+	FxFlanger  = 2,
+	FxPhaser   = 4,
+	FxDelay    = 8,
+	FxReverb   = 16,
+	FxDynamics = 32,
+	FxAll      = 63
+};
+
+
+struct drumkv1_bench_case
+{
+	QString  sScenario;
+	QString  sName;
+	uint16_t nvoices;
+	uint16_t nchannels;	// sample channels (mono/stereo).
+	uint32_t nblock;
+	int      iSlope;
+	bool     bLfo;
+	int      iFx;
+};
+
+
+struct drumkv1_bench_result
+{
+	QString  sScenario;
+	QString  sName;
+	uint16_t nvoices;
+	uint16_t nchannels;
+	uint32_t nblock;
+	uint64_t ncount;	// frames, events or loads measured.
+	const char *pszUnit;
+	double   mean;
+	double   p50;
+	double   p90;
+	double   p99;
+	double   max;
+	double   ns_frame_voice;
+	double   cycles_frame;
+	double   load;		// % of the real-time budget.
+};
+
+
+struct drumkv1_bench_opts
+{
+	float    srate;
+	int      iIterations;
+	float    fSecs;
+	uint32_t nevents;
+	QString  sPresetFile;
+};
+
+
+// percentile over a sorted sample set.
+static double drumkv1_bench_percentile (
+	const std::vector<double>& values, double p )
+{
+	if (values.empty())
+		return 0.0;
+	const size_t n = values.size();
+	size_t i = size_t(p * double(n - 1) + 0.5);
+	if (i >= n)
+		i = n - 1;
+	return values[i];
+}
+
+
+static void drumkv1_bench_stats (
+	drumkv1_bench_result& result, std::vector<double>& values )
+{
+	std::sort(values.begin(), values.end());
+
+	double sum = 0.0;
+	std::vector<double>::const_iterator iter = values.begin();
+	for ( ; iter != values.end(); ++iter)
+		sum += *iter;
+
+	result.mean = (values.empty() ? 0.0 : sum / double(values.size()));
+	result.p50  = drumkv1_bench_percentile(values, 0.50);
+	result.p90  = drumkv1_bench_percentile(values, 0.90);
+	result.p99  = drumkv1_bench_percentile(values, 0.99);
+	result.max  = (values.empty() ? 0.0 : values.back());
+}
+
+
+// set an element parameter, both current and saved values.
+static void drumkv1_bench_param ( drumkv1_element *element,
+	drumkv1::ParamIndex index, float fValue )
+{
+	element->setParamValue(index, fValue, 0);
+	element->setParamValue(index, fValue);
+}
+
+
+// set all element parameters as a fresh kit does.
+static void drumkv1_bench_element ( drumkv1_element *element,
+	const drumkv1_bench_case& bc, drumkv1_bench_data *data, float srate )
+{
+	for (uint32_t i = 0; i < drumkv1::NUM_ELEMENT_PARAMS; ++i) {
+		const drumkv1::ParamIndex index = drumkv1::ParamIndex(i);
+		drumkv1_bench_param(element, index,
+			drumkv1_param::paramDefaultValue(index));
+	}
+
+	// filter always in, half-way down, so it costs the same every slope.
+	drumkv1_bench_param(element, drumkv1::DCF1_ENABLED, 1.0f);
+	drumkv1_bench_param(element, drumkv1::DCF1_CUTOFF, 0.5f);
+	drumkv1_bench_param(element, drumkv1::DCF1_RESO, 0.3f);
+	drumkv1_bench_param(element, drumkv1::DCF1_SLOPE, float(bc.iSlope));
+
+	// modulation on/off.
+	const float lfo = (bc.bLfo ? 1.0f : 0.0f);
+	drumkv1_bench_param(element, drumkv1::LFO1_ENABLED, lfo);
+	drumkv1_bench_param(element, drumkv1::LFO1_PITCH, 0.1f * lfo);
+	drumkv1_bench_param(element, drumkv1::LFO1_CUTOFF, 0.3f * lfo);
+	drumkv1_bench_param(element, drumkv1::LFO1_PANNING, 0.2f * lfo);
+
+	// hold the voice for the whole measured span.
+	drumkv1_bench_param(element, drumkv1::DCA1_LEVEL2, 1.0f);
+
+	// frames are shared, not copied (same rate).
+	element->setSampleData("drumkv1_bench", data->channels(),
+		srate, data->length(), data->frames(), data);
+}
+
+
+// global effect parameters.
+static void drumkv1_bench_fx ( drumkv1 *pDrumk, int iFx )
+{
+	pDrumk->setParamValue(drumkv1::CHO1_WET, (iFx & FxChorus)  ? 0.5f : 0.0f);
+	pDrumk->setParamValue(drumkv1::FLA1_WET, (iFx & FxFlanger) ? 0.5f : 0.0f);
+	pDrumk->setParamValue(drumkv1::PHA1_WET, (iFx & FxPhaser)  ? 0.5f : 0.0f);
+	pDrumk->setParamValue(drumkv1::DEL1_WET, (iFx & FxDelay)   ? 0.5f : 0.0f);
+	pDrumk->setParamValue(drumkv1::REV1_WET, (iFx & FxReverb)  ? 0.5f : 0.0f);
+
+	const float dyn = ((iFx & FxDynamics) ? 1.0f : 0.0f);
+	pDrumk->setParamValue(drumkv1::DYN1_COMPRESS, dyn);
+	pDrumk->setParamValue(drumkv1::DYN1_LIMITER, dyn);
+}
+
+
+// engine process scenario: N sustained voices, per-block timing.
+static void drumkv1_bench_process ( const drumkv1_bench_opts& opts,
+	const drumkv1_bench_case& bc, drumkv1_bench_result& result )
+{
+	const float srate = opts.srate;
+	const uint32_t nblock = bc.nblock;
+
+	// sample lasts well beyond the measured span.
+	const uint32_t nspan = uint32_t(opts.fSecs * srate);
+	drumkv1_bench_data *data
+		= new drumkv1_bench_data(bc.nchannels, 2 * nspan + nblock, srate);
+
+	drumkv1_render engine(2, srate, nblock);
+	drumkv1_bench_fx(&engine, bc.iFx);
+
+	engine.beginElements();
+	engine.clearElements();
+	for (uint16_t n = 0; n < bc.nvoices; ++n) {
+		drumkv1_element *element = engine.addElement(36 + n);
+		if (element)
+			drumkv1_bench_element(element, bc, data, srate);
+	}
+	// not processing: adopt it right away.
+	const bool running = engine.running(false);
+	engine.commitElements();
+	engine.running(running);
+
+	data->release();
+
+	float *ins[2], *outs[2];
+	for (uint16_t k = 0; k < 2; ++k) {
+		ins[k]  = new float [nblock];
+		outs[k] = new float [nblock];
+		::memset(ins[k], 0, nblock * sizeof(float));
+	}
+
+	const drumkv1_denormal denormal;
+
+	// warm up, settle.
+	engine.process(ins, outs, nblock);
+	engine.stabilize();
+	drumkv1_sched::sync_idle();
+
+	uint32_t nblocks = (nspan + nblock - 1) / nblock;
+	if (nblocks < 4)
+		nblocks = 4;
+
+	std::vector<double> values;
+	values.reserve(opts.iIterations * nblocks);
+
+	uint64_t nsecs = 0;
+	uint64_t ncycles = 0;
+	uint64_t nframes = 0;
+
+	for (int i = 0; i < opts.iIterations; ++i) {
+		engine.reset();
+		for (uint16_t n = 0; n < bc.nvoices; ++n) {
+			uint8_t note_on[3] = { 0x90, uint8_t(36 + n), 100 };
+			engine.process_midi(note_on, sizeof(note_on));
+		}
+		for (uint32_t j = 0; j < nblocks; ++j) {
+			const uint64_t c0 = drumkv1_bench_cycles();
+			const uint64_t t0 = drumkv1_bench_nsecs();
+			engine.process(ins, outs, nblock);
+			const uint64_t t1 = drumkv1_bench_nsecs();
+			const uint64_t c1 = drumkv1_bench_cycles();
+			values.push_back(double(t1 - t0) / double(nblock));
+			nsecs += (t1 - t0);
+			ncycles += (c1 - c0);
+			nframes += nblock;
+		}
+	}
+
+	for (uint16_t k = 0; k < 2; ++k) {
+		delete [] outs[k];
+		delete [] ins[k];
+	}
+
+	result.ncount  = nframes;
+	result.pszUnit = "ns/frame";
+	drumkv1_bench_stats(result, values);
+	result.mean = double(nsecs) / double(nframes);
+	result.ns_frame_voice = result.mean / double(bc.nvoices);
+	result.cycles_frame = double(ncycles) / double(nframes);
+	result.load = 100.0 * result.mean * 1E-9 * double(srate);
+}
+
+
+// silent tail after a hit: per-block time while the voices play (attack)
+// vs. the last span of a long decay, where only denormals could be left;
+// all effect units are kept busy and no FTZ/DAZ guard is set here, so it
+// takes the engine own anti-denormal measures to keep it flat.
+static void drumkv1_bench_tail ( const drumkv1_bench_opts& opts,
+	const drumkv1_bench_case& bc, drumkv1_bench_result& attack,
+	drumkv1_bench_result& tail )
+{
+	const float srate = opts.srate;
+	const uint32_t nblock = bc.nblock;
+
+	// short hit, then a long fade through the effects' feedback.
+	const uint32_t nspan = uint32_t(opts.fSecs * srate);
+	drumkv1_bench_data *data = new drumkv1_bench_data(bc.nchannels, nspan, srate);
+
+	drumkv1_render engine(2, srate, nblock);
+	drumkv1_bench_fx(&engine, bc.iFx);
+	engine.setParamValue(drumkv1::DEL1_FEEDB, 0.9f);
+	engine.setParamValue(drumkv1::REV1_FEEDB, 0.9f);
+
+	engine.beginElements();
+	engine.clearElements();
+	for (uint16_t n = 0; n < bc.nvoices; ++n) {
+		drumkv1_element *element = engine.addElement(36 + n);
+		if (element) {
+			drumkv1_bench_element(element, bc, data, srate);
+			drumkv1_bench_param(element, drumkv1::DCA1_LEVEL2,
+				drumkv1_param::paramDefaultValue(drumkv1::DCA1_LEVEL2));
+		}
+	}
+	const bool running = engine.running(false);
+	engine.commitElements();
+	engine.running(running);
+
+	data->release();
+
+	float *ins[2], *outs[2];
+	for (uint16_t k = 0; k < 2; ++k) {
+		ins[k]  = new float [nblock];
+		outs[k] = new float [nblock];
+		::memset(ins[k], 0, nblock * sizeof(float));
+	}
+
+	drumkv1_fx_tail::setBusy(true);
+
+	engine.process(ins, outs, nblock);
+	engine.stabilize();
+	drumkv1_sched::sync_idle();
+
+	// attack: the hit itself; tail: the last span of ~10 seconds.
+	const uint32_t nblocks = (nspan + nblock - 1) / nblock;
+	const uint32_t ntotal = uint32_t(10.0f * srate + nblock - 1) / nblock;
+	const uint32_t ntail = (ntotal > 2 * nblocks ? ntotal - nblocks : nblocks);
+
+	std::vector<double> values1, values2;
+	values1.reserve(opts.iIterations * nblocks);
+	values2.reserve(opts.iIterations * nblocks);
+
+	uint64_t nsecs1 = 0, nsecs2 = 0;
+	uint64_t ncycles1 = 0, ncycles2 = 0;
+	uint64_t nframes1 = 0, nframes2 = 0;
+
+	for (int i = 0; i < opts.iIterations; ++i) {
+		engine.reset();
+		for (uint16_t n = 0; n < bc.nvoices; ++n) {
+			uint8_t note_on[3] = { 0x90, uint8_t(36 + n), 100 };
+			engine.process_midi(note_on, sizeof(note_on));
+		}
+		for (uint32_t j = 0; j < ntail + nblocks; ++j) {
+			const uint64_t c0 = drumkv1_bench_cycles();
+			const uint64_t t0 = drumkv1_bench_nsecs();
+			engine.process(ins, outs, nblock);
+			const uint64_t t1 = drumkv1_bench_nsecs();
+			const uint64_t c1 = drumkv1_bench_cycles();
+			if (j < nblocks) {
+				values1.push_back(double(t1 - t0) / double(nblock));
+				nsecs1 += (t1 - t0);
+				ncycles1 += (c1 - c0);
+				nframes1 += nblock;
+			}
+			else
+			if (j >= ntail) {
+				values2.push_back(double(t1 - t0) / double(nblock));
+				nsecs2 += (t1 - t0);
+				ncycles2 += (c1 - c0);
+				nframes2 += nblock;
+			}
+		}
+	}
+
+	drumkv1_fx_tail::setBusy(false);
+
+	for (uint16_t k = 0; k < 2; ++k) {
+		delete [] outs[k];
+		delete [] ins[k];
+	}
+
+	drumkv1_bench_result *results[] = { &attack, &tail };
+	std::vector<double> *values[] = { &values1, &values2 };
+	const uint64_t nsecs[] = { nsecs1, nsecs2 };
+	const uint64_t ncycles[] = { ncycles1, ncycles2 };
+	const uint64_t nframes[] = { nframes1, nframes2 };
+	for (int i = 0; i < 2; ++i) {
+		drumkv1_bench_result& result = *results[i];
+		result.ncount  = nframes[i];
+		result.pszUnit = "ns/frame";
+		drumkv1_bench_stats(result, *values[i]);
+		result.mean = double(nsecs[i]) / double(nframes[i]);
+		result.ns_frame_voice = result.mean / double(bc.nvoices);
+		result.cycles_frame = double(ncycles[i]) / double(nframes[i]);
+		result.load = 100.0 * result.mean * 1E-9 * double(srate);
+	}
+}
+
+
+// dense (N)RPN/14-bit controller streams, all channels.
+static void drumkv1_bench_controls ( const drumkv1_bench_opts& opts,
+	drumkv1_bench_result& result )
+{
+	const float srate = opts.srate;
+	const uint32_t nblock = 256;
+
+	drumkv1_render engine(2, srate, nblock);
+
+	drumkv1_controls *pControls = engine.controls();
+	pControls->enabled(true);
+
+	// channel=0 (Auto) assignments, so every channel hits a control.
+	drumkv1_controls::Key key;
+	drumkv1_controls::Data data;
+	key.status = drumkv1_controls::NRPN;
+	key.param = 0x0101;
+	data.index = int(drumkv1::REV1_ROOM);
+	pControls->add_control(key, data);
+	key.status = drumkv1_controls::RPN;
+	key.param = 0x0000;
+	data.index = int(drumkv1::DEF1_PITCHBEND);
+	pControls->add_control(key, data);
+	key.status = drumkv1_controls::CC14;
+	key.param = 0x01;
+	data.index = int(drumkv1::DEF1_MODWHEEL);
+	pControls->add_control(key, data);
+
+	// one block worth of events: NRPN (4), RPN (4) and CC14 (2)
+	// messages, round-robin over all 16 channels.
+	std::vector<uint8_t> events;
+	uint32_t nevents = 0;
+	for (uint16_t ch = 0; nevents < opts.nevents; ch = (ch + 1) & 0x0f) {
+		const uint8_t status = 0xb0 | ch;
+		const uint8_t v = uint8_t(nevents & 0x7f);
+		const uint8_t stream[][3] = {
+			{ status, 0x63, 0x01 }, { status, 0x62, 0x01 },
+			{ status, 0x06, v }, { status, 0x26, uint8_t(0x7f - v) },
+			{ status, 0x65, 0x00 }, { status, 0x64, 0x00 },
+			{ status, 0x06, uint8_t(0x7f - v) }, { status, 0x26, v },
+			{ status, 0x01, v }, { status, 0x21, uint8_t(0x7f - v) }
+		};
+		for (uint32_t i = 0; i < sizeof(stream) / sizeof(stream[0]); ++i) {
+			events.insert(events.end(), stream[i], stream[i] + 3);
+			++nevents;
+		}
+	}
+
+	float *ins[2], *outs[2];
+	for (uint16_t k = 0; k < 2; ++k) {
+		ins[k]  = new float [nblock];
+		outs[k] = new float [nblock];
+		::memset(ins[k], 0, nblock * sizeof(float));
+	}
+
+	const drumkv1_denormal denormal;
+
+	const uint32_t nblocks
+		= uint32_t(opts.fSecs * srate + nblock - 1) / nblock;
+
+	std::vector<double> values;
+	values.reserve(opts.iIterations * nblocks);
+
+	uint64_t nsecs = 0;
+	uint64_t ncycles = 0;
+	uint64_t ntotal = 0;
+
+	for (int i = 0; i < opts.iIterations; ++i) {
+		for (uint32_t j = 0; j < nblocks; ++j) {
+			const uint64_t c0 = drumkv1_bench_cycles();
+			const uint64_t t0 = drumkv1_bench_nsecs();
+			for (uint32_t n = 0; n < nevents; ++n)
+				engine.process_midi(&events[3 * n], 3);
+			engine.process(ins, outs, nblock);
+			const uint64_t t1 = drumkv1_bench_nsecs();
+			const uint64_t c1 = drumkv1_bench_cycles();
+			values.push_back(double(t1 - t0) / double(nevents));
+			nsecs += (t1 - t0);
+			ncycles += (c1 - c0);
+			ntotal += nevents;
+		}
+		// let the (non-RT) notifications drain.
+		drumkv1_sched::sync_idle();
+	}
+
+	for (uint16_t k = 0; k < 2; ++k) {
+		delete [] outs[k];
+		delete [] ins[k];
+	}
+
+	result.nvoices = 0;
+	result.nchannels = 0;
+	result.nblock = nblock;
+	result.ncount  = ntotal;
+	result.pszUnit = "ns/event";
+	drumkv1_bench_stats(result, values);
+	result.mean = double(nsecs) / double(ntotal);
+	result.ns_frame_voice = 0.0;
+	result.cycles_frame = double(ncycles) / double(nblocks * opts.iIterations * nblock);
+	result.load = 100.0 * double(nsecs) * 1E-9 * double(srate)
+		/ double(nblocks * opts.iIterations * nblock);
+}
+
+
+// preset loading, XML vs. kit bundle (startup time).
+static bool drumkv1_bench_startup ( const drumkv1_bench_opts& opts,
+	const QString& sPresetFile, drumkv1_bench_result& result )
+{
+	std::vector<double> values;
+	values.reserve(opts.iIterations);
+
+	for (int i = 0; i < opts.iIterations; ++i) {
+		drumkv1_render engine(2, opts.srate, 256);
+		const uint64_t t0 = drumkv1_bench_nsecs();
+		if (!engine.loadFile(sPresetFile))
+			return false;
+		const uint64_t t1 = drumkv1_bench_nsecs();
+		values.push_back(1E-6 * double(t1 - t0));
+	}
+
+	result.nvoices = 0;
+	result.nchannels = 0;
+	result.nblock = 0;
+	result.ncount = values.size();
+	result.pszUnit = "ms/load";
+	drumkv1_bench_stats(result, values);
+	result.ns_frame_voice = 0.0;
+	result.cycles_frame = 0.0;
+	result.load = 0.0;
+
+	return true;
+}
+
+
+//-------------------------------------------------------------------------
+// drumkv1_bench - report writers.
+//
+
+static void drumkv1_bench_json ( FILE *fp, const drumkv1_bench_opts& opts,
+	const QList<drumkv1_bench_result>& results )
+{
+	::fprintf(fp, "{\n");
+	::fprintf(fp, "  \"package\": \"%s\",\n", PACKAGE_NAME);
+	::fprintf(fp, "  \"version\": \"%s\",\n", CONFIG_BUILD_VERSION);
+	::fprintf(fp, "  \"sample_rate\": %g,\n", opts.srate);
+	::fprintf(fp, "  \"iterations\": %d,\n", opts.iIterations);
+	::fprintf(fp, "  \"tsc\": %s,\n",
+		drumkv1_bench_cycles() > 0 ? "true" : "false");
+	::fprintf(fp, "  \"resampler\": \"%s\",\n", drumkv1_resampler::kernel());
+	::fprintf(fp, "  \"quality\": \"%s\",\n",
+		drumkv1_sample::qualityName(drumkv1_sample::quality()));
+	drumkv1_resampler::Table::Stats st;
+	drumkv1_resampler::Table::stats(st);
+	::fprintf(fp, "  \"resampler_tables\": { \"tables\": %u, \"used\": %u,"
+		" \"bytes\": %lu, \"hits\": %u, \"misses\": %u },\n",
+		st.tables, st.used, st.bytes, st.hits, st.misses);
+	::fprintf(fp, "  \"results\": [");
+	int i = 0;
+	foreach (const drumkv1_bench_result& result, results) {
+		::fprintf(fp, "%s\n    { \"scenario\": \"%s\", \"name\": \"%s\",",
+			i++ > 0 ? "," : "",
+			result.sScenario.toUtf8().constData(),
+			result.sName.toUtf8().constData());
+		::fprintf(fp, " \"voices\": %u, \"channels\": %u, \"block\": %u,",
+			result.nvoices, result.nchannels, result.nblock);
+		::fprintf(fp, " \"count\": %llu, \"unit\": \"%s\",",
+			(unsigned long long) result.ncount, result.pszUnit);
+		::fprintf(fp, " \"mean\": %.3f, \"p50\": %.3f, \"p90\": %.3f,"
+			" \"p99\": %.3f, \"max\": %.3f,",
+			result.mean, result.p50, result.p90, result.p99, result.max);
+		::fprintf(fp, " \"ns_frame_voice\": %.3f, \"cycles_frame\": %.1f,"
+			" \"load\": %.3f }",
+			result.ns_frame_voice, result.cycles_frame, result.load);
+	}
+	::fprintf(fp, "\n  ]\n}\n");
+}
+
+
+static void drumkv1_bench_csv ( FILE *fp,
+	const QList<drumkv1_bench_result>& results )
+{
+	::fprintf(fp, "scenario,name,voices,channels,block,count,unit,"
+		"mean,p50,p90,p99,max,ns_frame_voice,cycles_frame,load\n");
+	foreach (const drumkv1_bench_result& result, results) {
+		::fprintf(fp, "%s,%s,%u,%u,%u,%llu,%s,"
+			"%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.1f,%.3f\n",
+			result.sScenario.toUtf8().constData(),
+			result.sName.toUtf8().constData(),
+			result.nvoices, result.nchannels, result.nblock,
+			(unsigned long long) result.ncount, result.pszUnit,
+			result.mean, result.p50, result.p90, result.p99, result.max,
+			result.ns_frame_voice, result.cycles_frame, result.load);
+	}
+}
+
+
+//-------------------------------------------------------------------------
+// main
+
+int main ( int argc, char *argv[] )
+{
+	QCoreApplication app(argc, argv);
+	app.setApplicationName(DRUMKV1_TITLE "_bench");
+	app.setApplicationVersion(CONFIG_BUILD_VERSION);
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription(
+		DRUMKV1_TITLE " - " + QObject::tr("engine micro-benchmarks."));
+
+	parser.addOption({{"s", "scenarios"},
+		QObject::tr("Comma separated list of scenarios: voices, slope, lfo,"
+			" fx, sample, block, tail, controls, startup (default: all)"), "list"});
+	parser.addOption({{"p", "preset"},
+		QObject::tr("Preset for the startup scenario (XML vs. bundle)"), "file"});
+	parser.addOption({{"f", "format"},
+		QObject::tr("Report format: json or csv (default: json)"), "format", "json"});
+	parser.addOption({{"o", "output"},
+		QObject::tr("Report file (default: standard output)"), "file"});
+	parser.addOption({{"r", "sample-rate"},
+		QObject::tr("Sample rate (default: 48000)"), "hz", "48000"});
+	parser.addOption({{"n", "iterations"},
+		QObject::tr("Iterations per case (default: 10)"), "n", "10"});
+	parser.addOption({{"t", "time"},
+		QObject::tr("Audio seconds measured per iteration (default: 0.25)"), "secs", "0.25"});
+	parser.addOption({"tail-ratio",
+		QObject::tr("Tail check: max. tail vs. attack time ratio (default: 1.5)"),
+		"ratio", "1.5"});
+	parser.addOption({{"e", "events"},
+		QObject::tr("Controller events per block (default: 160)"), "n", "160"});
+	parser.addHelpOption();
+	parser.addVersionOption();
+	parser.process(app);
+
+	drumkv1_bench_opts opts;
+	opts.srate = parser.value("sample-rate").toFloat();
+	opts.iIterations = parser.value("iterations").toInt();
+	opts.fSecs = parser.value("time").toFloat();
+	opts.nevents = parser.value("events").toUInt();
+	opts.sPresetFile = parser.value("preset");
+
+	const double fTailRatio = parser.value("tail-ratio").toDouble();
+
+	const QString& sFormat = parser.value("format");
+	if (opts.srate < 1.0f || opts.iIterations < 1 || opts.fSecs <= 0.0f
+		|| opts.nevents < 1 || fTailRatio <= 0.0
+		|| (sFormat != "json" && sFormat != "csv")) {
+		::fputs(QObject::tr("Invalid option value.\n").toUtf8().constData(), stderr);
+		return 1;
+	}
+
+	QStringList scenarios;
+	if (parser.isSet("scenarios"))
+		scenarios = parser.value("scenarios").split(',');
+	else {
+		scenarios << "voices" << "slope" << "lfo" << "fx"
+			<< "sample" << "block" << "tail" << "controls";
+		if (!opts.sPresetFile.isEmpty())
+			scenarios << "startup";
+	}
+
+	// engine process cases...
+	QList<drumkv1_bench_case> cases;
+	drumkv1_bench_case bc0;
+	bc0.nvoices   = 16;
+	bc0.nchannels = 2;
+	bc0.nblock    = 256;
+	bc0.iSlope    = 0;
+	bc0.bLfo      = true;
+	bc0.iFx       = FxNone;
+
+	if (scenarios.contains("voices")) {
+		for (uint16_t n = 1; n <= 64; n <<= 1) { // MAX_VOICES
+			drumkv1_bench_case bc = bc0;
+			bc.sScenario = "voices";
+			bc.sName = QString::number(n);
+			bc.nvoices = n;
+			cases.append(bc);
+		}
+	}
+
+	if (scenarios.contains("slope")) {
+		static const char *s_slopes[] = { "12dB", "24dB", "biquad", "formant" };
+		for (int i = 0; i < 4; ++i) {
+			drumkv1_bench_case bc = bc0;
+			bc.sScenario = "slope";
+			bc.sName = s_slopes[i];
+			bc.iSlope = i;
+			cases.append(bc);
+		}
+	}
+
+	if (scenarios.contains("lfo")) {
+		for (int i = 0; i < 2; ++i) {
+			drumkv1_bench_case bc = bc0;
+			bc.sScenario = "lfo";
+			bc.sName = (i > 0 ? "on" : "off");
+			bc.bLfo = (i > 0);
+			cases.append(bc);
+		}
+	}
+
+	if (scenarios.contains("fx")) {
+		static const struct { const char *name; int fx; } s_fxs[] = {
+			{ "none",     FxNone     },
+			{ "chorus",   FxChorus   },
+			{ "flanger",  FxFlanger  },
+			{ "phaser",   FxPhaser   },
+			{ "delay",    FxDelay    },
+			{ "reverb",   FxReverb   },
+			{ "dynamics", FxDynamics },
+			{ "all",      FxAll      }
+		};
+		for (uint32_t i = 0; i < sizeof(s_fxs) / sizeof(s_fxs[0]); ++i) {
+			drumkv1_bench_case bc = bc0;
+			bc.sScenario = "fx";
+			bc.sName = s_fxs[i].name;
+			bc.iFx = s_fxs[i].fx;
+			cases.append(bc);
+		}
+	}
+
+	if (scenarios.contains("sample")) {
+		for (uint16_t k = 1; k <= 2; ++k) {
+			drumkv1_bench_case bc = bc0;
+			bc.sScenario = "sample";
+			bc.sName = (k > 1 ? "stereo" : "mono");
+			bc.nchannels = k;
+			cases.append(bc);
+		}
+	}
+
+	if (scenarios.contains("block")) {
+		for (uint32_t nblock = 16; nblock <= 4096; nblock <<= 1) {
+			drumkv1_bench_case bc = bc0;
+			bc.sScenario = "block";
+			bc.sName = QString::number(nblock);
+			bc.nblock = nblock;
+			cases.append(bc);
+		}
+	}
+
+	QList<drumkv1_bench_result> results;
+
+	foreach (const drumkv1_bench_case& bc, cases) {
+		::fprintf(stderr, "%s: %s...\n",
+			bc.sScenario.toUtf8().constData(),
+			bc.sName.toUtf8().constData());
+		drumkv1_bench_result result;
+		result.sScenario = bc.sScenario;
+		result.sName     = bc.sName;
+		result.nvoices   = bc.nvoices;
+		result.nchannels = bc.nchannels;
+		result.nblock    = bc.nblock;
+		drumkv1_bench_process(opts, bc, result);
+		results.append(result);
+	}
+
+	// CPU time must stay flat in the silent tail (denormals).
+	int nfailed = 0;
+
+	if (scenarios.contains("tail")) {
+		::fprintf(stderr, "tail: attack vs. tail...\n");
+		drumkv1_bench_case bc = bc0;
+		bc.iFx = FxAll;
+		drumkv1_bench_result attack;
+		attack.sScenario = "tail";
+		attack.sName     = "attack";
+		attack.nvoices   = bc.nvoices;
+		attack.nchannels = bc.nchannels;
+		attack.nblock    = bc.nblock;
+		drumkv1_bench_result tail = attack;
+		tail.sName = "tail";
+		drumkv1_bench_tail(opts, bc, attack, tail);
+		results.append(attack);
+		results.append(tail);
+		const double ratio = (attack.p50 > 0.0 ? tail.p50 / attack.p50 : 0.0);
+		const bool bOk = (ratio <= fTailRatio);
+		::fprintf(stderr, "tail: %.3f vs. %.3f ns/frame (ratio %.2f): %s\n",
+			tail.p50, attack.p50, ratio, bOk ? "ok" : "FAILED");
+		if (!bOk)
+			++nfailed;
+	}
+
+	if (scenarios.contains("controls")) {
+		::fprintf(stderr, "controls: dense...\n");
+		drumkv1_bench_result result;
+		result.sScenario = "controls";
+		result.sName = "dense";
+		drumkv1_bench_controls(opts, result);
+		results.append(result);
+	}
+
+	if (scenarios.contains("startup")) {
+		if (opts.sPresetFile.isEmpty()) {
+			::fputs(QObject::tr("Startup scenario needs a preset.\n")
+				.toUtf8().constData(), stderr);
+			return 1;
+		}
+		QString sXmlFile = opts.sPresetFile;
+		QString sBundleFile = opts.sPresetFile;
+		QTemporaryDir tempDir;
+		const QFileInfo fi(opts.sPresetFile);
+		drumkv1_render engine(2, opts.srate, 256);
+		if (drumkv1_bundle::isBundle(opts.sPresetFile)) {
+			sXmlFile = tempDir.filePath(fi.completeBaseName() + ".drumkv1");
+			if (!drumkv1_bundle::importBundle(&engine, sBundleFile, sXmlFile))
+				sXmlFile.clear();
+		} else {
+			sBundleFile = tempDir.filePath(fi.completeBaseName()
+				+ '.' + drumkv1_bundle::suffix());
+			if (!drumkv1_bundle::exportPreset(&engine, sXmlFile, sBundleFile))
+				sBundleFile.clear();
+		}
+		const QString sNames[] = { "xml", "bundle" };
+		const QString sFiles[] = { sXmlFile, sBundleFile };
+		for (int i = 0; i < 2; ++i) {
+			::fprintf(stderr, "startup: %s...\n",
+				sNames[i].toUtf8().constData());
+			drumkv1_bench_result result;
+			result.sScenario = "startup";
+			result.sName = sNames[i];
+			if (sFiles[i].isEmpty()
+				|| !drumkv1_bench_startup(opts, sFiles[i], result)) {
+				::fprintf(stderr, "%s: %s\n",
+					sFiles[i].toUtf8().constData(),
+					QObject::tr("could not load preset").toUtf8().constData());
+				return 1;
+			}
+			results.append(result);
+		}
+	}
+
+	// resampler table cache, as left by all the loads above.
+	drumkv1_resampler::Table::Stats st;
+	drumkv1_resampler::Table::stats(st);
+	::fprintf(stderr, "resampler: %s kernel, %u table(s) cached"
+		" (%lu bytes), %u hit(s), %u miss(es)\n", drumkv1_resampler::kernel(),
+		st.tables, st.bytes, st.hits, st.misses);
+
+	FILE *fp = stdout;
+	if (parser.isSet("output")) {
+		fp = ::fopen(parser.value("output").toUtf8().constData(), "w");
+		if (fp == nullptr) {
+			::fprintf(stderr, "%s: %s\n",
+				parser.value("output").toUtf8().constData(),
+				QObject::tr("could not open report file").toUtf8().constData());
+			return 1;
+		}
+	}
+
+	if (sFormat == "csv")
+		drumkv1_bench_csv(fp, results);
+	else
+		drumkv1_bench_json(fp, opts, results);
+
+	if (fp != stdout)
+		::fclose(fp);
+
+	return (nfailed > 0 ? 2 : 0);
+}
+
+
+// end of drumkv1_bench.cpp
@@ -0,0 +1,481 @@
+// drumkv1_bundle.cpp
+//
+/****************************************************************************
+   Copyright (C) 2012-2021, rncbc aka Rui Nuno Capela. All rights reserved.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*****************************************************************************/
+
+#include "drumkv1_bundle.h"
+#include "drumkv1_param.h"
+#include "drumkv1_sample.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QByteArray>
+
+
+//-------------------------------------------------------------------------
+// drumkv1_bundle - file format.
+//
+
+static const char     DRUMKV1_BUNDLE_MAGIC[8] = { 'd','r','u','m','k','v','1','b' };
+static const uint32_t DRUMKV1_BUNDLE_VERSION  = 1;
+static const uint32_t DRUMKV1_BUNDLE_BYTEORDER = 0x01020304;
+
+// Frame blocks alignment (bytes) and channel stride granularity (frames).
+static const uint64_t DRUMKV1_BUNDLE_PAGE_SIZE = 4096;
+static const uint32_t DRUMKV1_BUNDLE_STRIDE    = 16;
+
+struct drumkv1_bundle_header
+{
+	char     magic[8];
+	uint32_t version;
+	uint32_t byteorder;
+	uint32_t header_size;
+	uint32_t elem_size;
+	uint32_t nelems;
+	uint32_t nparams;           // element params (per element)
+	uint32_t nglobals;          // global params
+	uint32_t globals_offset;    // float[nglobals]
+	uint32_t tuning_enabled;
+	float    tuning_ref_pitch;
+	int32_t  tuning_ref_note;
+	uint32_t tuning_scale_file; // string offsets (0=none)
+	uint32_t tuning_keymap_file;
+	uint32_t reserved;
+};
+
+struct drumkv1_bundle_elem
+{
+	uint32_t note;
+	uint32_t sample_file;       // string offset (original file, bundle relative)
+	uint32_t params_offset;     // float[nparams]
+	uint16_t channels;
+	uint16_t reserved;
+	float    rate;              // frames sample-rate
+	uint32_t nframes;
+	uint32_t offset_start;
+	uint32_t offset_end;
+	uint32_t stride;            // frames per channel block (>= nframes + 4)
+	uint64_t frames_offset;     // page aligned
+};
+
+
+//-------------------------------------------------------------------------
+// drumkv1_bundle_map - memory-mapped bundle file (shared frame storage).
+//
+
+class drumkv1_bundle_map : public drumkv1_sample_data
+{
+public:
+
+	// ctor.
+	drumkv1_bundle_map(const QString& sFilename)
+		: drumkv1_sample_data(), m_file(sFilename), m_data(nullptr), m_size(0) {}
+
+	// map the whole file, private (copy-on-write: sample reversal).
+	bool open()
+	{
+		if (!m_file.open(QIODevice::ReadOnly))
+			return false;
+		m_size = uint64_t(m_file.size());
+		if (m_size < sizeof(drumkv1_bundle_header))
+			return false;
+		m_data = m_file.map(0, m_size, QFileDevice::MapPrivateOption);
+		return (m_data != nullptr);
+	}
+
+	// accessors.
+	uchar *data() const
+		{ return m_data; }
+	uint64_t size() const
+		{ return m_size; }
+
+	// bounds check.
+	bool contains(uint64_t offset, uint64_t nbytes) const
+		{ return (offset <= m_size && nbytes <= m_size - offset); }
+
+	// string table accessor (0=none).
+	const char *string(uint32_t offset) const
+	{
+		if (offset == 0 || offset >= m_size)
+			return nullptr;
+		const char *psz = reinterpret_cast<const char *> (m_data + offset);
+		if (::memchr(psz, 0, m_size - offset) == nullptr)
+			return nullptr;
+		return psz;
+	}
+
+protected:
+
+	// dtor.
+	~drumkv1_bundle_map()
+	{
+		if (m_data)
+			m_file.unmap(m_data);
+		m_file.close();
+	}
+
+private:
+
+	// instance variables.
+	QFile    m_file;
+	uchar   *m_data;
+	uint64_t m_size;
+};
+
+
+//-------------------------------------------------------------------------
+// drumkv1_bundle - impl.
+//
+
+const char *drumkv1_bundle::suffix (void)
+{
+	return "drumkv1b";
+}
+
+
+bool drumkv1_bundle::isBundle ( const QString& sFilename )
+{
+	QFile file(sFilename);
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+
+	char magic[sizeof(DRUMKV1_BUNDLE_MAGIC)];
+	const bool ret = (file.read(magic, sizeof(magic)) == sizeof(magic)
+		&& ::memcmp(magic, DRUMKV1_BUNDLE_MAGIC, sizeof(magic)) == 0);
+
+	file.close();
+	return ret;
+}
+
+
+// Bundle relative <-> absolute file paths.
+static QByteArray drumkv1_bundle_path ( const QDir& dir, const char *psz )
+{
+	if (psz == nullptr || *psz == '\0')
+		return QByteArray();
+
+	return dir.absoluteFilePath(QString::fromUtf8(psz)).toUtf8();
+}
+
+
+static QByteArray drumkv1_bundle_rel_path ( const QDir& dir, const char *psz )
+{
+	if (psz == nullptr || *psz == '\0')
+		return QByteArray();
+
+	return dir.relativeFilePath(QString::fromUtf8(psz)).toUtf8();
+}
+
+
+bool drumkv1_bundle::loadBundle ( drumkv1 *pDrumk, const QString& sFilename )
+{
+	if (pDrumk == nullptr)
+		return false;
+
+	drumkv1_bundle_map *map = new drumkv1_bundle_map(sFilename);
+	if (!map->open()) {
+		map->release();
+		return false;
+	}
+
+	// sanity checks...
+	const drumkv1_bundle_header *header
+		= reinterpret_cast<const drumkv1_bundle_header *> (map->data());
+	if (::memcmp(header->magic, DRUMKV1_BUNDLE_MAGIC, sizeof(header->magic))
+		|| header->version != DRUMKV1_BUNDLE_VERSION
+		|| header->byteorder != DRUMKV1_BUNDLE_BYTEORDER
+		|| header->header_size < sizeof(drumkv1_bundle_header)
+		|| header->elem_size < sizeof(drumkv1_bundle_elem)
+		|| !map->contains(header->header_size,
+			uint64_t(header->nelems) * header->elem_size)
+		|| !map->contains(header->globals_offset,
+			uint64_t(header->nglobals) * sizeof(float))) {
+		map->release();
+		return false;
+	}
+
+	pDrumk->clearElements();
+
+	// original file paths are relative to the bundle.
+	const QDir dir(QFileInfo(sFilename).absoluteDir());
+
+	// elements...
+	const uint32_t nparams = drumkv1::NUM_ELEMENT_PARAMS;
+	const uint32_t nparams2 = header->nparams;
+	const uchar *elems = map->data() + header->header_size;
+	for (uint32_t n = 0; n < header->nelems; ++n) {
+		const drumkv1_bundle_elem *elem
+			= reinterpret_cast<const drumkv1_bundle_elem *> (
+				elems + n * header->elem_size);
+		const uint64_t nbytes
+			= uint64_t(elem->channels) * elem->stride * sizeof(float);
+		if (elem->note > 127 || elem->channels < 1
+			|| elem->stride < uint64_t(elem->nframes) + 4
+			|| (elem->frames_offset % sizeof(float))
+			|| !map->contains(elem->frames_offset, nbytes)
+			|| !map->contains(elem->params_offset,
+				uint64_t(nparams2) * sizeof(float)))
+			continue;
+		drumkv1_element *element = pDrumk->addElement(int(elem->note));
+		if (element == nullptr)
+			continue;
+		for (uint32_t i = 0; i < drumkv1::NUM_ELEMENT_PARAMS; ++i) {
+			const drumkv1::ParamIndex index = drumkv1::ParamIndex(i);
+			const float fDefValue = drumkv1_param::paramDefaultValue(index);
+			element->setParamValue(index, fDefValue, 0);
+			element->setParamValue(index, fDefValue);
+		}
+		const QByteArray aSampleFile
+			= drumkv1_bundle_path(dir, map->string(elem->sample_file));
+		float **frames = new float * [elem->channels];
+		for (uint16_t k = 0; k < elem->channels; ++k) {
+			frames[k] = reinterpret_cast<float *> (map->data()
+				+ elem->frames_offset + uint64_t(k) * elem->stride * sizeof(float));
+		}
+		element->setSampleData(aSampleFile.constData(),
+			elem->channels, elem->rate, elem->nframes, frames, map);
+		element->setOffsetRange(elem->offset_start, elem->offset_end);
+		delete [] frames;
+		const float *params = reinterpret_cast<const float *> (
+			map->data() + elem->params_offset);
+		for (uint32_t i = 0; i < nparams && i < nparams2; ++i) {
+			const drumkv1::ParamIndex index = drumkv1::ParamIndex(i);
+			const float fValue = drumkv1_param::paramSafeValue(index, params[i]);
+			element->setParamValue(index, fValue, 0);
+			element->setParamValue(index, fValue);
+		}
+	}
+
+	// global params...
+	const float *globals = reinterpret_cast<const float *> (
+		map->data() + header->globals_offset);
+	const uint32_t nglobals = drumkv1::NUM_PARAMS - drumkv1::NUM_ELEMENT_PARAMS;
+	const uint32_t nglobals2 = header->nglobals;
+	for (uint32_t i = 0; i < nglobals && i < nglobals2; ++i) {
+		const drumkv1::ParamIndex index
+			= drumkv1::ParamIndex(drumkv1::NUM_ELEMENT_PARAMS + i);
+		pDrumk->setParamValue(index,
+			drumkv1_param::paramSafeValue(index, globals[i]));
+	}
+
+	// micro-tuning...
+	pDrumk->setTuningEnabled(header->tuning_enabled > 0);
+	pDrumk->setTuningRefPitch(header->tuning_ref_pitch);
+	pDrumk->setTuningRefNote(header->tuning_ref_note);
+	pDrumk->setTuningScaleFile(drumkv1_bundle_path(
+		dir, map->string(header->tuning_scale_file)).constData());
+	pDrumk->setTuningKeyMapFile(drumkv1_bundle_path(
+		dir, map->string(header->tuning_keymap_file)).constData());
+	pDrumk->updateTuning();
+
+	// elements hold their own references now.
+	map->release();
+	return true;
+}
+
+
+// Round up to alignment.
+static inline uint64_t drumkv1_bundle_align ( uint64_t n, uint64_t a )
+{
+	return ((n + a - 1) / a) * a;
+}
+
+
+// Append to string table (0=none).
+static uint32_t drumkv1_bundle_string (
+	QByteArray& strtab, uint64_t offset, const char *psz )
+{
+	if (psz == nullptr || *psz == '\0')
+		return 0;
+
+	const uint32_t ret = uint32_t(offset + strtab.size());
+	strtab.append(psz);
+	strtab.append('\0');
+	return ret;
+}
+
+
+bool drumkv1_bundle::saveBundle ( drumkv1 *pDrumk, const QString& sFilename )
+{
+	if (pDrumk == nullptr)
+		return false;
+
+	// collect elements with samples...
+	QList<int> notes;
+	for (int note = 0; note < 128; ++note) {
+		drumkv1_element *element = pDrumk->element(note);
+		if (element == nullptr)
+			continue;
+		drumkv1_sample *sample = element->sample();
+		if (sample && sample->length() > 0 && sample->channels() > 0)
+			notes.append(note);
+	}
+
+	const uint32_t nelems = notes.count();
+	const uint32_t nparams = drumkv1::NUM_ELEMENT_PARAMS;
+	const uint32_t nglobals = drumkv1::NUM_PARAMS - drumkv1::NUM_ELEMENT_PARAMS;
+
+	// layout...
+	drumkv1_bundle_header header;
+	::memset(&header, 0, sizeof(header));
+	::memcpy(header.magic, DRUMKV1_BUNDLE_MAGIC, sizeof(header.magic));
+	header.version     = DRUMKV1_BUNDLE_VERSION;
+	header.byteorder   = DRUMKV1_BUNDLE_BYTEORDER;
+	header.header_size = sizeof(drumkv1_bundle_header);
+	header.elem_size   = sizeof(drumkv1_bundle_elem);
+	header.nelems      = nelems;
+	header.nparams     = nparams;
+	header.nglobals    = nglobals;
+
+	uint64_t offset = header.header_size + uint64_t(nelems) * header.elem_size;
+	header.globals_offset = uint32_t(offset);
+	offset += nglobals * sizeof(float);
+	const uint64_t params_offset = offset;
+	offset += uint64_t(nelems) * nparams * sizeof(float);
+
+	// original file paths are recorded relative to the bundle.
+	const QDir dir(QFileInfo(sFilename).absoluteDir());
+
+	QByteArray strtab;
+	header.tuning_enabled     = (pDrumk->isTuningEnabled() ? 1 : 0);
+	header.tuning_ref_pitch   = pDrumk->tuningRefPitch();
+	header.tuning_ref_note    = pDrumk->tuningRefNote();
+	header.tuning_scale_file  = drumkv1_bundle_string(strtab, offset,
+		drumkv1_bundle_rel_path(dir, pDrumk->tuningScaleFile()).constData());
+	header.tuning_keymap_file = drumkv1_bundle_string(strtab, offset,
+		drumkv1_bundle_rel_path(dir, pDrumk->tuningKeyMapFile()).constData());
+
+	drumkv1_bundle_elem *elems = new drumkv1_bundle_elem [nelems];
+	::memset(elems, 0, nelems * sizeof(drumkv1_bundle_elem));
+	for (uint32_t n = 0; n < nelems; ++n) {
+		drumkv1_element *element = pDrumk->element(notes.at(n));
+		drumkv1_sample *sample = element->sample();
+		drumkv1_bundle_elem& elem = elems[n];
+		elem.note = notes.at(n);
+		elem.sample_file = drumkv1_bundle_string(strtab, offset,
+			drumkv1_bundle_rel_path(dir, element->sampleFile()).constData());
+		elem.params_offset = uint32_t(
+			params_offset + uint64_t(n) * nparams * sizeof(float));
+		elem.channels = sample->channels();
+		elem.rate = sample->rate();
+		elem.nframes = sample->length();
+		elem.offset_start = element->offsetStart();
+		elem.offset_end = element->offsetEnd();
+		elem.stride = uint32_t(drumkv1_bundle_align(
+			elem.nframes + 4, DRUMKV1_BUNDLE_STRIDE));
+	}
+
+	offset += strtab.size();
+	for (uint32_t n = 0; n < nelems; ++n) {
+		drumkv1_bundle_elem& elem = elems[n];
+		elem.frames_offset = drumkv1_bundle_align(
+			offset, DRUMKV1_BUNDLE_PAGE_SIZE);
+		offset = elem.frames_offset
+			+ uint64_t(elem.channels) * elem.stride * sizeof(float);
+	}
+
+	QFile file(sFilename);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		delete [] elems;
+		return false;
+	}
+
+	// header, elements, params and strings...
+	file.write((const char *) &header, sizeof(header));
+	file.write((const char *) elems, nelems * sizeof(drumkv1_bundle_elem));
+
+	for (uint32_t i = 0; i < nglobals; ++i) {
+		const drumkv1::ParamIndex index
+			= drumkv1::ParamIndex(drumkv1::NUM_ELEMENT_PARAMS + i);
+		const float fValue = pDrumk->paramValue(index);
+		file.write((const char *) &fValue, sizeof(fValue));
+	}
+
+	for (uint32_t n = 0; n < nelems; ++n) {
+		drumkv1_element *element = pDrumk->element(notes.at(n));
+		for (uint32_t i = 0; i < nparams; ++i) {
+			const float fValue = element->paramValue(drumkv1::ParamIndex(i));
+			file.write((const char *) &fValue, sizeof(fValue));
+		}
+	}
+
+	file.write(strtab);
+
+	// frame blocks (always in forward order)...
+	float *block = nullptr;
+	uint32_t nblock = 0;
+	for (uint32_t n = 0; n < nelems; ++n) {
+		const drumkv1_bundle_elem& elem = elems[n];
+		drumkv1_sample *sample = pDrumk->element(notes.at(n))->sample();
+		if (nblock < elem.stride) {
+			delete [] block;
+			nblock = elem.stride;
+			block = new float [nblock];
+		}
+		const uint64_t npad = elem.frames_offset - uint64_t(file.pos());
+		if (npad > 0)
+			file.write(QByteArray(int(npad), '\0'));
+		for (uint16_t k = 0; k < elem.channels; ++k) {
+			const float *frames = sample->frames(k);
+			::memset(block, 0, elem.stride * sizeof(float));
+			if (sample->isReverse()) {
+				const uint32_t nsize1 = elem.nframes - 1;
+				for (uint32_t j = 0; j < elem.nframes; ++j)
+					block[j] = frames[nsize1 - j];
+			} else {
+				::memcpy(block, frames, elem.nframes * sizeof(float));
+			}
+			file.write((const char *) block, elem.stride * sizeof(float));
+		}
+	}
+
+	delete [] block;
+	delete [] elems;
+
+	const bool ret = (uint64_t(file.pos()) == offset);
+	file.close();
+	return ret;
+}
+
+
+// XML preset <-> bundle conversion (via the given instance).
+bool drumkv1_bundle::exportPreset ( drumkv1 *pDrumk,
+	const QString& sPresetFile, const QString& sBundleFile )
+{
+	if (!drumkv1_param::loadPreset(pDrumk, sPresetFile))
+		return false;
+
+	return saveBundle(pDrumk, sBundleFile);
+}
+
+
+bool drumkv1_bundle::importBundle ( drumkv1 *pDrumk,
+	const QString& sBundleFile, const QString& sPresetFile )
+{
+	if (!drumkv1_param::loadPreset(pDrumk, sBundleFile))
+		return false;
+
+	// NB. elements refer to their original sample files,
+	// as found relative to the bundle, now relative to the preset.
+	return drumkv1_param::savePreset(pDrumk, sPresetFile);
+}
+
+
+// end of drumkv1_bundle.cpp
@@ -0,0 +1,65 @@
+// drumkv1_bundle.h
+//
+/****************************************************************************
+   Copyright (C) 2012-2021, rncbc aka Rui Nuno Capela. All rights reserved.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*****************************************************************************/
+
+#ifndef __drumkv1_bundle_h
+#define __drumkv1_bundle_h
+
+#include "drumkv1.h"
+
+#include <QString>
+
+
+//-------------------------------------------------------------------------
+// drumkv1_bundle - single-file binary kit bundle.
+//
+// Layout (native byte order, checked on load):
+//
+//   header | elements[nelems] | global params | element params
+//     | string table | page-aligned, de-interleaved frame blocks
+//
+// Frame blocks are already decoded (and resampled to the rate they
+// were exported at) so loading just maps the file and points each
+// element sample straight at them.
+//
+
+namespace drumkv1_bundle
+{
+	// Bundle file suffix.
+	const char *suffix();
+
+	// Whether a file looks like a kit bundle (magic check).
+	bool isBundle(const QString& sFilename);
+
+	// Bundle serialization methods (current or staged element set).
+	bool loadBundle(drumkv1 *pDrumk, const QString& sFilename);
+	bool saveBundle(drumkv1 *pDrumk, const QString& sFilename);
+
+	// XML preset <-> bundle conversion (via the given instance).
+	bool exportPreset(drumkv1 *pDrumk,
+		const QString& sPresetFile, const QString& sBundleFile);
+	bool importBundle(drumkv1 *pDrumk,
+		const QString& sBundleFile, const QString& sPresetFile);
+};
+
+
+#endif	// __drumkv1_bundle_h
+
+// end of drumkv1_bundle.h
@@ -226,6 +226,7 @@ QString drumkv1_config::controlPrefix (void) const
 
 void drumkv1_config::loadControls ( drumkv1_controls *pControls )
 {
+	pControls->begin_update();
 	pControls->clear();
 
 	QSettings::beginGroup(controlsGroup());
@@ -255,6 +256,7 @@ void drumkv1_config::loadControls ( drumkv1_controls *pControls )
 
 	QSettings::endGroup();
 
+	pControls->end_update();
 	pControls->enabled(bControlsEnabled);
 }
 
@@ -315,8 +317,15 @@ void drumkv1_config::load (void)
 	iFrameTimeFormat = QSettings::value("/FrameTimeFormat", 0).toInt();
 	fRandomizePercent = QSettings::value("/RandomizePercent", 20.0f).toFloat();
 	bUseGMDrumNames = QSettings::value("/UseGMDrumNames", true).toBool();
+	iReverbMode = QSettings::value("/ReverbMode", 0).toInt();
+	iWorkerThreads = QSettings::value("/WorkerThreads", 2).toInt();
+	iResamplerQuality = QSettings::value("/ResamplerQuality", 1).toInt();
 	bControlsEnabled = QSettings::value("/ControlsEnabled", false).toBool();
 	bProgramsEnabled = QSettings::value("/ProgramsEnabled", false).toBool();
+	bProgramsHold = QSettings::value("/ProgramsHold", false).toBool();
+	iProgramsPrefetch = QSettings::value("/ProgramsPrefetch", 0).toInt();
+	iProgramsPrefetchMem = QSettings::value("/ProgramsPrefetchMem", 256).toInt();
+	sProgramsPinned = QSettings::value("/ProgramsPinned").toStringList();
 	QSettings::endGroup();
 
 	QSettings::beginGroup("/Dialogs");
@@ -359,8 +368,15 @@ void drumkv1_config::save (void)
 	QSettings::setValue("/FrameTimeFormat", iFrameTimeFormat);
 	QSettings::setValue("/RandomizePercent", fRandomizePercent);
 	QSettings::setValue("/UseGMDrumNames", bUseGMDrumNames);
+	QSettings::setValue("/ReverbMode", iReverbMode);
+	QSettings::setValue("/WorkerThreads", iWorkerThreads);
+	QSettings::setValue("/ResamplerQuality", iResamplerQuality);
 	QSettings::setValue("/ControlsEnabled", bControlsEnabled);
 	QSettings::setValue("/ProgramsEnabled", bProgramsEnabled);
+	QSettings::setValue("/ProgramsHold", bProgramsHold);
+	QSettings::setValue("/ProgramsPrefetch", iProgramsPrefetch);
+	QSettings::setValue("/ProgramsPrefetchMem", iProgramsPrefetchMem);
+	QSettings::setValue("/ProgramsPinned", sProgramsPinned);
 	QSettings::endGroup();
 
 	QSettings::beginGroup("/Dialogs");
@@ -73,10 +73,24 @@ public:
 	// Whether to display GM Standard drum-note/key names.
 	bool bUseGMDrumNames;
 
+	// Reverb engine mode (0=Comb, 1=FDN).
+	int iReverbMode;
+
+	// Worker/schedule thread pool size.
+	int iWorkerThreads;
+
+	// Sample resampler quality (0=Draft, 1=Medium, 2=Best).
+	int iResamplerQuality;
+
 	// Special persistent options.
 	bool bControlsEnabled;
 	bool bProgramsEnabled;
 	bool bProgramsPreview;
+	bool bProgramsHold;
+	// Programs prefetch (adjacent count, memory budget MB, pinned "bank:prog").
+	int iProgramsPrefetch;
+	int iProgramsPrefetchMem;
+	QStringList sProgramsPinned;
 	bool bUseNativeDialogs;
 	// Run-time special non-persistent options.
 	bool bDontUseNativeDialogs;
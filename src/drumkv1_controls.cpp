@@ -21,7 +21,7 @@
 
 #include "drumkv1_controls.h"
 
-#include <QHash>
+#include <thread>
 
 
 #define RPN_MSB   0x65
@@ -188,7 +188,23 @@ private:
 	xrpn_data14    m_value;
 };
 
-typedef QHash<unsigned int, xrpn_item> xrpn_cache;
+
+//---------------------------------------------------------------------
+// xrpn_cache - decl. (fixed per-channel state, no allocation)
+//
+class xrpn_cache
+{
+public:
+
+	static const unsigned int Channels = 16;
+
+	xrpn_item& item ( unsigned short channel )
+		{ return m_items[channel & (Channels - 1)]; }
+
+private:
+
+	xrpn_item m_items[Channels];
+};
 
 
 //---------------------------------------------------------------------
@@ -198,51 +214,10 @@ class xrpn_queue
 {
 public:
 
-	xrpn_queue ( unsigned int size = 0 )
-		: m_size(0), m_mask(0), m_read(0), m_write(0), m_events(0)
-		{ resize(size); }
-
-	~xrpn_queue () { if (m_events) delete [] m_events; }
+	// fixed capacity (must be a power-of-2).
+	static const unsigned int Size = 1024;
 
-	void resize ( unsigned int size )
-	{
-		unsigned int new_size = 4; // must be a power-of-2...
-		while (new_size < size)
-			new_size <<= 1;
-		if (new_size > m_size) {
-			const unsigned int old_size = m_size;
-			drumkv1_controls::Event *new_events
-				= new drumkv1_controls::Event [new_size];
-			drumkv1_controls::Event *old_events = m_events;
-			if (old_events) {
-				if (m_write > m_read) {
-					::memcpy(
-						(void *) (new_events + m_read),
-						(void *) (old_events + m_read),
-						(m_write - m_read) * sizeof(drumkv1_controls::Event));
-				}
-				else
-				if (m_write < m_read) {
-					::memcpy(
-						(void *) (new_events + m_read),
-						(void *) (old_events + m_read),
-						(old_size - m_read) * sizeof(drumkv1_controls::Event));
-					if (m_write > 0) {
-						::memcpy(
-							(void *) (new_events + old_size),
-							(void *) (old_events),
-							m_write * sizeof(drumkv1_controls::Event));
-					}
-					m_write += old_size;
-				}
-			}
-			m_size = new_size;
-			m_mask = new_size - 1;
-			m_events = new_events;
-			if (old_events)
-				delete [] old_events;
-		}
-	}
+	xrpn_queue () : m_read(0), m_write(0) {}
 
 	void clear() { m_read = m_write = 0; }
 
@@ -251,23 +226,13 @@ public:
 		unsigned short param,
 		unsigned short value )
 	{
-		drumkv1_controls::Event event;
-
+		const unsigned int w = (m_write + 1) & (Size - 1);
+		if (w == m_read)
+			return false;
+		drumkv1_controls::Event& event = m_events[m_write];
 		event.key.status = status;
 		event.key.param  = param;
 		event.value = value;
-
-		return push(event);
-	}
-
-	bool push ( const drumkv1_controls::Event& event )
-	{
-		if (count() >= m_mask)
-			resize(m_size + 4);
-		const unsigned int w = (m_write + 1) & m_mask;
-		if (w == m_read)
-			return false;
-		m_events[m_write] = event;
 		m_write = w;
 		return true;
 	}
@@ -278,7 +243,7 @@ public:
 		if (r == m_write)
 			return false;
 		event = m_events[r];
-		m_read = (r + 1) & m_mask;
+		m_read = (r + 1) & (Size - 1);
 		return true;
 	}
 
@@ -286,21 +251,14 @@ public:
 		{ return (m_read != m_write); }
 
 	unsigned int count() const
-	{
-		if (m_write < m_read)
-			return (m_write + m_size - m_read) & m_mask;
-		else
-			return (m_write - m_read);
-	}
+		{ return (m_write - m_read) & (Size - 1); }
 
 private:
 
-	unsigned int m_size;
-	unsigned int m_mask;
 	unsigned int m_read;
 	unsigned int m_write;
 
-	drumkv1_controls::Event *m_events;
+	drumkv1_controls::Event m_events[Size];
 };
 
 
@@ -323,11 +281,11 @@ public:
 	void flush()
 	{
 		if (m_count > 0) {
-			xrpn_cache::Iterator iter = m_cache.begin();
-			const xrpn_cache::Iterator& iter_end = m_cache.end();
-			for ( ; iter != iter_end; ++iter)
-				enqueue(iter.value());
-			m_cache.clear();
+			for (unsigned int i = 1; i <= xrpn_cache::Channels; ++i) {
+				xrpn_item& item = m_cache.item(i);
+				enqueue(item);
+				item.clear();
+			}
 		//	m_count = 0;
 		}
 	}
@@ -502,7 +460,7 @@ public:
 protected:
 
 	xrpn_item& get_item ( unsigned short channel )
-		{ return m_cache[channel]; }
+		{ return m_cache.item(channel); }
 
 	void enqueue ( xrpn_item& item )
 	{
@@ -566,6 +524,126 @@ private:
 };
 
 
+//---------------------------------------------------------------------
+// drumkv1_controls::Table - flat lookup table (immutable layout).
+//
+//   Plain CCs index a direct [channel][param] array; RPN, NRPN and CC14
+//   keys go in a small open-addressing hash. The mutable part is only
+//   each slot's catch-up state, as updated on the audio thread.
+
+class drumkv1_controls::Table
+{
+public:
+
+	Table(const Map& map, const Table *old_table);
+
+	~Table()
+	{
+		delete [] m_hash;
+		delete [] m_slots;
+	}
+
+	// exact key lookup (RT).
+	Data *find(unsigned short status, unsigned short param) const
+	{
+		if ((status & 0xf00) == CC) {
+			if (param > 0x7f)
+				return nullptr;
+			const short i = m_cc[status & 0x1f][param];
+			return (i < 0 ? nullptr : &m_slots[i]);
+		}
+		const unsigned int k = hash_key(status, param);
+		unsigned int h = hash_index(k);
+		while (m_hash[h].slot >= 0) {
+			if (m_hash[h].key == k)
+				return &m_slots[m_hash[h].slot];
+			h = (h + 1) & m_hmask;
+		}
+		return nullptr;
+	}
+
+	// all slots.
+	unsigned int count() const
+		{ return m_nslots; }
+	Data& slot(unsigned int i) const
+		{ return m_slots[i]; }
+
+private:
+
+	static unsigned int hash_key(unsigned short status, unsigned short param)
+		{ return (((unsigned int) status) << 16) | param; }
+
+	unsigned int hash_index(unsigned int k) const
+		{ return ((k * 2654435761U) >> 16) & m_hmask; }
+
+	struct Hash
+	{
+		unsigned int key;
+		short slot;
+	};
+
+	short m_cc[0x20][0x80];
+
+	Hash *m_hash;
+	unsigned int m_hmask;
+
+	Data *m_slots;
+	unsigned int m_nslots;
+};
+
+
+drumkv1_controls::Table::Table ( const Map& map, const Table *old_table )
+{
+	unsigned int i, j;
+
+	for (i = 0; i < 0x20; ++i) {
+		for (j = 0; j < 0x80; ++j)
+			m_cc[i][j] = -1;
+	}
+
+	unsigned int nhash = 16;
+	while (nhash < 2 * (unsigned int) map.count())
+		nhash <<= 1;
+	m_hmask = nhash - 1;
+	m_hash = new Hash [nhash];
+	for (i = 0; i < nhash; ++i) {
+		m_hash[i].key = 0;
+		m_hash[i].slot = -1;
+	}
+
+	m_nslots = 0;
+	m_slots = new Data [map.count() + 1];
+
+	Map::ConstIterator iter = map.constBegin();
+	const Map::ConstIterator& iter_end = map.constEnd();
+	for ( ; iter != iter_end; ++iter) {
+		const Key& key = iter.key();
+		if (key.type() == CC && key.param > 0x7f)
+			continue;
+		const short islot = short(m_nslots++);
+		Data& data = m_slots[islot];
+		data = iter.value();
+		// carry over the catch-up state...
+		const Data *old_data = (old_table
+			? old_table->find(key.status, key.param) : nullptr);
+		if (old_data && old_data->index == data.index) {
+			data.val  = old_data->val;
+			data.sync = old_data->sync;
+		}
+		if (key.type() == CC) {
+			m_cc[key.channel()][key.param] = islot;
+		} else {
+			const unsigned int k = hash_key(key.status, key.param);
+			unsigned int h = hash_index(k);
+			while (m_hash[h].slot >= 0)
+				h = (h + 1) & m_hmask;
+			m_hash[h].key = k;
+			m_hash[h].slot = islot;
+		}
+	}
+}
+
+
 //---------------------------------------------------------------------
 // drumkv1_controls - impl.
 //
@@ -573,6 +651,7 @@ private:
 drumkv1_controls::drumkv1_controls ( drumkv1 *pDrumk )
 	: m_pImpl(new drumkv1_controls::Impl()), m_enabled(false),
 		m_sched_in(pDrumk), m_sched_out(pDrumk),
+		m_table(nullptr), m_readers(0), m_updating(0),
 		m_timeout(0), m_timein(0)
 {
 }
@@ -580,10 +659,33 @@ drumkv1_controls::drumkv1_controls ( drumkv1 *pDrumk )
 
 drumkv1_controls::~drumkv1_controls (void)
 {
+	delete m_table.exchange(nullptr);
+
 	delete m_pImpl;
 }
 
 
+// rebuild and swap the flat lookup table (non-RT).
+void drumkv1_controls::update (void)
+{
+	if (m_updating > 0)
+		return;
+
+	Table *old_table = m_table.load();
+	Table *new_table = nullptr;
+	if (!m_map.isEmpty())
+		new_table = new Table(m_map, old_table);
+
+	m_table.store(new_table);
+
+	// grace period: wait for the audio thread to let go...
+	while (m_readers.load() > 0)
+		std::this_thread::yield();
+
+	delete old_table;
+}
+
+
 // controller queue methods.
 void drumkv1_controls::process_enqueue (
 	unsigned short channel, unsigned short param, unsigned short value )
@@ -621,24 +723,31 @@ void drumkv1_controls::process_dequeue (void)
 // controller action.
 void drumkv1_controls::process_event ( const Event& event )
 {
-	Key key(event.key);
+	const Key& key = event.key;
 
 	m_sched_in.schedule_key(key);
 
-	const Map::Iterator& iter_end = m_map.end();
-	Map::Iterator iter = m_map.find(key);
-	if (iter == iter_end && key.channel() > 0) {
-		key.status = key.type(); // channel=0 (Auto)
-		iter = m_map.find(key);
+	m_readers.fetch_add(1);
+
+	const Table *table = m_table.load();
+	Data *data = nullptr;
+	if (table) {
+		data = table->find(key.status, key.param);
+		if (data == nullptr && key.channel() > 0) // channel=0 (Auto)
+			data = table->find(key.type(), key.param);
 	}
-	if (iter == iter_end)
-		return;
+	if (data)
+		process_data(key, *data, event.value);
 
-	// reference to payload...
-	Data& data = iter.value();
+	m_readers.fetch_sub(1);
+}
 
+
+void drumkv1_controls::process_data (
+	const Key& key, Data& data, unsigned short value )
+{
 	// process controller event...
-	float fScale = float(event.value) / 127.0f;
+	float fScale = float(value) / 127.0f;
 	if (key.type() != CC)
 		fScale /= 127.0f;
 
@@ -702,10 +811,12 @@ void drumkv1_controls::reset (void)
 	if (!enabled())
 		return;
 
-	const Map::Iterator& iter_end = m_map.end();
-	Map::Iterator iter = m_map.begin();
-	for ( ; iter != iter_end; ++iter) {
-		Data& data = iter.value();
+	m_readers.fetch_add(1);
+
+	const Table *table = m_table.load();
+	const unsigned int nslots = (table ? table->count() : 0);
+	for (unsigned int i = 0; i < nslots; ++i) {
+		Data& data = table->slot(i);
 		if (data.flags & Hook)
 			continue;
 		const drumkv1::ParamIndex index
@@ -714,6 +825,8 @@ void drumkv1_controls::reset (void)
 			m_sched_in.instance()->paramValue(index));
 		data.sync = false;
 	}
+
+	m_readers.fetch_sub(1);
 }
 
 
@@ -27,6 +27,8 @@
 
 #include <QMap>
 
+#include <atomic>
+
 
 //-------------------------------------------------------------------------
 // drumkv1_controls - Controller processs class.
@@ -115,11 +117,15 @@ public:
 	int find_control(const Key& key) const
 		{ return m_map.value(key).index; }
 	void add_control(const Key& key, const Data& data)
-		{ m_map.insert(key, data); }
+		{ m_map.insert(key, data); update(); }
 	void remove_control(const Key& key)
-		{ m_map.remove(key); }
+		{ m_map.remove(key); update(); }
+
+	void clear() { m_map.clear(); update(); }
 
-	void clear() { m_map.clear(); }
+	// bulk map changes: rebuild the lookup table once, at the end.
+	void begin_update() { ++m_updating; }
+	void end_update() { if (m_updating > 0 && --m_updating == 0) update(); }
 
 	// reset all controllers.
 	void reset();
@@ -146,6 +152,10 @@ protected:
 
 	// controller action.
 	void process_event(const Event& event);
+	void process_data(const Key& key, Data& data, unsigned short value);
+
+	// rebuild and swap the flat lookup table (non-RT).
+	void update();
 
 	// input controller scheduled events (learn)
 	class SchedIn : public drumkv1_sched
@@ -156,6 +166,10 @@ protected:
 		SchedIn (drumkv1 *pDrumk)
 			: drumkv1_sched(pDrumk, Controller) {}
 
+		// dtor.
+		~SchedIn ()
+			{ sync_drain(); }
+
 		void schedule_key(const Key& key)
 			{ m_key = key; schedule(); }
 
@@ -181,6 +195,10 @@ protected:
 		SchedOut (drumkv1 *pDrumk)
 			: drumkv1_sched(pDrumk, Controls), m_value(0.0f) {}
 
+		// dtor.
+		~SchedOut ()
+			{ sync_drain(); }
+
 		void schedule_event(drumkv1::ParamIndex index, float value)
 		{
 			if (qAbs(value - m_value) > 0.001f) {
@@ -221,6 +239,14 @@ private:
 	// controllers map.
 	Map m_map;
 
+	// flat lookup table (RT), read-copy-updated.
+	class Table;
+
+	std::atomic<Table *> m_table;
+	std::atomic<unsigned int> m_readers;
+
+	int m_updating;
+
 	// frame timers.
 	unsigned int m_timeout;
 	unsigned int m_timein;
@@ -0,0 +1,91 @@
+// drumkv1_denormal.h
+//
+/****************************************************************************
+   Copyright (C) 2012-2023, rncbc aka Rui Nuno Capela. All rights reserved.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*****************************************************************************/
+
+#ifndef __drumkv1_denormal_h
+#define __drumkv1_denormal_h
+
+#include <cstdint>
+
+#if defined(__SSE__) || defined(__x86_64__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define DRUMKV1_DENORMAL_SSE
+#elif defined(__aarch64__) || (defined(__arm__) && defined(__ARM_FP))
+#define DRUMKV1_DENORMAL_ARM
+#endif
+
+
+//-------------------------------------------------------------------------
+// drumkv1_denormal - Scoped flush-to-zero/denormals-are-zero guard.
+//
+//   Sets the FPU mode of the calling (audio) thread for the scope of
+//   a process cycle, restoring the host's previous mode on exit.
+
+class drumkv1_denormal
+{
+public:
+
+	drumkv1_denormal()
+	{
+	#if defined(DRUMKV1_DENORMAL_SSE)
+		m_state = _mm_getcsr();
+	#if defined(__x86_64__) || defined(_M_X64)
+		_mm_setcsr(m_state | 0x8040);	// FTZ | DAZ
+	#else
+		_mm_setcsr(m_state | 0x8000);	// FTZ (DAZ may be unsupported)
+	#endif
+	#elif defined(DRUMKV1_DENORMAL_ARM)
+		m_state = get_fpcr();
+		set_fpcr(m_state | (1 << 24));	// FZ
+	#endif
+	}
+
+	~drumkv1_denormal()
+	{
+	#if defined(DRUMKV1_DENORMAL_SSE)
+		_mm_setcsr(m_state);
+	#elif defined(DRUMKV1_DENORMAL_ARM)
+		set_fpcr(m_state);
+	#endif
+	}
+
+private:
+
+#if defined(DRUMKV1_DENORMAL_ARM)
+#if defined(__aarch64__)
+	static uintptr_t get_fpcr()
+		{ uint64_t v; __asm__ __volatile__ ("mrs %0, fpcr" : "=r" (v)); return v; }
+	static void set_fpcr(uintptr_t v)
+		{ __asm__ __volatile__ ("msr fpcr, %0" : : "r" (uint64_t(v))); }
+#else
+	static uintptr_t get_fpcr()
+		{ uint32_t v; __asm__ __volatile__ ("vmrs %0, fpscr" : "=r" (v)); return v; }
+	static void set_fpcr(uintptr_t v)
+		{ __asm__ __volatile__ ("vmsr fpscr, %0" : : "r" (uint32_t(v))); }
+#endif
+#endif
+
+	uintptr_t m_state;
+};
+
+
+#endif	// __drumkv1_denormal_h
+
+// end of drumkv1_denormal.h
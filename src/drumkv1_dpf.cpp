@@ -22,6 +22,8 @@
 #include "drumkv1_dpf.h"
 #include "drumkv1_param.h"
 #include "drumkv1_config.h"
+#include "drumkv1_denormal.h"
+#include "drumkv1_load.h"
 
 #include <QApplication>
 #include <QtXml/qdom.h>
@@ -118,7 +120,8 @@ QApplication *drumkv1_dpf::g_qapp_instance = nullptr;
 unsigned int  drumkv1_dpf::g_qapp_refcount = 0;
 
 
-drumkv1_dpf::drumkv1_dpf(double sample_rate): drumkv1(2, float(sample_rate))
+drumkv1_dpf::drumkv1_dpf(double sample_rate): drumkv1(2, float(sample_rate)),
+	m_state(this), m_bDirty(true)
 {
 }
 
@@ -173,6 +176,18 @@ void drumkv1_dpf::loadState(const char *state_data)
 	pDrumk->setTuningEnabled(false);
 	pDrumk->reset();
 
+	setDirty();
+
+	// binary state chunk (base64)?
+	const QByteArray data(state_data);
+	if (!data.trimmed().startsWith('<')) {
+		m_state.load(QByteArray::fromBase64(data), drumkv1_param::map_path());
+		pDrumk->stabilize();
+		pDrumk->reset();
+		pDrumk->running(running);
+		return;
+	}
+
 	static QHash<QString, drumkv1::ParamIndex> s_hash;
 	if (s_hash.isEmpty()) {
 		for (uint32_t i = drumkv1::NUM_ELEMENT_PARAMS; i < drumkv1::NUM_PARAMS; ++i) {
@@ -182,7 +197,7 @@ void drumkv1_dpf::loadState(const char *state_data)
 	}
 
 	QDomDocument doc(DRUMKV1_TITLE);
-	if (doc.setContent(QByteArray(state_data))) {
+	if (doc.setContent(data)) {
 		QDomElement ePreset = doc.documentElement();
 		if (ePreset.tagName() == "preset") {
 		//	&& ePreset.attribute("name") == fi.completeBaseName()) {
@@ -236,43 +251,30 @@ const char* drumkv1_dpf::exportState()
 {
 	drumkv1_dpf *pDrumk = this;
 
+	// re-encode only when something changed since last time.
+	if (!m_bDirty.exchange(false, std::memory_order_acq_rel)
+		&& !m_aState.isEmpty())
+		return m_aState.constData();
+
 	pDrumk->stabilize();
 
-	QDomDocument doc(DRUMKV1_TITLE);
-	QDomElement ePreset = doc.createElement("preset");
-	ePreset.setAttribute("name", DRUMKV1_PRESET_NAME_FOR_DPF_STATE);
-	ePreset.setAttribute("version", CONFIG_BUILD_VERSION);
-
-	QDomElement eElements = doc.createElement("elements");
-	drumkv1_param::saveElements(pDrumk, doc, eElements, drumkv1_param::map_path(), false);
-	ePreset.appendChild(eElements);
-
-	QDomElement eParams = doc.createElement("params");
-	for (uint32_t i = drumkv1::NUM_ELEMENT_PARAMS; i < drumkv1::NUM_PARAMS; ++i) {
-		QDomElement eParam = doc.createElement("param");
-		const drumkv1::ParamIndex index = drumkv1::ParamIndex(i);
-		eParam.setAttribute("index", QString::number(i));
-		eParam.setAttribute("name", drumkv1_param::paramName(index));
-		const float fValue = pDrumk->paramValue(index);
-		eParam.appendChild(doc.createTextNode(QString::number(fValue)));
-		eParams.appendChild(eParam);
-	}
-	ePreset.appendChild(eParams);
-	doc.appendChild(ePreset);
+	m_state.save(drumkv1_param::map_path(), drumkv1_state::Elements
+		| drumkv1_state::Params | drumkv1_state::Tuning);
+	if (m_state.isChanged() || m_aState.isEmpty())
+		m_aState = m_state.data().toBase64();
 
-	if (pDrumk->isTuningEnabled()) {
-		QDomElement eTuning = doc.createElement("tuning");
-		drumkv1_param::saveTuning(pDrumk, doc, eTuning, false);
-		ePreset.appendChild(eTuning);
-	}
+	// still loading? that's not the final state yet.
+	if (m_state.isPending())
+		setDirty();
 
-	const QByteArray data(doc.toByteArray());
-    return data.constData();
+	return m_aState.constData();
 }
 
 
 void drumkv1_dpf::updatePreset ( bool /*bDirty*/ )
 {
+	setDirty();
+
 	// NOTICE: No need to tell DPF about preset changes, since DPF knows it
 	//         when parameter changes from UI side.
 	//         Also "synthesizer -> plug-in" access is not essential in DPF.
@@ -284,29 +286,35 @@ void drumkv1_dpf::updateParam ( drumkv1::ParamIndex index )
 {
 	// NOTICE: No need to tell DPF about param changes. Reason mentioned above.
 	(void) index;
+
+	setDirty();
 }
 
 
 void drumkv1_dpf::updateParams (void)
 {
 	// NOTICE: No need to tell DPF about param changes. Reason mentioned above.
+	setDirty();
 }
 
 
 void drumkv1_dpf::updateTuning (void)
 {
 	// NOTICE: DPF does not support manual tuning. Will not implement it for now.
+	setDirty();
 }
 
 
 void drumkv1_dpf::updateSample (void)
 {
 	// NOTICE: No need to tell DPF about sample changes. Reason mentioned in updatePreset().
+	setDirty();
 }
 
 void drumkv1_dpf::updateOffsetRange (void)
 {
 	// NOTICE: No need to tell DPF about sample changes. Reason mentioned in updatePreset().
+	setDirty();
 }
 
 void drumkv1_dpf::selectSample (int key)
@@ -318,6 +326,7 @@ void drumkv1_dpf::selectSample (int key)
 
 void drumkv1_dpf::activate (void)
 {
+	drumkv1::setActive(true);
 	drumkv1::reset();
 }
 
@@ -325,11 +334,15 @@ void drumkv1_dpf::activate (void)
 void drumkv1_dpf::deactivate (void)
 {
 	drumkv1::reset();
+	drumkv1::setActive(false);
 }
 
 
 void drumkv1_dpf::run(const float **inputs, float **outputs, uint32_t nframes, const MidiEvent* midiEvents, uint32_t midiEventCount)
 {
+	const drumkv1_denormal denormal;
+	const drumkv1_load::Cycle cycle(drumkv1::load(), nframes);
+
     const uint16_t nchannels = drumkv1::channels();
 
 	uint32_t event_index;
@@ -354,6 +367,9 @@ DrumkV1Plugin::DrumkV1Plugin()
 	: Plugin(drumkv1::NUM_PARAMS, 0, 1) // parameters, programs, states
 {
 	drumkv1_dpf::qapp_instantiate();
+
+	// maximum block size, preallocated.
+	fSynthesizer->setBufferSize(getBufferSize());
 }
 
 
@@ -433,7 +449,11 @@ float DrumkV1Plugin::getParameterValue(uint32_t index) const
 
 void DrumkV1Plugin::setParameterValue(uint32_t index, float value)
 {
-	fSynthesizer->setParamValue((drumkv1::ParamIndex)index, value);
+	const drumkv1::ParamIndex currentParam = (drumkv1::ParamIndex)index;
+	const bool bDirty = (fSynthesizer->paramValue(currentParam) != value);
+	fSynthesizer->setParamValue(currentParam, value);
+	if (bDirty)
+		fSynthesizer->setDirty();
 }
 
 
@@ -449,6 +469,12 @@ void DrumkV1Plugin::run(const float** inputs, float** outputs, uint32_t frames,
 }
 
 
+void DrumkV1Plugin::bufferSizeChanged(uint32_t newBufferSize)
+{
+	fSynthesizer->setBufferSize(newBufferSize);
+}
+
+
 void DrumkV1Plugin::sampleRateChanged(double newSampleRate)
 {
 	fSynthesizer->setSampleRate(newSampleRate);
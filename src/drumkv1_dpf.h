@@ -23,10 +23,12 @@
 #define __drumkv1_dpf_h
 
 #include "drumkv1.h"
+#include "drumkv1_state.h"
 
 #include "DistrhoPlugin.hpp"
 
 #include <memory>
+#include <atomic>
 
 // Forward decls.
 class QApplication;
@@ -67,6 +69,10 @@ public:
 	void loadState(const char* state_data);
 	const char* exportState();
 
+	// something worth saving has changed (any thread).
+	void setDirty()
+		{ m_bDirty.store(true, std::memory_order_release); }
+
 	void run(const float **inputs, float **outputs, uint32_t nframes, const MidiEvent* midiEvents, uint32_t midiEventCount);
 
 	void activate();
@@ -97,6 +103,13 @@ protected:
 
 private:
 
+	// binary state codec and its last (encoded) chunk.
+	drumkv1_state m_state;
+	QByteArray    m_aState;
+
+	// set on any param, element or tuning change.
+	std::atomic<bool> m_bDirty;
+
 	static QApplication *g_qapp_instance;
 	static unsigned int  g_qapp_refcount;
 };
@@ -200,6 +213,7 @@ protected:
 	// ----------------------------------------------------------------------------------------------------------------
 	// Callbacks (optional)
 
+	void bufferSizeChanged(uint32_t newBufferSize) override;
 	void sampleRateChanged(double newSampleRate) override;
 
 	// ----------------------------------------------------------------------------------------------------------------
@@ -34,6 +34,104 @@
 //    Copyright (C) 2007 arguru, discodsp.com
 //
 
+//-------------------------------------------------------------------------
+// drumkv1_fx_tail - Silence and tail detector.
+//
+//   Keeps a unit alive for a hold period (its internal memory length)
+//   after the last non-silent input block, or while still ringing.
+
+class drumkv1_fx_tail
+{
+public:
+
+	drumkv1_fx_tail() : m_count(0) {}
+
+	void reset()
+		{ m_count = 0; }
+
+	bool idle() const
+		{ return (m_count == 0); }
+
+	// never going idle, all units processed all along
+	// (eg. benchmarks, through the silent tail).
+	static void setBusy(bool bBusy)
+		{ g_busy = bBusy; }
+
+	// input test: whether the unit must be processed.
+	bool active(const float *in0, const float *in1,
+		uint32_t nframes, uint32_t nhold)
+	{
+		if (g_busy || peak(in0, in1, nframes) > THRESHOLD)
+			m_count = nhold + nframes;
+		return (m_count > 0);
+	}
+
+	bool active(const float *in, uint32_t nframes, uint32_t nhold)
+		{ return active(in, nullptr, nframes, nhold); }
+
+	// state test: keeps the unit alive while its own memory is
+	// still ringing (unscaled level, whatever the wet amount).
+	void ringing(float level, uint32_t nframes, uint32_t nhold)
+	{
+		if (level > THRESHOLD)
+			m_count = nhold + nframes;
+	}
+
+	// hold countdown.
+	void tick(uint32_t nframes)
+		{ m_count = (m_count > nframes ? m_count - nframes : 0); }
+
+	// block peak level.
+	static float peak(const float *in0, const float *in1, uint32_t nframes)
+	{
+		float p0 = 0.0f;
+		float p1 = 0.0f;
+		uint32_t i;
+		for (i = 0; i < nframes; ++i)
+			p0 = (p0 > ::fabsf(in0[i]) ? p0 : ::fabsf(in0[i]));
+		if (in1) {
+			for (i = 0; i < nframes; ++i)
+				p1 = (p1 > ::fabsf(in1[i]) ? p1 : ::fabsf(in1[i]));
+		}
+		return (p0 > p1 ? p0 : p1);
+	}
+
+	// silence threshold (-120dB).
+	static constexpr float THRESHOLD = 1E-6f;
+
+private:
+
+	uint32_t m_count;
+
+	static bool g_busy;
+};
+
+
+//-------------------------------------------------------------------------
+// drumkv1_fx_noise - Anti-denormal noise source.
+//
+//   A per-instance pseudo-random generator, so the audio thread never
+//   touches the libc global (and locked) ::rand() state.
+
+class drumkv1_fx_noise
+{
+public:
+
+	drumkv1_fx_noise(uint32_t seed = 1) : m_seed(seed) {}
+
+	// tiny positive offset (0 .. ~2E-5).
+	float adenormal()
+	{
+		m_seed = (m_seed * 196314165) + 907633515;
+		return 1E-14f * float(m_seed >> 1);
+	}
+
+private:
+
+	uint32_t m_seed;
+};
+
+
 //-------------------------------------------------------------------------
 // drumkv1_fx_filter - RBJ biquad filter implementation.
 //
@@ -202,21 +300,98 @@ protected:
 		m_in1 = m_in2 = 0.0f;
 	}
 
-private:
-
 	// nominal sample-rate
 	float m_srate;
 
 	// filter coeffs
 	float m_b0a0, m_b1a0, m_b2a0, m_a1a0, m_a2a0;
 
+private:
+
 	// in/out history
 	float m_out1, m_out2, m_in1, m_in2;
 };
 
 
+//-------------------------------------------------------------------------
+// drumkv1_fx_filter2 - RBJ biquad filter (stereo pair lanes).
+//
+//   Same coefficients for both lanes, each with its own history;
+//   blocks are processed frame-major, lanes side by side.
+
+class drumkv1_fx_filter2 : public drumkv1_fx_filter
+{
+public:
+
+	drumkv1_fx_filter2(float srate = 44100.0f)
+		: drumkv1_fx_filter(srate) { reset_lanes(); }
+
+	void reset(Type type, float freq, float q, float gain, bool bwq = false)
+	{
+		drumkv1_fx_filter::reset(type, freq, q, gain, bwq);
+
+		reset_lanes();
+	}
+
+	template <uint16_t N>
+	void process_lanes(float (*buf)[2], uint32_t nframes)
+	{
+		const float b0 = m_b0a0, b1 = m_b1a0, b2 = m_b2a0;
+		const float a1 = m_a1a0, a2 = m_a2a0;
+
+		float in1[2], in2[2], out1[2], out2[2];
+		uint16_t c;
+
+		for (c = 0; c < N; ++c) {
+			in1[c]  = m_in1[c];
+			in2[c]  = m_in2[c];
+			out1[c] = m_out1[c];
+			out2[c] = m_out2[c];
+		}
+
+		for (uint32_t i = 0; i < nframes; ++i) {
+			float *frame = buf[i];
+			for (c = 0; c < N; ++c) {
+				const float in = frame[c];
+				const float out = b0 * in
+					+ b1 * in1[c]  + b2 * in2[c]
+					- a1 * out1[c] - a2 * out2[c];
+				in2[c]  = in1[c];
+				in1[c]  = in;
+				out2[c] = out1[c];
+				out1[c] = out;
+				frame[c] = out;
+			}
+		}
+
+		for (c = 0; c < N; ++c) {
+			m_in1[c]  = in1[c];
+			m_in2[c]  = in2[c];
+			m_out1[c] = out1[c];
+			m_out2[c] = out2[c];
+		}
+	}
+
+protected:
+
+	void reset_lanes()
+	{
+		for (uint16_t c = 0; c < 2; ++c)
+			m_out1[c] = m_out2[c] = m_in1[c] = m_in2[c] = 0.0f;
+	}
+
+private:
+
+	// in/out history, per lane
+	float m_out1[2], m_out2[2], m_in1[2], m_in2[2];
+};
+
+
 //-------------------------------------------------------------------------
 // drumkv1_fx_comp - DiscoDSP's "rock da disco" compressor/eq.
+//
+//   Stereo pair: eq. cascade run per block, with one envelope follower
+//   linked across both lanes (odd channel out is mono).
 
 class drumkv1_fx_comp
 {
@@ -243,6 +418,8 @@ public:
 	{
 		m_peak = 0.0f;
 
+		m_tail.reset();
+
 		m_attack  = ::expf(-1000.0f / (m_srate * 3.6f));
 		m_release = ::expf(-1000.0f / (m_srate * 150.0f));
 
@@ -252,51 +429,105 @@ public:
 		m_hi.reset(drumkv1_fx_filter::HiShelf, 10000.0f, 1.0f, 4.0f);
 	}
 
-	void process(float *in, uint32_t nframes)
+	bool idle() const
+		{ return m_tail.idle(); }
+
+	// in1 may be null (mono).
+	void process(float *in0, float *in1, uint32_t nframes)
+	{
+		// skip while silent (short eq. ring and release);
+		// the envelope would be fully released by then.
+		if (!m_tail.active(in0, in1, nframes, uint32_t(0.2f * m_srate))) {
+			m_peak = 1.0f;
+			return;
+		}
+		m_tail.tick(nframes);
+		// process buffers
+		float *ins[2] = { in0, in1 };
+		if (in1)
+			process_lanes<2>(ins, nframes);
+		else
+			process_lanes<1>(ins, nframes);
+	}
+
+private:
+
+	static const uint32_t NBLOCK = 64;
+
+	template <uint16_t N>
+	void process_lanes(float **ins, uint32_t nframes)
 	{
 		// compressor
 		const float threshold = 0.251f;	//~= powf(10.0f, -12.0f / 20.0f);
 		const float post_gain = 1.995f;	//~= powf(10.0f, 6.0f / 20.0f);
-		// process buffers
-		for (uint32_t i = 0; i < nframes; ++i) {
+		// process, in chunks...
+		float buf[NBLOCK][2];
+		float gains[NBLOCK];
+		uint16_t c;
+		for (uint32_t i = 0; i < nframes; i += NBLOCK) {
+			const uint32_t n = (nframes - i < NBLOCK ? nframes - i : NBLOCK);
+			uint32_t j;
 			// anti-denormalizer noise
-			const float ad = 1E-14f * float(::rand());
-			// process
-			const float lo = m_lo.output(m_mi.output(m_hi.output(*in + ad)));
-			// compute peak
-			const float peak = ::fabsf(lo);
-			// compute gain
-			float gain = 1.0f;
-			if (peak > threshold)
-				gain = threshold / peak;
-			// envelope
-			if (m_peak > gain) {
-				m_peak *= m_attack;
-				m_peak += (1.0f - m_attack) * gain;
-			} else {
-				m_peak *= m_release;
-				m_peak += (1.0f - m_release) * gain;
+			for (c = 0; c < N; ++c) {
+				const float *in = ins[c] + i;
+				const float ad = m_noise.adenormal();
+				for (j = 0; j < n; ++j)
+					buf[j][c] = in[j] + ad;
 			}
+			// eq. cascade
+			m_hi.process_lanes<N>(buf, n);
+			m_mi.process_lanes<N>(buf, n);
+			m_lo.process_lanes<N>(buf, n);
+			// linked envelope
+			float peak1 = m_peak;
+			for (j = 0; j < n; ++j) {
+				// compute peak
+				float peak = ::fabsf(buf[j][0]);
+				if (N > 1 && peak < ::fabsf(buf[j][1]))
+					peak = ::fabsf(buf[j][1]);
+				// compute gain
+				float gain = 1.0f;
+				if (peak > threshold)
+					gain = threshold / peak;
+				// envelope
+				if (peak1 > gain) {
+					peak1 *= m_attack;
+					peak1 += (1.0f - m_attack) * gain;
+				} else {
+					peak1 *= m_release;
+					peak1 += (1.0f - m_release) * gain;
+				}
+				gains[j] = peak1 * post_gain;
+			}
+			m_peak = peak1;
 			// output
-			*in++ = lo * m_peak * post_gain;
+			for (c = 0; c < N; ++c) {
+				float *out = ins[c] + i;
+				for (j = 0; j < n; ++j)
+					out[j] = buf[j][c] * gains[j];
+			}
 		}
 	}
 
-private:
-
 	float m_srate;
 
 	float m_peak;
 	float m_attack;
 	float m_release;
 
-	drumkv1_fx_filter m_lo, m_mi, m_hi;
+	drumkv1_fx_filter2 m_lo, m_mi, m_hi;
+
+	drumkv1_fx_noise m_noise;
+
+	drumkv1_fx_tail m_tail;
 };
 
 
 //-------------------------------------------------------------------------
-// drumkv1_fx_flanger - Flanger implementation.
-
+// drumkv1_fx_flanger - Flanger implementation (stereo pair).
+//
+//   Left/right lanes are interleaved in one ring buffer, which carries
+//   a few guard frames past its end so the interpolation reads never wrap.
 
 class drumkv1_fx_flanger
 {
@@ -307,65 +538,122 @@ public:
 
 	void reset()
 	{
-		for(uint32_t i = 0; i < MAX_SIZE; ++i)
+		for (uint32_t i = 0; i < 2 * (MAX_SIZE + GUARD); ++i)
 			m_buffer[i] = 0.0f;
 
 		m_frames = 0;
-	}
 
-	float output(float in, float delay, float feedb)
-	{
-		// calculate delay offset
-		float delta = float(m_frames) - delay;
-		// clip lookback buffer-bound
-		if (delta < 0.0f)
-			delta += float(MAX_SIZE);
-		// get index
-		const uint32_t index = uint32_t(delta);
-		// 4 samples hermite
-		const float y0 = m_buffer[(index + 0) & MAX_MASK];
-		const float y1 = m_buffer[(index + 1) & MAX_MASK];
-		const float y2 = m_buffer[(index + 2) & MAX_MASK];
-		const float y3 = m_buffer[(index + 3) & MAX_MASK];
-		// csi calculate
-		const float c0 = y1;
-		const float c1 = 0.5f * (y2 - y0);
-		const float c2 = y0 - 2.5f * y1 + 2.0f * y2 - 0.5f * y3;
-		const float c3 = 0.5f * (y3 - y0) + 1.5f * (y1 - y2);
-		// compute interpolation x
-		const float x = delta - ::floorf(delta);
-		// get output
-		const float out = ((c3 * x + c2) * x + c1) * x + c0;
-		// add to delay buffer
-		m_buffer[(m_frames++) & MAX_MASK] = in + out * feedb;
-		// return output
-		return out;
+		m_tail.reset();
 	}
 
-	void process(float *in, uint32_t nframes,
-		float wet, float delay, float feedb, float daft)
+	bool idle() const
+		{ return m_tail.idle(); }
+
+	// in1 may be null (mono).
+	void process(float *in0, float *in1, uint32_t nframes,
+		float wet, float delay, float feedb, float daft0, float daft1)
 	{
-		if (wet < 1E-9f)
+		if (wet < 1E-9f) {
+			m_tail.reset();
 			return;
-		// daft effect
-		if (daft > 0.001f) {
-			delay *= (1.0f - daft);
-		//	feedb *= (1.0f - daft);
 		}
-		delay *= float(MAX_SIZE);
-		// process
-		for (uint32_t i = 0; i < nframes; ++i)
-			in[i] += wet * output(in[i], delay, feedb);
+		// silent input and no tail left?
+		if (!m_tail.active(in0, in1, nframes, MAX_SIZE))
+			return;
+		// daft effect
+		float delays[2] = { delay, delay };
+		if (daft0 > 0.001f)
+			delays[0] *= (1.0f - daft0);
+		if (daft1 > 0.001f)
+			delays[1] *= (1.0f - daft1);
+		delays[0] *= float(MAX_SIZE);
+		delays[1] *= float(MAX_SIZE);
+		// process (constant delay)
+		float *ins[2] = { in0, in1 };
+		float level;
+		if (in1)
+			level = process_lanes<2>(ins, nframes, wet, &delays[0], &delays[1], 0, feedb);
+		else
+			level = process_lanes<1>(ins, nframes, wet, &delays[0], &delays[1], 0, feedb);
+		// tail state (delay line level)
+		m_tail.ringing(level, nframes, MAX_SIZE);
+		m_tail.tick(nframes);
+	}
+
+	// modulated process, per-frame delay curves (no tail tracking);
+	// returns the delay line output peak level.
+	float modulate(float *in0, float *in1, uint32_t nframes,
+		float wet, const float *delay0, const float *delay1, float feedb)
+	{
+		float *ins[2] = { in0, in1 };
+		if (in1)
+			return process_lanes<2>(ins, nframes, wet, delay0, delay1, 1, feedb);
+		else
+			return process_lanes<1>(ins, nframes, wet, delay0, delay1, 1, feedb);
 	}
 
 	static const uint32_t MAX_SIZE = (1 << 12);	//= 4096;
 	static const uint32_t MAX_MASK = MAX_SIZE - 1;
 
+protected:
+
+	static const uint32_t GUARD = 3;
+
+	template <uint16_t N>
+	float process_lanes(float **ins, uint32_t nframes, float wet,
+		const float *delay0, const float *delay1, uint32_t dstep, float feedb)
+	{
+		float level = 0.0f;
+		const float *delays[2] = { delay0, delay1 };
+		for (uint32_t i = 0; i < nframes; ++i) {
+			const uint32_t j = (m_frames++) & MAX_MASK;
+			float outs[2];
+			for (uint16_t c = 0; c < N; ++c) {
+				// calculate delay offset
+				float delta = float(j) - delays[c][i * dstep];
+				// clip lookback buffer-bound
+				if (delta < 0.0f)
+					delta += float(MAX_SIZE);
+				// get index (wrap-free, guarded reads)
+				uint32_t index = uint32_t(delta);
+				if (index >= MAX_SIZE)
+					index -= MAX_SIZE;
+				const float *y = &m_buffer[2 * index + c];
+				// 4 samples hermite
+				const float y0 = y[0];
+				const float y1 = y[2];
+				const float y2 = y[4];
+				const float y3 = y[6];
+				// csi calculate
+				const float c0 = y1;
+				const float c1 = 0.5f * (y2 - y0);
+				const float c2 = y0 - 2.5f * y1 + 2.0f * y2 - 0.5f * y3;
+				const float c3 = 0.5f * (y3 - y0) + 1.5f * (y1 - y2);
+				// compute interpolation x
+				const float x = delta - ::floorf(delta);
+				// get output
+				outs[c] = ((c3 * x + c2) * x + c1) * x + c0;
+			}
+			for (uint16_t c = 0; c < N; ++c) {
+				// add to delay buffer (and its guard mirror)
+				const float in = ins[c][i];
+				m_buffer[2 * j + c] = in + outs[c] * feedb;
+				if (j < GUARD)
+					m_buffer[2 * (MAX_SIZE + j) + c] = m_buffer[2 * j + c];
+				ins[c][i] = in + wet * outs[c];
+				level = (level > ::fabsf(outs[c]) ? level : ::fabsf(outs[c]));
+			}
+		}
+		return level;
+	}
+
 private:
 
-	float m_buffer[MAX_SIZE];
+	float m_buffer[2 * (MAX_SIZE + GUARD)];
 
 	uint32_t m_frames;
+
+	drumkv1_fx_tail m_tail;
 };
 
 
@@ -386,16 +674,26 @@ public:
 
 	void reset()
 	{
-		m_flang1.reset();
-		m_flang2.reset();
+		m_flang.reset();
 
 		m_lfo = 0.0f;
+
+		m_tail.reset();
 	}
 
+	bool idle() const
+		{ return m_tail.idle(); }
+
 	void process(float *in1, float *in2, uint32_t nframes,
 		float wet, float delay, float feedb, float rate, float mod)
 	{
-		if (wet < 1E-9f)
+		if (wet < 1E-9f) {
+			m_tail.reset();
+			return;
+		}
+		// silent input and no tail left?
+		const uint32_t nhold = drumkv1_fx_flanger::MAX_SIZE;
+		if (!m_tail.active(in1, in2, nframes, nhold))
 			return;
 		// constrained feedback
 		feedb *= 0.95f;
@@ -403,25 +701,38 @@ public:
 		const float d0 = 0.5f * delay * float(drumkv1_fx_flanger::MAX_SIZE);
 		const float a1 = 0.99f * d0 * mod * mod;
 		const float r2 = 4.0f * M_PI * rate * rate / m_srate;
-		// process
-		for (uint32_t i = 0; i < nframes; ++i) {
-			// modulation
-			const float lfo = a1 * pseudo_sinf(m_lfo);
-			const float delay1 = d0 - lfo;
-			const float delay2 = d0 - lfo * 0.9f;
+		// process in chunks
+		float delay1[NBLOCK];
+		float delay2[NBLOCK];
+		float level = 0.0f;
+		for (uint32_t i = 0; i < nframes; i += NBLOCK) {
+			const uint32_t n = (nframes - i < NBLOCK ? nframes - i : NBLOCK);
+			// modulation curves
+			for (uint32_t j = 0; j < n; ++j) {
+				const float lfo = a1 * pseudo_sinf(m_lfo);
+				delay1[j] = d0 - lfo;
+				delay2[j] = d0 - lfo * 0.9f;
+				// lfo advance
+				m_lfo += r2;
+				// lfo wrap
+				if (m_lfo >= 1.0f)
+					m_lfo -= 2.0f;
+			}
 			// chorus mix
-			in1[i] += wet * m_flang1.output(in1[i], delay1, feedb);
-			in2[i] += wet * m_flang2.output(in2[i], delay2, feedb);
-			// lfo advance
-			m_lfo += r2;
-			// lfo wrap
-			if (m_lfo >= 1.0f)
-				m_lfo -= 2.0f;
+			const float peak = m_flang.modulate(
+				in1 + i, in2 + i, n, wet, delay1, delay2, feedb);
+			if (level < peak)
+				level = peak;
 		}
+		// tail state (delay line level)
+		m_tail.ringing(level, nframes, nhold);
+		m_tail.tick(nframes);
 	}
 
 protected:
 
+	static const uint32_t NBLOCK = 64;
+
 	float pseudo_sinf(float x) const
 	{
 		x *= x;
@@ -433,15 +744,19 @@ private:
 
 	float m_srate;
 
-	drumkv1_fx_flanger m_flang1;
-	drumkv1_fx_flanger m_flang2;
+	drumkv1_fx_flanger m_flang;
 
 	float m_lfo;
+
+	drumkv1_fx_tail m_tail;
 };
 
 
 //-------------------------------------------------------------------------
-// drumkv1_fx_delay - Delay implementation.
+// drumkv1_fx_delay - Delay implementation (stereo pair).
+//
+//   Left/right lanes are interleaved in one ring buffer and processed
+//   in contiguous runs, split where either the read or write pointer wraps.
 
 class drumkv1_fx_delay
 {
@@ -457,18 +772,25 @@ public:
 
 	void reset()
 	{
-		for (uint32_t i = 0; i < MAX_SIZE; ++i)
+		for (uint32_t i = 0; i < 2 * MAX_SIZE; ++i)
 			m_buffer[i] = 0.0f;
 
-		m_out = 0.0f;
 		m_frames = 0;
+
+		m_tail.reset();
 	}
 
-	void process(float *in, uint32_t nframes,
+	bool idle() const
+		{ return m_tail.idle(); }
+
+	// in1 may be null (mono).
+	void process(float *in0, float *in1, uint32_t nframes,
 		float wet, float delay, float feedb, float bpm = 0.0f)
 	{
-		if (wet < 1E-9f)
+		if (wet < 1E-9f) {
+			m_tail.reset();
 			return;
+		}
 		// constrained feedback
 		feedb *= 0.95f;
 		// calculate delay time
@@ -483,59 +805,78 @@ public:
 		else
 		if (ndelay > MAX_SIZE)
 			ndelay = MAX_SIZE;
+		// silent input and no tail left?
+		if (!m_tail.active(in0, in1, nframes, ndelay))
+			return;
 		// delay process
-		for (uint32_t i = 0; i < nframes; ++i) {
-			const uint32_t j = (m_frames++) & MAX_MASK;
-			m_out = m_buffer[(j - ndelay) & MAX_MASK];
-			m_buffer[j] = *in + m_out * feedb;
-			*in++ += wet * m_out;
-		}
+		float *ins[2] = { in0, in1 };
+		float level;
+		if (in1)
+			level = process_lanes<2>(ins, nframes, wet, ndelay, feedb);
+		else
+			level = process_lanes<1>(ins, nframes, wet, ndelay, feedb);
+		// tail state (delay line level)
+		m_tail.ringing(level, nframes, ndelay);
+		m_tail.tick(nframes);
 	}
 
 	static const uint32_t MIN_SIZE = (1 <<  8);	//= 256;
 	static const uint32_t MAX_SIZE = (1 << 16);	//= 65536;
 	static const uint32_t MAX_MASK = MAX_SIZE - 1;
 
+protected:
+
+	// returns the delay line output peak level.
+	template <uint16_t N>
+	float process_lanes(float **ins, uint32_t nframes,
+		float wet, uint32_t ndelay, float feedb)
+	{
+		float level = 0.0f;
+		uint32_t j = m_frames & MAX_MASK;
+		uint32_t i = 0;
+		while (i < nframes) {
+			const uint32_t r = (j - ndelay) & MAX_MASK;
+			// wrap-free run length
+			uint32_t n = nframes - i;
+			if (n > MAX_SIZE - j)
+				n = MAX_SIZE - j;
+			if (n > MAX_SIZE - r)
+				n = MAX_SIZE - r;
+			float *w = &m_buffer[2 * j];
+			const float *q = &m_buffer[2 * r];
+			for (uint16_t c = 0; c < N; ++c) {
+				float *in = ins[c] + i;
+				for (uint32_t l = 0; l < n; ++l) {
+					const float out = q[2 * l + c];
+					w[2 * l + c] = in[l] + out * feedb;
+					in[l] += wet * out;
+					level = (level > ::fabsf(out) ? level : ::fabsf(out));
+				}
+			}
+			i += n;
+			j = (j + n) & MAX_MASK;
+		}
+		m_frames += nframes;
+		return level;
+	}
+
 private:
 
 	float m_srate;
 
-	float m_buffer[MAX_SIZE];
-	float m_out;
+	float m_buffer[2 * MAX_SIZE];
 
 	uint32_t m_frames;
-};
-
-
-//-------------------------------------------------------------------------
-// drumkv1_fx_allpass - All-pass delay implementation.
-
-class drumkv1_fx_allpass
-{
-public:
-
-	drumkv1_fx_allpass()
-		{ reset(); }
-
-	void reset()
-		{ m_out = 0.0f; }
-
-	float output(float in, float delay)
-	{
-		const float a1 = (1.0f - delay) / (1.0f + delay);
-		const float out = m_out - a1 * in;
-		m_out = in + a1 * out;
-		return out;
-	}
-
-private:
 
-	float m_out;
+	drumkv1_fx_tail m_tail;
 };
 
 
 //-------------------------------------------------------------------------
-// drumkv1_fx_phaser - Phaser implementation.
+// drumkv1_fx_phaser - Phaser implementation (stereo pair).
+//
+//   The all-pass coefficient curves are computed once per chunk,
+//   shared by all the taps; lane state is kept side by side.
 
 class drumkv1_fx_phaser
 {
@@ -551,70 +892,131 @@ public:
 
 	void reset()
 	{
-		// initialize vars
-		m_lfo_phase = 0.0f;
-		m_out = 0.0f;
-		// reset taps
-		for (uint16_t n = 0; n < MAX_TAPS; ++n)
-			m_taps[n].reset();
+		for (uint16_t c = 0; c < 2; ++c) {
+			// initialize vars
+			m_lfo_phase[c] = 0.0f;
+			m_out[c] = 0.0f;
+			// reset taps
+			for (uint16_t n = 0; n < MAX_TAPS; ++n)
+				m_taps[n][c] = 0.0f;
+		}
+		// reset tail
+		m_tail.reset();
 	}
 
-	void process(float *in, uint32_t nframes, float wet,
-		float rate, float feedb, float depth, float daft)
+	bool idle() const
+		{ return m_tail.idle(); }
+
+	// in1 may be null (mono).
+	void process(float *in0, float *in1, uint32_t nframes, float wet,
+		float rate, float feedb, float depth, float daft0, float daft1)
 	{
-		if (wet < 1E-9f)
+		if (wet < 1E-9f) {
+			m_tail.reset();
 			return;
-		// daft effect
-		if (daft > 0.001f && daft < 1.0f) {
-			rate  *= (1.0f - 0.5f * daft);
-		//	feedb *= (1.0f - daft);
-			depth *= (1.0f - daft);
 		}
-		depth += 1.0f;
+		// silent input and no tail left? (feedback ring)
+		if (!m_tail.active(in0, in1, nframes, uint32_t(0.5f * m_srate)))
+			return;
+		m_tail.tick(nframes);
+		// process lanes
+		float *ins[2] = { in0, in1 };
+		const float dafts[2] = { daft0, daft1 };
+		if (in1)
+			process_lanes<2>(ins, nframes, wet, rate, feedb, depth, dafts);
+		else
+			process_lanes<1>(ins, nframes, wet, rate, feedb, depth, dafts);
+	}
+
+protected:
+
+	template <uint16_t N>
+	void process_lanes(float **ins, uint32_t nframes, float wet,
+		float rate, float feedb, float depth, const float *dafts)
+	{
+		uint16_t c;
 		// update coeffs
 		const float delay_min = 2.0f * 440.0f / m_srate;
 		const float delay_max = 2.0f * 4400.0f / m_srate;
-		const float lfo_inc   = 2.0f * M_PI * rate / m_srate;
-		// anti-denormal noise
-		const float adenormal = 1E-14f * float(::rand());
-		// sweep...
-		for (uint32_t i = 0; i < nframes; ++i) {
-			// calculate and update phaser lfo
-			const float delay = delay_min + (delay_max - delay_min)
-				* 0.5f * (1.0f + ::sinf(m_lfo_phase));
-			// increment phase
-			m_lfo_phase += lfo_inc;
-			// positive wrap phase
-			if (m_lfo_phase >= 2.0f * M_PI)
-				m_lfo_phase -= 2.0f * M_PI;
-			// get input
-			m_out = in[i] + adenormal + m_out * feedb;
-			// update filter coeffs and calculate output
-			for (uint16_t n = 0; n < MAX_TAPS; ++n)
-				m_out = m_taps[n].output(m_out, delay);
-			// output
-			in[i] += wet * m_out * depth;
+		float lfo_inc[2], depths[2], adenormal[2];
+		for (c = 0; c < N; ++c) {
+			float rate1  = rate;
+			float depth1 = depth;
+			// daft effect
+			const float daft = dafts[c];
+			if (daft > 0.001f && daft < 1.0f) {
+				rate1  *= (1.0f - 0.5f * daft);
+			//	feedb  *= (1.0f - daft);
+				depth1 *= (1.0f - daft);
+			}
+			depths[c]  = depth1 + 1.0f;
+			lfo_inc[c] = 2.0f * M_PI * rate1 / m_srate;
+			// anti-denormal noise
+			adenormal[c] = m_noise.adenormal();
+		}
+		// sweep, in chunks...
+		float a1s[NBLOCK][2];
+		for (uint32_t i = 0; i < nframes; i += NBLOCK) {
+			const uint32_t n = (nframes - i < NBLOCK ? nframes - i : NBLOCK);
+			// all-pass coefficient curves
+			for (c = 0; c < N; ++c) {
+				float phase = m_lfo_phase[c];
+				for (uint32_t j = 0; j < n; ++j) {
+					// calculate and update phaser lfo
+					const float delay = delay_min + (delay_max - delay_min)
+						* 0.5f * (1.0f + ::sinf(phase));
+					a1s[j][c] = (1.0f - delay) / (1.0f + delay);
+					// increment phase
+					phase += lfo_inc[c];
+					// positive wrap phase
+					if (phase >= 2.0f * M_PI)
+						phase -= 2.0f * M_PI;
+				}
+				m_lfo_phase[c] = phase;
+			}
+			// all-pass taps
+			for (uint32_t j = 0; j < n; ++j) {
+				float out[2];
+				for (c = 0; c < N; ++c) {
+					// get input
+					out[c] = ins[c][i + j] + adenormal[c] + m_out[c] * feedb;
+				}
+				// calculate output
+				for (uint16_t k = 0; k < MAX_TAPS; ++k) {
+					for (c = 0; c < N; ++c) {
+						const float a1 = a1s[j][c];
+						const float y = m_taps[k][c] - a1 * out[c];
+						m_taps[k][c] = out[c] + a1 * y;
+						out[c] = y;
+					}
+				}
+				for (c = 0; c < N; ++c) {
+					m_out[c] = out[c];
+					// output
+					ins[c][i + j] += wet * out[c] * depths[c];
+				}
+			}
 		}
 	}
 
+	static const uint32_t NBLOCK = 64;
+
 private:
 
 	float m_srate;
 
 	static const uint16_t MAX_TAPS = 6;
 
-	drumkv1_fx_allpass m_taps[MAX_TAPS];
+	float m_taps[MAX_TAPS][2];
 
-	float m_dmin;
-	float m_dmax;
-	float m_feedb;
-	float m_lfo_phase;
-	float m_lfo_inc;
-	float m_depth;
+	float m_lfo_phase[2];
 
-	float m_out;
-};
+	float m_out[2];
+
+	drumkv1_fx_noise m_noise;
 
+	drumkv1_fx_tail m_tail;
+};
 
 #endif	// __drumkv1_fx_h
 
@@ -25,6 +25,8 @@
 
 #include "drumkv1_programs.h"
 #include "drumkv1_controls.h"
+#include "drumkv1_denormal.h"
+#include "drumkv1_load.h"
 
 #include <jack/midiport.h>
 
@@ -208,6 +210,9 @@ int drumkv1_jack::process ( jack_nframes_t nframes )
 	if (!m_activated)
 		return 0;
 
+	const drumkv1_denormal denormal;
+	const drumkv1_load::Cycle cycle(drumkv1::load(), nframes);
+
 	const uint16_t nchannels = drumkv1::channels();
 	float **ins = m_ins, **outs = m_outs;
 	for (uint16_t k = 0; k < nchannels; ++k) {
@@ -390,6 +395,8 @@ void drumkv1_jack::open ( const char *client_name )
 void drumkv1_jack::activate (void)
 {
 	if (!m_activated) {
+		if (m_client)
+			drumkv1::setActive(true);
 		drumkv1::reset();
 		if (m_client) {
 			::jack_activate(m_client);
@@ -405,6 +412,7 @@ void drumkv1_jack::deactivate (void)
 			m_activated = false;
 			::jack_deactivate(m_client);
 		}
+		drumkv1::setActive(false);
 	}
 }
 
@@ -688,6 +696,8 @@ void drumkv1_jack::shutdown_close (void)
 {
 	m_activated = false;
 
+	drumkv1::setActive(false);
+
 	if (m_client) {
 		::jack_client_close(m_client);
 		m_client = nullptr;
@@ -718,6 +728,10 @@ void drumkv1_jack::shutdown_close (void)
 #include "drumkv1_nsm.h"
 #endif
 
+#ifdef CONFIG_LIBLO
+#include "drumkv1_osc.h"
+#endif
+
 
 #ifdef HAVE_SIGNAL_H
 
@@ -749,6 +763,9 @@ drumkv1_jack_application::drumkv1_jack_application ( int& argc, char **argv )
 	  #ifdef CONFIG_NSM
 		, m_pNsmClient(nullptr)
 	  #endif
+	  #ifdef CONFIG_LIBLO
+		, m_pOscService(nullptr)
+	  #endif
 {
 #ifdef Q_WS_X11
 	m_bGui = (::getenv("DISPLAY") != 0);
@@ -842,6 +859,9 @@ drumkv1_jack_application::~drumkv1_jack_application (void)
 #endif
 #ifdef CONFIG_NSM
 	if (m_pNsmClient) delete m_pNsmClient;
+#endif
+#ifdef CONFIG_LIBLO
+	if (m_pOscService) delete m_pOscService;
 #endif
 	if (m_pWidget) delete m_pWidget;
 	if (m_pDrumk) delete m_pDrumk;
@@ -880,6 +900,10 @@ bool drumkv1_jack_application::parse_args (void)
 	parser.addOption({{"n", "client-name"},
 		QObject::tr("Set the JACK client name (default: %1)")
 			.arg(DRUMKV1_TITLE), "label"});
+#ifdef CONFIG_LIBLO
+	parser.addOption({{"o", "osc-port"},
+		QObject::tr("Enable the OSC monitor service on port"), "port"});
+#endif
 	parser.addHelpOption();
 	parser.addVersionOption();
 	parser.addPositionalArgument("preset-file",
@@ -900,6 +924,17 @@ bool drumkv1_jack_application::parse_args (void)
 		m_sClientName = sVal;
 	}
 
+#ifdef CONFIG_LIBLO
+	if (parser.isSet("osc-port")) {
+		const QString& sVal = parser.value("osc-port");
+		if (sVal.isEmpty()) {
+			show_error(QObject::tr("Option -o requires an argument (port)."));
+			return false;
+		}
+		m_sOscPort = sVal;
+	}
+#endif
+
 	foreach(const QString& sArg, parser.positionalArguments()) {
 		m_presets.append(sArg);
 	}
@@ -934,6 +969,18 @@ bool drumkv1_jack_application::parse_args (void)
 			if (iEqual < 0)
 				++i;
 		}
+	#ifdef CONFIG_LIBLO
+		else
+		if (sArg == "-o" || sArg == "--osc-port") {
+			if (sVal.isNull()) {
+				out << QObject::tr("Option -o requires an argument (port).\n\n");
+				return false;
+			}
+			m_sOscPort = sVal;
+			if (iEqual < 0)
+				++i;
+		}
+	#endif
 		else
 		if (sArg == "-h" || sArg == "--help") {
 			const QString sEot = "\n\t";
@@ -945,6 +992,10 @@ bool drumkv1_jack_application::parse_args (void)
 				QObject::tr("Disable the graphical user interface (GUI)") + sEol;
 			out << "  -n, --client-name=[label]" + sEot +
 				QObject::tr("Set the JACK client name (default: %1)").arg(DRUMKV1_TITLE) + sEol;
+		#ifdef CONFIG_LIBLO
+			out << "  -o, --osc-port=[port]" + sEot +
+				QObject::tr("Enable the OSC monitor service on port") + sEol;
+		#endif
 			out << "  -h, --help" + sEot +
 				QObject::tr("Show help about command line options.") + sEol;
 			out << "  -v, --version" + sEot +
@@ -1010,6 +1061,21 @@ bool drumkv1_jack_application::setup (void)
 	if (!m_presets.isEmpty())
 		drumkv1_param::loadPreset(m_pDrumk, m_presets.first());
 
+#ifdef CONFIG_LIBLO
+	// Start the OSC monitor service, if asked...
+	if (!m_sOscPort.isEmpty()) {
+		m_pOscService = new drumkv1_osc(m_pDrumk, m_sOscPort);
+		if (m_pOscService->is_active()) {
+			const QByteArray tmp = m_pOscService->url().toUtf8() + '\n';
+			::fputs(tmp.constData(), stdout);
+		} else {
+			const QByteArray tmp = QObject::tr("OSC port %1 unavailable.")
+				.arg(m_sOscPort).toUtf8() + '\n';
+			::fputs(tmp.constData(), stderr);
+		}
+	}
+#endif
+
 #ifdef CONFIG_NSM
 	// Check whether to participate into a NSM session...
 	const QString& nsm_url
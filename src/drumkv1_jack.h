@@ -128,6 +128,10 @@ class drumkv1widget_jack;
 class drumkv1_nsm;
 #endif
 
+#ifdef CONFIG_LIBLO
+class drumkv1_osc;
+#endif
+
 #ifdef HAVE_SIGNAL_H
 class QSocketNotifier;
 #endif
@@ -194,6 +198,10 @@ private:
 	QString m_sClientName;
 	QStringList m_presets;
 
+#ifdef CONFIG_LIBLO
+	QString m_sOscPort;
+#endif
+
 	drumkv1_jack *m_pDrumk;
 	drumkv1widget_jack *m_pWidget;
 
@@ -201,6 +209,10 @@ private:
 	drumkv1_nsm *m_pNsmClient;
 #endif
 
+#ifdef CONFIG_LIBLO
+	drumkv1_osc *m_pOscService;
+#endif
+
 #ifdef HAVE_SIGNAL_H
 	QSocketNotifier *m_pSigtermNotifier;
 #endif
@@ -0,0 +1,213 @@
+// drumkv1_load.cpp
+//
+/****************************************************************************
+   Copyright (C) 2012-2021, rncbc aka Rui Nuno Capela. All rights reserved.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*****************************************************************************/
+
+#include "drumkv1_load.h"
+
+#include <cstring>
+
+#if defined(_WIN32)
+#include <chrono>
+#else
+#include <time.h>
+#endif
+
+
+// smoothing and peak release times (secs).
+#define DRUMKV1_LOAD_AVERAGE 0.5f
+#define DRUMKV1_LOAD_RELEASE 2.0f
+
+
+//-------------------------------------------------------------------------
+// drumkv1_load::Stats - reader side statistics.
+//
+
+void drumkv1_load::Stats::reset (void)
+{
+	cycles = 0;
+	overruns = 0;
+	load = 0.0f;
+	peak = 0.0f;
+
+	for (uint32_t i = 0; i < NumStages; ++i)
+		stages[i] = 0.0f;
+	for (uint32_t i = 0; i < NumBins; ++i)
+		bins[i] = 0;
+}
+
+
+//-------------------------------------------------------------------------
+// drumkv1_load - DSP load meter (per-stage cycle timing).
+//
+
+// ctor.
+drumkv1_load::drumkv1_load (void)
+	: m_srate(44100.0f), m_nsecs(0.0f), m_cycle(false),
+		m_begin(0), m_stamp(0), m_average(0.0f), m_peak(0.0f), m_overruns(0), m_iwrite(0)
+{
+	::memset(&m_block, 0, sizeof(m_block));
+	::memset(m_blocks, 0, sizeof(m_blocks));
+
+	for (uint32_t i = 0; i < NumStages; ++i)
+		m_stages[i] = 0.0f;
+
+	setSampleRate(m_srate);
+}
+
+
+// deadline reference.
+void drumkv1_load::setSampleRate ( float srate )
+{
+	if (srate > 0.0f) {
+		m_srate = srate;
+		m_nsecs = 1E+9f / srate;
+	}
+}
+
+
+// monotonic clock (nanoseconds).
+uint64_t drumkv1_load::now (void)
+{
+#if defined(_WIN32)
+	return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds> (
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+#else
+	struct timespec ts;
+	::clock_gettime(CLOCK_MONOTONIC, &ts);
+	return uint64_t(ts.tv_sec) * 1000000000ULL + uint64_t(ts.tv_nsec);
+#endif
+}
+
+
+// audio thread: cycle open.
+void drumkv1_load::begin ( uint32_t nframes )
+{
+	m_block.frames = nframes;
+	m_block.deadline = uint32_t(float(nframes) * m_nsecs);
+	m_block.total = 0;
+
+	for (uint32_t i = 0; i < NumStages; ++i)
+		m_block.stages[i] = 0;
+
+	m_begin = m_stamp = now();
+	m_cycle = true;
+}
+
+
+// audio thread: cycle close.
+void drumkv1_load::end (void)
+{
+	if (!m_cycle)
+		return;
+
+	m_cycle = false;
+
+	m_block.total = uint32_t(now() - m_begin);
+
+	const uint32_t iwrite = m_iwrite.load(std::memory_order_relaxed);
+	m_blocks[iwrite & (NumBlocks - 1)] = m_block;
+	m_iwrite.store(iwrite + 1, std::memory_order_release);
+
+	if (m_block.deadline < 1)
+		return;
+
+	if (m_block.total > m_block.deadline) {
+		m_overruns.store(m_overruns.load(std::memory_order_relaxed) + 1,
+			std::memory_order_relaxed);
+	}
+
+	// smoothed load, decaying peak and stages...
+	const float scale = 100.0f / float(m_block.deadline);
+	const float load = scale * float(m_block.total);
+	const float secs = float(m_block.frames) / m_srate;
+	float a = secs / DRUMKV1_LOAD_AVERAGE;
+	if (a > 1.0f)
+		a = 1.0f;
+	m_average += a * (load - m_average);
+	for (uint32_t i = 0; i < NumStages; ++i)
+		m_stages[i] += a * (scale * float(m_block.stages[i]) - m_stages[i]);
+	float r = 1.0f - secs / DRUMKV1_LOAD_RELEASE;
+	if (r < 0.0f)
+		r = 0.0f;
+	m_peak *= r;
+	if (m_peak < load)
+		m_peak = load;
+}
+
+
+// reader side: fold in all cycles since the last update.
+uint32_t drumkv1_load::update ( Stats& stats ) const
+{
+	const uint32_t iwrite = m_iwrite.load(std::memory_order_acquire);
+
+	uint32_t index = stats.index;
+	if (iwrite - index > NumBlocks)
+		index = iwrite - NumBlocks; // lapped: skip the lost ones.
+
+	uint64_t deadline = 0;
+	uint64_t total = 0;
+	uint64_t stages[NumStages];
+	for (uint32_t i = 0; i < NumStages; ++i)
+		stages[i] = 0;
+
+	uint32_t ncycles = 0;
+
+	for ( ; index != iwrite; ++index) {
+		const Block block = m_blocks[index & (NumBlocks - 1)];
+		// might have been overwritten while copying...
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (m_iwrite.load(std::memory_order_relaxed) - index >= NumBlocks)
+			continue;
+		if (block.deadline < 1)
+			continue;
+		const float load = 100.0f * float(block.total) / float(block.deadline);
+		uint32_t bin = NumBins - 1;
+		if (block.total > block.deadline)
+			++stats.overruns;
+		else
+		if (load < 100.0f)
+			bin = uint32_t(load / 10.0f);
+		else
+			bin = NumBins - 2;
+		++stats.bins[bin];
+		if (stats.peak < load)
+			stats.peak = load;
+		deadline += block.deadline;
+		total += block.total;
+		for (uint32_t i = 0; i < NumStages; ++i)
+			stages[i] += block.stages[i];
+		++ncycles;
+	}
+
+	stats.index = index;
+
+	if (ncycles > 0) {
+		stats.cycles += ncycles;
+		const float scale = 100.0f / float(deadline);
+		stats.load = scale * float(total);
+		for (uint32_t i = 0; i < NumStages; ++i)
+			stats.stages[i] = scale * float(stages[i]);
+	}
+
+	return ncycles;
+}
+
+
+// end of drumkv1_load.cpp
@@ -0,0 +1,160 @@
+// drumkv1_load.h
+//
+/****************************************************************************
+   Copyright (C) 2012-2021, rncbc aka Rui Nuno Capela. All rights reserved.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*****************************************************************************/
+
+#ifndef __drumkv1_load_h
+#define __drumkv1_load_h
+
+#include <atomic>
+
+#include <stdint.h>
+
+
+//-------------------------------------------------------------------------
+// drumkv1_load - DSP load meter (per-stage cycle timing).
+//
+//   A process cycle is opened and closed by the front-end (audio thread),
+//   the engine marks the end of each stage in between; per-cycle records
+//   go into a lock-free ring, read back by any number of other threads,
+//   each one keeping its own cursor and statistics (Stats).
+//
+
+class drumkv1_load
+{
+public:
+
+	// timed stages.
+	enum Stage { Voices = 0, Effects, Reverb, Mixdown, NumStages };
+
+	// per-cycle record (nanoseconds).
+	struct Block
+	{
+		uint32_t frames;
+		uint32_t deadline;
+		uint32_t total;
+		uint32_t stages[NumStages];
+	};
+
+	// load histogram: 10% wide bins, the last one counts overruns.
+	static const uint32_t NumBins = 11;
+
+	// reader side statistics.
+	struct Stats
+	{
+		Stats() : index(0) { reset(); }
+
+		void reset();
+
+		uint32_t index;		// ring cursor.
+		uint32_t cycles;	// since reset.
+		uint32_t overruns;	// since reset.
+		float load;			// mean %, since last update.
+		float peak;			// worst %, since reset.
+		float stages[NumStages];
+		uint32_t bins[NumBins];
+	};
+
+	// ctor.
+	drumkv1_load();
+
+	// deadline reference.
+	void setSampleRate(float srate);
+	float sampleRate() const
+		{ return m_srate; }
+
+	// audio thread: cycle open/close.
+	void begin(uint32_t nframes);
+	void end();
+
+	// audio thread: stage start stamp and end mark.
+	void start()
+		{ if (m_cycle) m_stamp = now(); }
+	void mark(Stage stage)
+	{
+		if (m_cycle) {
+			const uint64_t stamp = now();
+			m_block.stages[stage] += uint32_t(stamp - m_stamp);
+			m_stamp = stamp;
+		}
+	}
+
+	// audio thread: smoothed load, decaying peak and stages (%).
+	float average() const
+		{ return m_average; }
+	float peak() const
+		{ return m_peak; }
+	float stage(Stage stage) const
+		{ return m_stages[stage]; }
+
+	// cycles over deadline, so far (monotonic).
+	uint32_t overruns() const
+		{ return m_overruns.load(std::memory_order_relaxed); }
+
+	// reader side: fold in all cycles since the last update;
+	// returns the number of cycles read.
+	uint32_t update(Stats& stats) const;
+
+	// scoped process cycle (front-end).
+	class Cycle
+	{
+	public:
+
+		Cycle(drumkv1_load *pLoad, uint32_t nframes) : m_pLoad(pLoad)
+			{ m_pLoad->begin(nframes); }
+		~Cycle()
+			{ m_pLoad->end(); }
+
+	private:
+
+		drumkv1_load *m_pLoad;
+	};
+
+	// monotonic clock (nanoseconds).
+	static uint64_t now();
+
+private:
+
+	// ring size (power of two).
+	static const uint32_t NumBlocks = 256;
+
+	float m_srate;
+	float m_nsecs;		// nanoseconds per frame.
+
+	// audio thread state.
+	bool m_cycle;
+	uint64_t m_begin;
+	uint64_t m_stamp;
+	Block m_block;
+
+	float m_average;
+	float m_peak;
+	float m_stages[NumStages];
+
+	std::atomic<uint32_t> m_overruns;
+
+	// lock-free ring (single writer).
+	Block m_blocks[NumBlocks];
+	std::atomic<uint32_t> m_iwrite;
+};
+
+
+#endif	// __drumkv1_load_h
+
+// end of drumkv1_load.h
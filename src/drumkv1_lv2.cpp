@@ -28,6 +28,7 @@
 
 #include "drumkv1_programs.h"
 #include "drumkv1_controls.h"
+#include "drumkv1_denormal.h"
 
 #include "lv2/lv2plug.in/ns/ext/midi/midi.h"
 #include "lv2/lv2plug.in/ns/ext/time/time.h"
@@ -56,6 +57,10 @@
 #define LV2_STATE__StateChanged LV2_STATE_PREFIX "StateChanged"
 #endif
 
+#ifndef LV2_STATE__threadSafeRestore
+#define LV2_STATE__threadSafeRestore LV2_STATE_PREFIX "threadSafeRestore"
+#endif
+
 #ifndef LV2_ATOM__PortEvent
 #define LV2_ATOM__PortEvent LV2_ATOM_PREFIX "PortEvent"
 #endif
@@ -70,6 +75,15 @@
 #include <QDomDocument>
 #include <QFileInfo>
 
+#include <cmath>
+
+
+// notification rate limit (msecs, about the UI refresh period).
+#define DRUMKV1_LV2_NOTIFY_MSECS 33
+
+// port event value change threshold.
+#define DRUMKV1_LV2_PORT_EPSILON 1e-6f
+
 
 //-------------------------------------------------------------------------
 // drumkv1_lv2_map_path - abstract/absolute path functors.
@@ -142,7 +156,7 @@ typedef struct {
 
 drumkv1_lv2::drumkv1_lv2 (
 	double sample_rate, const LV2_Feature *const *host_features )
-	: drumkv1(2, float(sample_rate))
+	: drumkv1(2, float(sample_rate)), m_state(this), m_bDirty(true)
 {
 	::memset(&m_urids, 0, sizeof(m_urids));
 
@@ -150,8 +164,38 @@ drumkv1_lv2::drumkv1_lv2 (
 	m_atom_in  = nullptr;
 	m_atom_out = nullptr;
 	m_schedule = nullptr;
+
+	for (uint32_t i = 0; i < NUM_LOADS; ++i)
+		m_loads[i] = nullptr;
+	for (uint32_t i = 0; i < NUM_STATS; ++i)
+		m_stats[i] = nullptr;
 	m_ndelta   = 0;
 
+	for (uint32_t i = 0; i < drumkv1::NUM_ELEMENT_PARAMS; ++i)
+		m_dirty_params[i] = NAN; // never seen.
+	for (uint32_t i = 0; i < drumkv1::NUM_PARAMS; ++i)
+		m_port_params[i] = nullptr;
+
+	m_state_dirty = false;
+	m_notify_period = uint32_t(sample_rate * DRUMKV1_LV2_NOTIFY_MSECS) / 1000;
+	m_notify_frames = m_notify_period;
+
+#ifdef CONFIG_LV2_PATCH
+	::memset(m_patch_keys, 0, sizeof(m_patch_keys));
+	::memset(m_patch_values, 0, sizeof(m_patch_values));
+	m_patch_sent  = 0;
+	m_patch_dirty = 0;
+	m_patch_force = 0;
+#endif
+
+#ifdef CONFIG_LV2_PORT_EVENT
+	for (uint32_t i = 0; i < drumkv1::NUM_PARAMS; ++i) {
+		m_port_values[i] = NAN; // never sent.
+		m_port_dirty[i] = false;
+	}
+	m_port_pending = false;
+#endif
+
 	const LV2_Options_Option *host_options = nullptr;
 
 	for (int i = 0; host_features && host_features[i]; ++i) {
@@ -269,6 +313,17 @@ drumkv1_lv2::drumkv1_lv2 (
 
 	lv2_atom_forge_init(&m_forge, m_urid_map);
 
+#ifdef CONFIG_LV2_PATCH
+	m_patch_keys[0] = m_urids.p101_sample_file;
+	m_patch_keys[1] = m_urids.p102_offset_start;
+	m_patch_keys[2] = m_urids.p103_offset_end;
+	m_patch_keys[3] = m_urids.p201_tuning_enabled;
+	m_patch_keys[4] = m_urids.p202_tuning_refPitch;
+	m_patch_keys[5] = m_urids.p203_tuning_refNote;
+	m_patch_keys[6] = m_urids.p204_tuning_scaleFile;
+	m_patch_keys[7] = m_urids.p205_tuning_keyMapFile;
+#endif
+
 	const uint16_t nchannels = drumkv1::channels();
 	m_ins  = new float * [nchannels];
 	m_outs = new float * [nchannels];
@@ -306,7 +361,21 @@ void drumkv1_lv2::connect_port ( uint32_t port, void *data )
 		m_outs[1] = (float *) data;
 		break;
 	default:
-		drumkv1::setParamPort(drumkv1::ParamIndex(port - ParamBase), (float *) data);
+		if (port >= StatBase) {
+			if (port < StatBase + NUM_STATS)
+				m_stats[port - StatBase] = (float *) data;
+		}
+		else
+		if (port >= LoadBase) {
+			m_loads[port - LoadBase] = (float *) data;
+		}
+		else {
+			const drumkv1::ParamIndex index
+				= drumkv1::ParamIndex(port - ParamBase);
+			if (index < drumkv1::NUM_PARAMS)
+				m_port_params[index] = (float *) data;
+			drumkv1::setParamPort(index, (float *) data);
+		}
 		break;
 	}
 }
@@ -314,6 +383,11 @@ void drumkv1_lv2::connect_port ( uint32_t port, void *data )
 
 void drumkv1_lv2::run ( uint32_t nframes )
 {
+	const drumkv1_denormal denormal;
+
+	drumkv1_load *pLoad = drumkv1::load();
+	pLoad->begin(nframes);
+
 	const uint16_t nchannels = drumkv1::channels();
 	float *ins[nchannels], *outs[nchannels];
 	for (uint16_t k = 0; k < nchannels; ++k) {
@@ -327,6 +401,12 @@ void drumkv1_lv2::run ( uint32_t nframes )
 		lv2_atom_forge_sequence_head(&m_forge, &m_notify_frame, 0);
 	}
 
+	state_refresh();
+
+#ifdef CONFIG_LV2_PORT_EVENT
+	port_refresh();
+#endif
+
 	uint32_t ndelta = 0;
 
 	if (m_atom_in) {
@@ -470,9 +550,9 @@ void drumkv1_lv2::run ( uint32_t nframes )
 					lv2_atom_object_get(object,
 						m_urids.patch_property, (const LV2_Atom *) &prop, 0);
 					if (prop && prop->atom.type == m_forge.URID)
-						patch_get(prop->body);
+						patch_get(prop->body, true);
 					else
-						patch_get(0); // all
+						patch_get(0, true); // all
 				}
 			#endif	// CONFIG_LV2_PATCH
 			}
@@ -487,11 +567,48 @@ void drumkv1_lv2::run ( uint32_t nframes )
 
 	// test for current element-key/sample changes
 	drumkv1::currentElementTest();
+
+	// pending notifications, if any...
+	notify_flush(nframes);
+
+	// DSP load meter ports...
+	pLoad->end();
+
+	if (m_loads[LOAD1_DSP])
+		*m_loads[LOAD1_DSP] = pLoad->average();
+	if (m_loads[LOAD1_PEAK])
+		*m_loads[LOAD1_PEAK] = pLoad->peak();
+	for (uint32_t i = 0; i < drumkv1_load::NumStages; ++i) {
+		float *pfLoad = m_loads[LOAD1_STAGES + i];
+		if (pfLoad)
+			*pfLoad = pLoad->stage(drumkv1_load::Stage(i));
+	}
+
+	// runtime counters ports...
+	drumkv1::Counters counters;
+	drumkv1::counters(counters);
+
+	const uint32_t values[NUM_STATS] = {
+		counters.voices,
+		counters.peak_voices,
+		counters.alloc_failures,
+		counters.choke_cuts,
+		counters.fast_releases,
+		counters.cc_events,
+		counters.filtered,
+		counters.overruns
+	};
+
+	for (uint32_t i = 0; i < NUM_STATS; ++i) {
+		if (m_stats[i])
+			*m_stats[i] = float(values[i]);
+	}
 }
 
 
 void drumkv1_lv2::activate (void)
 {
+	drumkv1::setActive(true);
 	drumkv1::reset();
 }
 
@@ -499,6 +616,7 @@ void drumkv1_lv2::activate (void)
 void drumkv1_lv2::deactivate (void)
 {
 	drumkv1::reset();
+	drumkv1::setActive(false);
 }
 
 
@@ -560,7 +678,7 @@ static LV2_State_Status drumkv1_lv2_state_save ( LV2_Handle instance,
 	if (pPlugin == nullptr)
 		return LV2_STATE_ERR_UNKNOWN;
 
-	// Save all state as XML chunk...
+	// Save all state as binary chunk...
 	//
 	const uint32_t key = pPlugin->urid_map(DRUMKV1_LV2_PREFIX "state");
 	if (key == 0)
@@ -577,22 +695,8 @@ static LV2_State_Status drumkv1_lv2_state_save ( LV2_Handle instance,
 #endif
 	drumkv1_lv2_map_path mapPath(features);
 
-	QDomDocument doc(DRUMKV1_TITLE);
-	QDomElement eState = doc.createElement("state");
-
-	QDomElement eElements = doc.createElement("elements");
-	drumkv1_param::saveElements(pPlugin, doc, eElements, mapPath);
-	eState.appendChild(eElements);
-
-	if (pPlugin->isTuningEnabled()) {
-		QDomElement eTuning = doc.createElement("tuning");
-		drumkv1_param::saveTuning(pPlugin, doc, eTuning);
-		eState.appendChild(eTuning);
-	}
-
-	doc.appendChild(eState);
-
-	const QByteArray data(doc.toByteArray());
+	// same chunk as last time, if nothing changed...
+	const QByteArray& data = pPlugin->state_save(mapPath);
 	const char *value = data.constData();
 	size_t size = data.size();
 
@@ -608,7 +712,7 @@ static LV2_State_Status drumkv1_lv2_state_restore ( LV2_Handle instance,
 	if (pPlugin == nullptr)
 		return LV2_STATE_ERR_UNKNOWN;
 
-	// Retrieve all state as XML chunk...
+	// Retrieve all state as binary (or legacy XML) chunk...
 	//
 	const uint32_t key = pPlugin->urid_map(DRUMKV1_LV2_PREFIX "state");
 	if (key == 0)
@@ -639,8 +743,37 @@ static LV2_State_Status drumkv1_lv2_state_restore ( LV2_Handle instance,
 
 	drumkv1_lv2_map_path mapPath(features);
 
+	// may run() be called concurrently?
+	bool bThreadSafe = false;
+	for (int i = 0; features && features[i]; ++i) {
+		if (::strcmp(features[i]->URI, LV2_STATE__threadSafeRestore) == 0) {
+			bThreadSafe = true;
+			break;
+		}
+	}
+
+	const QByteArray data(value, size);
+
+	pPlugin->setDirty();
+
+	drumkv1_state *pState = pPlugin->state();
+
 	QDomDocument doc(DRUMKV1_TITLE);
-	if (doc.setContent(QByteArray(value, size))) {
+	if (drumkv1_state::isState(data)) {
+		// nothing to decode (nor concurrent run()): apply in place;
+		// otherwise decode off-thread and commit at a block boundary...
+		if (bThreadSafe || pState->isPending()
+			|| !pState->isLoaded(data, mapPath)) {
+			return (pState->schedule(data, mapPath)
+				? LV2_STATE_SUCCESS : LV2_STATE_ERR_UNKNOWN);
+		}
+		pState->load(data, mapPath);
+	}
+	else
+	if (doc.setContent(data)) {
+		// legacy: staged in place when run() may be concurrent.
+		if (bThreadSafe)
+			pPlugin->beginElements();
 		QDomElement eState = doc.documentElement();
 	#if 1//DRUMKV1_LV2_LEGACY
 		if (eState.tagName() == "elements")
@@ -661,6 +794,11 @@ static LV2_State_Status drumkv1_lv2_state_restore ( LV2_Handle instance,
 					drumkv1_param::loadTuning(pPlugin, eChild);
 			}
 		}
+		if (bThreadSafe) {
+			pPlugin->commitElements();
+			drumkv1_sched::sync_notify(pPlugin, drumkv1_sched::Sample, 1);
+			return LV2_STATE_SUCCESS;
+		}
 	}
 
 	pPlugin->reset();
@@ -718,6 +856,8 @@ void drumkv1_lv2::select_program ( uint32_t bank, uint32_t program )
 
 void drumkv1_lv2::updatePreset ( bool /*bDirty*/ )
 {
+	setDirty();
+
 	if (m_schedule /*&& bDirty*/) {
 		drumkv1_lv2_worker_message mesg;
 		mesg.atom.type = m_urids.state_StateChanged;
@@ -730,6 +870,8 @@ void drumkv1_lv2::updatePreset ( bool /*bDirty*/ )
 
 void drumkv1_lv2::updateParam ( drumkv1::ParamIndex index )
 {
+	setDirty();
+
 #ifdef CONFIG_LV2_PORT_EVENT
 	if (m_schedule) {
 		drumkv1_lv2_worker_message mesg;
@@ -747,6 +889,8 @@ void drumkv1_lv2::updateParam ( drumkv1::ParamIndex index )
 
 void drumkv1_lv2::updateParams (void)
 {
+	setDirty();
+
 #ifdef CONFIG_LV2_PORT_EVENT
 	if (m_schedule) {
 		drumkv1_lv2_worker_message mesg;
@@ -761,6 +905,8 @@ void drumkv1_lv2::updateParams (void)
 
 void drumkv1_lv2::updateSample (void)
 {
+	setDirty();
+
 	if (m_schedule) {
 		drumkv1_lv2_worker_message mesg;
 		mesg.atom.type = m_urids.gen1_update;
@@ -773,6 +919,8 @@ void drumkv1_lv2::updateSample (void)
 
 void drumkv1_lv2::updateOffsetRange (void)
 {
+	setDirty();
+
 	if (m_schedule) {
 		drumkv1_lv2_worker_message mesg;
 		mesg.atom.type = m_urids.p102_offset_start;
@@ -801,6 +949,8 @@ void drumkv1_lv2::selectSample ( int key )
 
 void drumkv1_lv2::updateTuning (void)
 {
+	setDirty();
+
 	if (m_schedule) {
 		drumkv1_lv2_worker_message mesg;
 		mesg.atom.type = m_urids.tun1_update;
@@ -858,8 +1008,10 @@ bool drumkv1_lv2::worker_response ( const void *data, uint32_t size )
 		port_events(drumkv1::NUM_ELEMENT_PARAMS);
 	else
 #endif
-	if (mesg->atom.type == m_urids.state_StateChanged)
-		return state_changed();
+	if (mesg->atom.type == m_urids.state_StateChanged) {
+		m_state_dirty = true;
+		return true;
+	}
 
 	// update all properties, and eventually, any observers...
 	drumkv1_sched::sync_notify(this, drumkv1_sched::Sample, 0);
@@ -874,7 +1026,8 @@ bool drumkv1_lv2::worker_response ( const void *data, uint32_t size )
 
 bool drumkv1_lv2::state_changed (void)
 {
-	lv2_atom_forge_frame_time(&m_forge, m_ndelta);
+	if (!lv2_atom_forge_frame_time(&m_forge, m_ndelta))
+		return false;
 
 	LV2_Atom_Forge_Frame frame;
 	lv2_atom_forge_object(&m_forge, &frame, 0, m_urids.state_StateChanged);
@@ -884,6 +1037,92 @@ bool drumkv1_lv2::state_changed (void)
 }
 
 
+// binary state chunk, re-encoded only when something changed
+// since last time, or when saved elsewhere (paths mapped otherwise).
+const QByteArray& drumkv1_lv2::state_save (
+	const drumkv1_param::map_path& mapPath )
+{
+	// save location probe: where the first sample file maps to...
+	QString sProbe;
+	for (int note = 0; note < 128 && sProbe.isEmpty(); ++note) {
+		drumkv1_element *element = drumkv1::element(note);
+		if (element && element->sampleFile())
+			sProbe = mapPath.abstractPath(
+				QString::fromUtf8(element->sampleFile()));
+	}
+
+	const bool bDirty = m_bDirty.exchange(false, std::memory_order_acq_rel);
+	if (!bDirty && sProbe == m_sDirtyProbe && !m_state.data().isEmpty())
+		return m_state.data();
+
+	m_sDirtyProbe = sProbe;
+
+	const QByteArray& data = m_state.save(mapPath,
+		drumkv1_state::Elements | drumkv1_state::Tuning);
+
+	// still loading? that's not the final state yet.
+	if (m_state.isPending())
+		setDirty();
+
+	return data;
+}
+
+
+// element param input ports moved since last run?
+// (host automation or plugin UI, all worth saving).
+void drumkv1_lv2::state_refresh (void)
+{
+	for (uint32_t i = 0; i < drumkv1::NUM_ELEMENT_PARAMS; ++i) {
+		const float *pfParam = m_port_params[i];
+		if (pfParam && *pfParam != m_dirty_params[i]) {
+			m_dirty_params[i] = *pfParam;
+			setDirty();
+		}
+	}
+}
+
+
+// coalesced notifications, at most once per UI refresh period
+// (explicit requests and state changes go out right away).
+void drumkv1_lv2::notify_flush ( uint32_t nframes )
+{
+	if (m_notify_frames < m_notify_period)
+		m_notify_frames += nframes;
+
+	if (m_atom_out == nullptr)
+		return;
+
+	bool bForce = m_state_dirty;
+#ifdef CONFIG_LV2_PATCH
+	if (m_patch_force)
+		bForce = true;
+#endif
+	if (!bForce && m_notify_frames < m_notify_period)
+		return;
+
+	bool bFlush = false;
+
+	if (m_state_dirty && state_changed()) {
+		m_state_dirty = false;
+		bFlush = true;
+	}
+
+#ifdef CONFIG_LV2_PATCH
+	if (m_patch_dirty && patch_flush())
+		bFlush = true;
+#endif
+
+#ifdef CONFIG_LV2_PORT_EVENT
+	if (m_port_pending && port_flush())
+		bFlush = true;
+#endif
+
+	// restart rate limit period, only if anything was sent.
+	if (bFlush)
+		m_notify_frames = 0;
+}
+
+
 #ifdef CONFIG_LV2_PATCH
 
 bool drumkv1_lv2::patch_set ( LV2_URID key )
@@ -894,7 +1133,8 @@ bool drumkv1_lv2::patch_set ( LV2_URID key )
 	if (pSample == nullptr)
 		return false;
 
-	lv2_atom_forge_frame_time(&m_forge, m_ndelta);
+	if (!lv2_atom_forge_frame_time(&m_forge, m_ndelta))
+		return false;
 
 	LV2_Atom_Forge_Frame patch_frame;
 	lv2_atom_forge_object(&m_forge, &patch_frame, 0, m_urids.patch_Set);
@@ -945,58 +1185,172 @@ bool drumkv1_lv2::patch_set ( LV2_URID key )
 	return true;
 }
 
-bool drumkv1_lv2::patch_get ( LV2_URID key )
+// mark properties as pending (sent on next flush, if changed or forced).
+bool drumkv1_lv2::patch_get ( LV2_URID key, bool bForce )
 {
-	if (key == 0 || key == m_urids.gen1_update || key == m_urids.gen1_select) {
-		patch_set(m_urids.p101_sample_file);
-		patch_set(m_urids.p102_offset_start);
-		patch_set(m_urids.p103_offset_end);
-		if (key) return true;
-	}
+	uint32_t props = 0;
+
+	if (key == 0 || key == m_urids.gen1_update || key == m_urids.gen1_select)
+		props |= 0x07; // sample-file, offset-start, offset-end.
+
+	if (key == 0 || key == m_urids.tun1_update)
+		props |= 0xf8; // tuning-*.
 
-	if (key == 0 || key == m_urids.tun1_update) {
-		patch_set(m_urids.p201_tuning_enabled);
-		patch_set(m_urids.p202_tuning_refPitch);
-		patch_set(m_urids.p203_tuning_refNote);
-		patch_set(m_urids.p204_tuning_scaleFile);
-		patch_set(m_urids.p205_tuning_keyMapFile);
-		if (key) return true;
+	if (props == 0) {
+		for (uint32_t i = 0; i < NUM_PATCH_PROPS; ++i) {
+			if (key == m_patch_keys[i]) {
+				props |= (1 << i);
+				break;
+			}
+		}
 	}
 
-	if (key) patch_set(key);
+	m_patch_dirty |= props;
+
+	if (bForce)
+		m_patch_force |= props;
 
 	return true;
 }
 
+
+// send all pending properties that did change.
+bool drumkv1_lv2::patch_flush (void)
+{
+	bool ret = false;
+
+	for (uint32_t i = 0; i < NUM_PATCH_PROPS; ++i) {
+		const uint32_t prop = (1 << i);
+		if ((m_patch_dirty & prop) == 0)
+			continue;
+		const LV2_URID key = m_patch_keys[i];
+		const uint32_t value = patch_signature(key);
+		if ((m_patch_force & prop) == 0
+			&& (m_patch_sent & prop) && m_patch_values[i] == value) {
+			m_patch_dirty &= ~prop;
+			continue;
+		}
+		if (!patch_set(key)) {
+			// no current sample, nothing to send...
+			if (drumkv1::sample() == nullptr) {
+				m_patch_dirty &= ~prop;
+				m_patch_force &= ~prop;
+				continue;
+			}
+			break; // out of space, retry next time.
+		}
+		m_patch_values[i] = value;
+		m_patch_sent  |=  prop;
+		m_patch_dirty &= ~prop;
+		m_patch_force &= ~prop;
+		ret = true;
+	}
+
+	return ret;
+}
+
+
+// property value signature (FNV-1a hash for paths).
+uint32_t drumkv1_lv2::patch_signature ( LV2_URID key ) const
+{
+	const char *psz = nullptr;
+	uint32_t value = 0;
+
+	drumkv1_sample *pSample = drumkv1::sample();
+
+	if (key == m_urids.p101_sample_file)
+		psz = (pSample ? pSample->filename() : nullptr);
+	else
+	if (key == m_urids.p102_offset_start)
+		value = (pSample ? pSample->offsetStart() : 0);
+	else
+	if (key == m_urids.p103_offset_end)
+		value = (pSample ? pSample->offsetEnd() : 0);
+	else
+	if (key == m_urids.p201_tuning_enabled)
+		value = (drumkv1::isTuningEnabled() ? 1 : 0);
+	else
+	if (key == m_urids.p202_tuning_refPitch) {
+		const float fRefPitch = drumkv1::tuningRefPitch();
+		::memcpy(&value, &fRefPitch, sizeof(value));
+	}
+	else
+	if (key == m_urids.p203_tuning_refNote)
+		value = uint32_t(drumkv1::tuningRefNote());
+	else
+	if (key == m_urids.p204_tuning_scaleFile)
+		psz = drumkv1::tuningScaleFile();
+	else
+	if (key == m_urids.p205_tuning_keyMapFile)
+		psz = drumkv1::tuningKeyMapFile();
+
+	if (psz) {
+		value = 2166136261u;
+		for ( ; *psz; ++psz) {
+			value ^= uint8_t(*psz);
+			value *= 16777619u;
+		}
+	}
+
+	return value;
+}
+
 #endif	// CONFIG_LV2_PATCH
 
 
 #ifdef CONFIG_LV2_PORT_EVENT
 
+// mark a port as pending (sent on next flush, if changed).
 bool drumkv1_lv2::port_event ( drumkv1::ParamIndex index )
 {
-	lv2_atom_forge_frame_time(&m_forge, m_ndelta);
+	if (uint32_t(index) >= drumkv1::NUM_PARAMS)
+		return false;
 
-	LV2_Atom_Forge_Frame obj_frame;
-	lv2_atom_forge_object(&m_forge, &obj_frame, 0, m_urids.atom_PortEvent);
-	lv2_atom_forge_key(&m_forge, m_urids.atom_portTuple);
+	m_port_dirty[index] = true;
+	m_port_pending = true;
 
-	LV2_Atom_Forge_Frame tup_frame;
-	lv2_atom_forge_tuple(&m_forge, &tup_frame);
+	return true;
+}
 
-	lv2_atom_forge_int(&m_forge, int32_t(ParamBase + index));
-	lv2_atom_forge_float(&m_forge, drumkv1::paramValue(index));
 
-	lv2_atom_forge_pop(&m_forge, &tup_frame);
-	lv2_atom_forge_pop(&m_forge, &obj_frame);
+bool drumkv1_lv2::port_events ( uint32_t nparams )
+{
+	for (uint32_t i = 0; i < nparams; ++i) {
+		drumkv1::ParamIndex index = drumkv1::ParamIndex(i);
+		if (index == drumkv1::GEN1_SAMPLE)
+			continue;
+		m_port_dirty[index] = true;
+	}
+
+	m_port_pending = true;
 
 	return true;
 }
 
 
-bool drumkv1_lv2::port_events ( uint32_t nparams )
+// send all pending ports that did change, in one single tuple.
+bool drumkv1_lv2::port_flush (void)
 {
-	lv2_atom_forge_frame_time(&m_forge, m_ndelta);
+	uint32_t nchanges = 0;
+
+	for (uint32_t i = 0; i < drumkv1::NUM_PARAMS; ++i) {
+		if (!m_port_dirty[i])
+			continue;
+		const float fValue = drumkv1::paramValue(drumkv1::ParamIndex(i));
+		// nb. never sent (NaN) compares as changed.
+		if (::fabsf(fValue - m_port_values[i]) <= DRUMKV1_LV2_PORT_EPSILON)
+			m_port_dirty[i] = false;
+		else
+			++nchanges;
+	}
+
+	if (nchanges == 0) {
+		m_port_pending = false;
+		return false;
+	}
+
+	if (!lv2_atom_forge_frame_time(&m_forge, m_ndelta))
+		return false; // out of space, retry next time.
 
 	LV2_Atom_Forge_Frame obj_frame;
 	lv2_atom_forge_object(&m_forge, &obj_frame, 0, m_urids.atom_PortEvent);
@@ -1005,20 +1359,37 @@ bool drumkv1_lv2::port_events ( uint32_t nparams )
 	LV2_Atom_Forge_Frame tup_frame;
 	lv2_atom_forge_tuple(&m_forge, &tup_frame);
 
-	for (uint32_t i = 0; i < nparams; ++i) {
-		drumkv1::ParamIndex index = drumkv1::ParamIndex(i);
-		if (index == drumkv1::GEN1_SAMPLE)
+	for (uint32_t i = 0; i < drumkv1::NUM_PARAMS; ++i) {
+		if (!m_port_dirty[i])
 			continue;
+		const drumkv1::ParamIndex index = drumkv1::ParamIndex(i);
+		const float fValue = drumkv1::paramValue(index);
 		lv2_atom_forge_int(&m_forge, int32_t(ParamBase + index));
-		lv2_atom_forge_float(&m_forge, drumkv1::paramValue(index));
+		lv2_atom_forge_float(&m_forge, fValue);
+		m_port_values[i] = fValue;
+		m_port_dirty[i] = false;
 	}
 
 	lv2_atom_forge_pop(&m_forge, &tup_frame);
 	lv2_atom_forge_pop(&m_forge, &obj_frame);
 
+	m_port_pending = false;
+
 	return true;
 }
 
+
+// whatever the input ports hold now (set by the host or the UI)
+// is already known out there: never send that one back again.
+void drumkv1_lv2::port_refresh (void)
+{
+	for (uint32_t i = 0; i < drumkv1::NUM_PARAMS; ++i) {
+		const float *pfParam = m_port_params[i];
+		if (pfParam)
+			m_port_values[i] = *pfParam;
+	}
+}
+
 #endif	// CONFIG_LV2_PORT_EVENT
 
 
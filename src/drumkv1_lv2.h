@@ -23,6 +23,8 @@
 #define __drumkv1_lv2_h
 
 #include "drumkv1.h"
+#include "drumkv1_state.h"
+#include "drumkv1_load.h"
 
 #include "lv2/lv2plug.in/ns/ext/urid/urid.h"
 #include "lv2/lv2plug.in/ns/ext/atom/atom.h"
@@ -30,6 +32,8 @@
 
 #include "lv2/lv2plug.in/ns/ext/worker/worker.h"
 
+#include <atomic>
+
 #define DRUMKV1_LV2_URI "http://drumkv1.sourceforge.net/lv2"
 #define DRUMKV1_LV2_PREFIX DRUMKV1_LV2_URI "#"
 
@@ -55,6 +59,31 @@ public:
 
 	~drumkv1_lv2();
 
+	// DSP load meter (output) ports.
+	enum LoadIndex {
+
+		LOAD1_DSP = 0,
+		LOAD1_PEAK,
+		LOAD1_STAGES,
+
+		NUM_LOADS = LOAD1_STAGES + drumkv1_load::NumStages
+	};
+
+	// runtime counters (output) ports.
+	enum StatIndex {
+
+		STAT1_VOICES = 0,
+		STAT1_PEAK_VOICES,
+		STAT1_DROPPED,
+		STAT1_CHOKED,
+		STAT1_RETRIGGERED,
+		STAT1_CONTROLLERS,
+		STAT1_FILTERED,
+		STAT1_OVERRUNS,
+
+		NUM_STATS
+	};
+
 	enum PortIndex {
 
 		MidiIn = 0,
@@ -63,7 +92,9 @@ public:
 		AudioInR,
 		AudioOutL,
 		AudioOutR,
-		ParamBase
+		ParamBase,
+		LoadBase = ParamBase + drumkv1::NUM_PARAMS,
+		StatBase = LoadBase + NUM_LOADS
 	};
 
 	void connect_port(uint32_t port, void *data);
@@ -83,6 +114,17 @@ public:
 	bool worker_work(const void *data, uint32_t size);
 	bool worker_response(const void *data, uint32_t size);
 
+	// binary state codec (last saved chunk cache).
+	drumkv1_state *state()
+		{ return &m_state; }
+
+	// binary state chunk, re-encoded only when dirty.
+	const QByteArray& state_save(const drumkv1_param::map_path& mapPath);
+
+	// something worth saving has changed (any thread).
+	void setDirty()
+		{ m_bDirty.store(true, std::memory_order_release); }
+
 	static void qapp_instantiate();
 	static void qapp_cleanup();
 
@@ -104,14 +146,24 @@ protected:
 
 	bool state_changed();
 
+	// element param input ports moved since last run?
+	void state_refresh();
+
+	// coalesced notifications (end of run).
+	void notify_flush(uint32_t nframes);
+
 #ifdef CONFIG_LV2_PATCH
 	bool patch_set(LV2_URID key);
-	bool patch_get(LV2_URID key);
+	bool patch_get(LV2_URID key, bool bForce = false);
+	bool patch_flush();
+	uint32_t patch_signature(LV2_URID key) const;
 #endif
 
 #ifdef CONFIG_LV2_PORT_EVENT
 	bool port_event(drumkv1::ParamIndex index);
 	bool port_events(uint32_t nparams);
+	bool port_flush();
+	void port_refresh();
 #endif
 
 private:
@@ -174,6 +226,42 @@ private:
 	float **m_ins;
 	float **m_outs;
 
+	float *m_loads[NUM_LOADS];
+	float *m_stats[NUM_STATS];
+
+	drumkv1_state m_state;
+
+	// set on any element or tuning change, or moved element param
+	// ports (last seen values); last save location probe.
+	std::atomic<bool> m_bDirty;
+	float   m_dirty_params[drumkv1::NUM_ELEMENT_PARAMS];
+	QString m_sDirtyProbe;
+
+	// input control ports.
+	float *m_port_params[drumkv1::NUM_PARAMS];
+
+	// pending (coalesced) notifications.
+	bool     m_state_dirty;
+	uint32_t m_notify_period;
+	uint32_t m_notify_frames;
+
+#ifdef CONFIG_LV2_PATCH
+	// patch properties: last sent value signatures.
+	enum { NUM_PATCH_PROPS = 8 };
+	LV2_URID m_patch_keys[NUM_PATCH_PROPS];
+	uint32_t m_patch_values[NUM_PATCH_PROPS];
+	uint32_t m_patch_sent;
+	uint32_t m_patch_dirty;
+	uint32_t m_patch_force;
+#endif
+
+#ifdef CONFIG_LV2_PORT_EVENT
+	// port events: last known (sent) values.
+	float  m_port_values[drumkv1::NUM_PARAMS];
+	bool  m_port_dirty[drumkv1::NUM_PARAMS];
+	bool  m_port_pending;
+#endif
+
 #ifdef CONFIG_LV2_PROGRAMS
 	LV2_Program_Descriptor m_program;
 	QByteArray m_aProgramName;
@@ -0,0 +1,249 @@
+// drumkv1_osc.cpp
+//
+/****************************************************************************
+   Copyright (C) 2012-2021, rncbc aka Rui Nuno Capela. All rights reserved.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*****************************************************************************/
+
+#include "drumkv1_osc.h"
+
+#include "drumkv1.h"
+
+#include <cstdlib>
+
+
+#ifdef CONFIG_LIBLO
+
+//---------------------------------------------------------------------------
+// drumkv1_osc - OSC (liblo) callback methods.
+
+static
+int osc_load_query ( const char */*path*/, const char */*types*/,
+	lo_arg **/*argv*/, int /*argc*/, lo_message msg, void *user_data )
+{
+	drumkv1_osc *pOsc = static_cast<drumkv1_osc *> (user_data);
+	if (pOsc == nullptr)
+		return -1;
+
+	pOsc->load_query(msg);
+	return 0;
+}
+
+
+static
+int osc_load_histogram ( const char */*path*/, const char */*types*/,
+	lo_arg **/*argv*/, int /*argc*/, lo_message msg, void *user_data )
+{
+	drumkv1_osc *pOsc = static_cast<drumkv1_osc *> (user_data);
+	if (pOsc == nullptr)
+		return -1;
+
+	pOsc->load_histogram(msg);
+	return 0;
+}
+
+
+static
+int osc_load_reset ( const char */*path*/, const char */*types*/,
+	lo_arg **/*argv*/, int /*argc*/, lo_message /*msg*/, void *user_data )
+{
+	drumkv1_osc *pOsc = static_cast<drumkv1_osc *> (user_data);
+	if (pOsc == nullptr)
+		return -1;
+
+	pOsc->load_reset();
+	return 0;
+}
+
+
+static
+int osc_counters_query ( const char */*path*/, const char */*types*/,
+	lo_arg **/*argv*/, int /*argc*/, lo_message msg, void *user_data )
+{
+	drumkv1_osc *pOsc = static_cast<drumkv1_osc *> (user_data);
+	if (pOsc == nullptr)
+		return -1;
+
+	pOsc->counters_query(msg);
+	return 0;
+}
+
+
+static
+int osc_counters_reset ( const char */*path*/, const char */*types*/,
+	lo_arg **/*argv*/, int /*argc*/, lo_message /*msg*/, void *user_data )
+{
+	drumkv1_osc *pOsc = static_cast<drumkv1_osc *> (user_data);
+	if (pOsc == nullptr)
+		return -1;
+
+	pOsc->counters_reset();
+	return 0;
+}
+
+#endif	// CONFIG_LIBLO
+
+
+//---------------------------------------------------------------------------
+// drumkv1_osc - OSC monitor service (JACK stand-alone).
+
+// Constructor.
+drumkv1_osc::drumkv1_osc ( drumkv1 *pDrumk, const QString& port )
+	: m_pDrumk(pDrumk)
+	#ifdef CONFIG_LIBLO
+		, m_thread(nullptr)
+		, m_server(nullptr)
+	#endif
+{
+#ifdef CONFIG_LIBLO
+	const QByteArray aPort = port.toUtf8();
+	m_thread = lo_server_thread_new(
+		aPort.isEmpty() ? nullptr : aPort.constData(), nullptr);
+	if (m_thread) {
+		m_server = lo_server_thread_get_server(m_thread);
+		lo_server_thread_add_method(m_thread,
+			"/drumkv1/load", "", osc_load_query, this);
+		lo_server_thread_add_method(m_thread,
+			"/drumkv1/load/histogram", "", osc_load_histogram, this);
+		lo_server_thread_add_method(m_thread,
+			"/drumkv1/load/reset", "", osc_load_reset, this);
+		lo_server_thread_add_method(m_thread,
+			"/drumkv1/counters", "", osc_counters_query, this);
+		lo_server_thread_add_method(m_thread,
+			"/drumkv1/counters/reset", "", osc_counters_reset, this);
+		lo_server_thread_start(m_thread);
+	}
+#else
+	(void) port;
+#endif
+}
+
+
+// Destructor.
+drumkv1_osc::~drumkv1_osc (void)
+{
+#ifdef CONFIG_LIBLO
+	if (m_thread) {
+		lo_server_thread_stop(m_thread);
+		lo_server_thread_free(m_thread);
+	}
+#endif
+}
+
+
+// Service status accessors.
+bool drumkv1_osc::is_active (void) const
+{
+#ifdef CONFIG_LIBLO
+	return (m_server != nullptr);
+#else
+	return false;
+#endif
+}
+
+
+QString drumkv1_osc::url (void) const
+{
+	QString sUrl;
+
+#ifdef CONFIG_LIBLO
+	if (m_server) {
+		char *url = lo_server_get_url(m_server);
+		if (url) {
+			sUrl = QString::fromUtf8(url);
+			::free(url);
+		}
+	}
+#endif
+
+	return sUrl;
+}
+
+
+#ifdef CONFIG_LIBLO
+
+// Method handlers (server thread).
+void drumkv1_osc::load_query ( lo_message msg )
+{
+	lo_address addr = lo_message_get_source(msg);
+	if (addr == nullptr)
+		return;
+
+	m_pDrumk->load()->update(m_load);
+
+	lo_send_from(addr, m_server, LO_TT_IMMEDIATE,
+		"/drumkv1/load", "ffffffii",
+		m_load.load, m_load.peak,
+		m_load.stages[drumkv1_load::Voices],
+		m_load.stages[drumkv1_load::Effects],
+		m_load.stages[drumkv1_load::Reverb],
+		m_load.stages[drumkv1_load::Mixdown],
+		int(m_load.overruns), int(m_load.cycles));
+}
+
+
+void drumkv1_osc::load_histogram ( lo_message msg )
+{
+	lo_address addr = lo_message_get_source(msg);
+	if (addr == nullptr)
+		return;
+
+	m_pDrumk->load()->update(m_load);
+
+	lo_message reply = lo_message_new();
+	for (uint32_t i = 0; i < drumkv1_load::NumBins; ++i)
+		lo_message_add_int32(reply, int(m_load.bins[i]));
+	lo_send_message_from(addr, m_server, "/drumkv1/load/histogram", reply);
+	lo_message_free(reply);
+}
+
+
+void drumkv1_osc::load_reset (void)
+{
+	m_pDrumk->load()->update(m_load);
+
+	m_load.reset();
+}
+
+
+void drumkv1_osc::counters_query ( lo_message msg )
+{
+	lo_address addr = lo_message_get_source(msg);
+	if (addr == nullptr)
+		return;
+
+	drumkv1::Counters counters;
+	m_pDrumk->counters(counters);
+
+	lo_send_from(addr, m_server, LO_TT_IMMEDIATE,
+		"/drumkv1/counters", "iiiiiiii",
+		int(counters.voices), int(counters.peak_voices),
+		int(counters.alloc_failures), int(counters.choke_cuts),
+		int(counters.fast_releases), int(counters.cc_events),
+		int(counters.filtered), int(counters.overruns));
+}
+
+
+void drumkv1_osc::counters_reset (void)
+{
+	m_pDrumk->resetCounters();
+}
+
+#endif	// CONFIG_LIBLO
+
+
+// end of drumkv1_osc.cpp
@@ -0,0 +1,95 @@
+// drumkv1_osc.h
+//
+/****************************************************************************
+   Copyright (C) 2012-2021, rncbc aka Rui Nuno Capela. All rights reserved.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*****************************************************************************/
+
+#ifndef __drumkv1_osc_h
+#define __drumkv1_osc_h
+
+#include "drumkv1_config.h"
+#include "drumkv1_load.h"
+
+#include <QString>
+
+#ifdef CONFIG_LIBLO
+#include <lo/lo.h>
+#endif
+
+
+// forward decls.
+class drumkv1;
+
+
+//---------------------------------------------------------------------------
+// drumkv1_osc - OSC monitor service (JACK stand-alone).
+//
+//   /drumkv1/load            -> /drumkv1/load ffffffii
+//                               (load, peak, voices, effects, reverb,
+//                                mix-down, overruns, cycles)
+//   /drumkv1/load/histogram  -> /drumkv1/load/histogram i...
+//   /drumkv1/load/reset
+//   /drumkv1/counters        -> /drumkv1/counters iiiiiiii
+//                               (voices, peak voices, dropped notes,
+//                                choke cuts, retrigger releases,
+//                                controller events, channel filtered,
+//                                overruns)
+//   /drumkv1/counters/reset
+//
+//   Replies are sent back to the querying address.
+
+class drumkv1_osc
+{
+public:
+
+	// Constructor.
+	drumkv1_osc(drumkv1 *pDrumk, const QString& port);
+
+	// Destructor.
+	~drumkv1_osc();
+
+	// Service status accessors.
+	bool is_active() const;
+	QString url() const;
+
+#ifdef CONFIG_LIBLO
+	// Method handlers (server thread).
+	void load_query(lo_message msg);
+	void load_histogram(lo_message msg);
+	void load_reset();
+	void counters_query(lo_message msg);
+	void counters_reset();
+#endif
+
+private:
+
+	// Instance variables.
+	drumkv1 *m_pDrumk;
+
+#ifdef CONFIG_LIBLO
+	lo_server_thread m_thread;
+	lo_server m_server;
+#endif
+
+	drumkv1_load::Stats m_load;
+};
+
+
+#endif // __drumkv1_osc_h
+
+// end of drumkv1_osc.h
@@ -21,6 +21,7 @@
 
 #include "drumkv1_param.h"
 #include "drumkv1_config.h"
+#include "drumkv1_bundle.h"
 
 #include <QHash>
 
@@ -237,25 +238,37 @@ bool drumkv1_param::paramInt ( drumkv1::ParamIndex index )
 }
 
 
+// Parameter name to index lookup (staged loads may run concurrently).
+static QHash<QString, drumkv1::ParamIndex> drumkv1_param_hash (
+	uint32_t iFirst, uint32_t iLast )
+{
+	QHash<QString, drumkv1::ParamIndex> hash;
+	for (uint32_t i = iFirst; i < iLast; ++i)
+		hash.insert(drumkv1_params[i].name, drumkv1::ParamIndex(i));
+	return hash;
+}
+
+
 // Element serialization methods.
 void drumkv1_param::loadElements (
 	drumkv1 *pDrumk, const QDomElement& eElements,
-	const drumkv1_param::map_path& mapPath )
+	const drumkv1_param::map_path& mapPath,
+	const std::atomic<bool> *pAbort )
 {
 	if (pDrumk == nullptr)
 		return;
 
 	pDrumk->clearElements();
 
-	static QHash<QString, drumkv1::ParamIndex> s_hash;
-	if (s_hash.isEmpty()) {
-		for (uint32_t i = 0; i < drumkv1::NUM_ELEMENT_PARAMS; ++i)
-			s_hash.insert(drumkv1_params[i].name, drumkv1::ParamIndex(i));
-	}
+	static const QHash<QString, drumkv1::ParamIndex> s_hash
+		= drumkv1_param_hash(0, drumkv1::NUM_ELEMENT_PARAMS);
 
 	for (QDomNode nElement = eElements.firstChild();
 			!nElement.isNull();
 				nElement = nElement.nextSibling()) {
+		// aborted half-way? (eg. background prefetch)
+		if (pAbort && pAbort->load())
+			break;
 		QDomElement eElement = nElement.toElement();
 		if (eElement.isNull())
 			continue;
@@ -283,8 +296,8 @@ void drumkv1_param::loadElements (
 					const QString& sSampleFile
 						= eChild.text();
 					const QByteArray aSampleFile
-						= mapPath.absolutePath(
-							drumkv1_param::loadFilename(sSampleFile)).toUtf8();
+						= drumkv1_param::loadFilename(
+							mapPath.absolutePath(sSampleFile)).toUtf8();
 					element->setSampleFile(aSampleFile.constData());
 					element->setOffsetRange(iOffsetStart, iOffsetEnd);
 				}
@@ -358,48 +371,91 @@ void drumkv1_param::saveElements (
 }
 
 
-// Preset serialization methods.
-bool drumkv1_param::loadPreset (
-	drumkv1 *pDrumk, const QString& sFilename )
+// Preset file path (anchored) functor.
+class drumkv1_param_map_path : public drumkv1_param::map_path
 {
-	if (pDrumk == nullptr)
-		return false;
+public:
 
-	QFileInfo fi(sFilename);
+	drumkv1_param_map_path(const QDir& dir) : m_dir(dir) {}
+
+	QString absolutePath(const QString& sAbstractPath) const
+		{ return m_dir.absoluteFilePath(sAbstractPath); }
+	QString abstractPath(const QString& sAbsolutePath) const
+		{ return m_dir.relativeFilePath(sAbsolutePath); }
+
+private:
+
+	QDir m_dir;
+};
+
+
+// Preset serialization methods.
+QString drumkv1_param::presetFilename ( const QString& sPreset )
+{
+	QFileInfo fi(sPreset);
 	if (!fi.exists()) {
 		drumkv1_config *pConfig = drumkv1_config::getInstance();
 		if (pConfig) {
 			const QString& sPresetFile
-				= pConfig->presetFile(sFilename);
+				= pConfig->presetFile(sPreset);
 			if (sPresetFile.isEmpty())
-				return false;
+				return QString();
 			fi.setFile(sPresetFile);
 			if (!fi.exists())
-				return false;
+				return QString();
 		}
 	}
 
-	QFile file(fi.filePath());
-	if (!file.open(QIODevice::ReadOnly))
+	return fi.absoluteFilePath();
+}
+
+
+static bool drumkv1_param_loadPreset (
+	drumkv1 *pDrumk, const QString& sFilename, bool bStaged,
+	const std::atomic<bool> *pAbort = nullptr )
+{
+	if (pDrumk == nullptr)
 		return false;
 
-	const bool running = pDrumk->running(false);
+	const QString& sPresetFile
+		= drumkv1_param::presetFilename(sFilename);
+	if (sPresetFile.isEmpty())
+		return false;
 
-	pDrumk->setTuningEnabled(false);
-	pDrumk->reset();
+	const QFileInfo fi(sPresetFile);
 
-	static QHash<QString, drumkv1::ParamIndex> s_hash;
-	if (s_hash.isEmpty()) {
-		for (uint32_t i = drumkv1::NUM_ELEMENT_PARAMS; i < drumkv1::NUM_PARAMS; ++i) {
-			const drumkv1::ParamIndex index = drumkv1::ParamIndex(i);
-			s_hash.insert(drumkv1_param::paramName(index), index);
-		}
+	QFile file(fi.filePath());
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+
+	// staged: build the new element set off-line, while the
+	// current one keeps playing; otherwise stop and reset.
+	bool running = false;
+	if (bStaged) {
+		pDrumk->beginElements();
+		pDrumk->setTuningEnabled(false);
+	} else {
+		running = pDrumk->running(false);
+		pDrumk->setTuningEnabled(false);
+		pDrumk->reset();
 	}
 
+	static const QHash<QString, drumkv1::ParamIndex> s_hash
+		= drumkv1_param_hash(drumkv1::NUM_ELEMENT_PARAMS, drumkv1::NUM_PARAMS);
+
+	// staged loads may run concurrently: resolve relative
+	// sample and tuning paths without changing directory.
 	const QDir currentDir(QDir::current());
-	QDir::setCurrent(fi.absolutePath());
+	if (!bStaged)
+		QDir::setCurrent(fi.absolutePath());
+
+	const drumkv1_param_map_path mapPath(fi.absoluteDir());
 
 	QDomDocument doc(DRUMKV1_TITLE);
+	if (drumkv1_bundle::isBundle(sPresetFile)) {
+		drumkv1_bundle::loadBundle(pDrumk, sPresetFile);
+	}
+	else
 	if (doc.setContent(&file)) {
 		QDomElement ePreset = doc.documentElement();
 		if (ePreset.tagName() == "preset") {
@@ -434,11 +490,11 @@ bool drumkv1_param::loadPreset (
 				}
 				else
 				if (eChild.tagName() == "elements") {
-					drumkv1_param::loadElements(pDrumk, eChild);
+					drumkv1_param::loadElements(pDrumk, eChild, mapPath, pAbort);
 				}
 				else
 				if (eChild.tagName() == "tuning") {
-					drumkv1_param::loadTuning(pDrumk, eChild);
+					drumkv1_param::loadTuning(pDrumk, eChild, mapPath);
 				}
 			}
 		}
@@ -446,16 +502,54 @@ bool drumkv1_param::loadPreset (
 
 	file.close();
 
-	pDrumk->stabilize();
-	pDrumk->reset();
-	pDrumk->running(running);
+	if (!bStaged) {
+		pDrumk->stabilize();
+		pDrumk->reset();
+		pDrumk->running(running);
+		QDir::setCurrent(currentDir.absolutePath());
+	}
+
+	return true;
+}
+
+
+bool drumkv1_param::loadPreset (
+	drumkv1 *pDrumk, const QString& sFilename )
+{
+	return drumkv1_param_loadPreset(pDrumk, sFilename, false);
+}
 
-	QDir::setCurrent(currentDir.absolutePath());
 
+bool drumkv1_param::loadProgram (
+	drumkv1 *pDrumk, const QString& sFilename, bool bHold )
+{
+	if (!drumkv1_param_loadPreset(pDrumk, sFilename, true))
+		return false;
+
+	pDrumk->commitElements(bHold);
 	return true;
 }
 
 
+drumkv1_kit *drumkv1_param::loadKit (
+	drumkv1 *pDrumk, const QString& sFilename,
+	const std::atomic<bool> *pAbort )
+{
+	if (!drumkv1_param_loadPreset(pDrumk, sFilename, true, pAbort))
+		return nullptr;
+
+	drumkv1_kit *pKit = pDrumk->takeElements();
+
+	// incomplete, drop it.
+	if (pAbort && pAbort->load()) {
+		pDrumk->freeElements(pKit);
+		pKit = nullptr;
+	}
+
+	return pKit;
+}
+
+
 bool drumkv1_param::savePreset (
 	drumkv1 *pDrumk, const QString& sFilename, bool bSymLink )
 {
@@ -511,7 +605,8 @@ bool drumkv1_param::savePreset (
 
 // Tuning serialization methods.
 void drumkv1_param::loadTuning (
-	drumkv1 *pDrumk, const QDomElement& eTuning )
+	drumkv1 *pDrumk, const QDomElement& eTuning,
+	const drumkv1_param::map_path& mapPath )
 {
 	if (pDrumk == nullptr)
 		return;
@@ -539,7 +634,8 @@ void drumkv1_param::loadTuning (
 			const QString& sScaleFile
 				= eChild.text();
 			const QByteArray aScaleFile
-				= drumkv1_param::loadFilename(sScaleFile).toUtf8();
+				= drumkv1_param::loadFilename(
+					mapPath.absolutePath(sScaleFile)).toUtf8();
 			pDrumk->setTuningScaleFile(aScaleFile.constData());
 		}
 		else
@@ -547,7 +643,8 @@ void drumkv1_param::loadTuning (
 			const QString& sKeyMapFile
 				= eChild.text();
 			const QByteArray aKeyMapFile
-				= drumkv1_param::loadFilename(sKeyMapFile).toUtf8();
+				= drumkv1_param::loadFilename(
+					mapPath.absolutePath(sKeyMapFile)).toUtf8();
 			pDrumk->setTuningScaleFile(aKeyMapFile.constData());
 		}
 	}
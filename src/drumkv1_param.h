@@ -26,6 +26,8 @@
 
 #include <QString>
 
+#include <atomic>
+
 // forward decl.
 class QDomElement;
 class QDomDocument;
@@ -53,10 +55,22 @@ namespace drumkv1_param
 		const QString& sFilename,
 		bool bSymLink = false);
 
+	// Program change (staged) preset loaders.
+	bool loadProgram(drumkv1 *pDrumk,
+		const QString& sFilename,
+		bool bHold = false);
+	drumkv1_kit *loadKit(drumkv1 *pDrumk,
+		const QString& sFilename,
+		const std::atomic<bool> *pAbort = nullptr);
+
+	// Preset name/file resolver.
+	QString presetFilename(const QString& sPreset);
+
 	// Element serialization methods.
 	void loadElements(drumkv1 *pDrumk,
 		const QDomElement& eElements,
-		const map_path& mapPath = map_path());
+		const map_path& mapPath = map_path(),
+		const std::atomic<bool> *pAbort = nullptr);
 	void saveElements(drumkv1 *pDrumk,
 		QDomDocument& doc, QDomElement& eElements,
 		const map_path& mapPath = map_path(),
@@ -64,7 +78,8 @@ namespace drumkv1_param
 
 	// Tuning serialization methods.
 	void loadTuning(drumkv1 *pDrumk,
-		const QDomElement& eTuning);
+		const QDomElement& eTuning,
+		const map_path& mapPath = map_path());
 	void saveTuning(drumkv1 *pDrumk,
 		QDomDocument& doc, QDomElement& eTuning,
 		bool bSymLink = false);
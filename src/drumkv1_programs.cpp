@@ -21,6 +21,282 @@
 
 #include "drumkv1_programs.h"
 
+#include "drumkv1_config.h"
+
+#include <QThread>
+#include <QHash>
+
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+
+//-------------------------------------------------------------------------
+// drumkv1_programs::Prefetch - prefetched programs cache (LRU).
+//
+
+class drumkv1_programs::Prefetch : public QThread
+{
+public:
+
+	// prefetch request.
+	struct Request
+	{
+		uint32_t key;
+		QString  filename;
+		uint64_t stamp;
+	};
+
+	typedef QList<Request> Requests;
+
+	// ctor.
+	Prefetch(drumkv1 *pDrumk);
+
+	// dtor.
+	~Prefetch();
+
+	// (re)queue requests, highest priority first.
+	void request(const Requests& reqs, uint64_t budget);
+
+	// take a prefetched kit out of the cache, if any.
+	drumkv1_kit *take(uint32_t key);
+
+	// foreground program load in progress.
+	void hold(bool on);
+
+	// drop everything.
+	void clear();
+
+	// cache key.
+	static uint32_t key(uint16_t bank_id, uint16_t prog_id)
+		{ return (uint32_t(bank_id) << 16) | prog_id; }
+
+protected:
+
+	// worker loop.
+	void run();
+
+	// evict least recently used over budget (locked).
+	void evict(QList<drumkv1_kit *>& kits);
+
+	// free kits (unlocked).
+	void free_kits(const QList<drumkv1_kit *>& kits);
+
+private:
+
+	// cache item.
+	struct Item
+	{
+		drumkv1_kit *kit;
+		uint64_t size;
+		uint64_t stamp;
+	};
+
+	// instance variables.
+	drumkv1 *m_pDrumk;
+
+	std::mutex m_mutex;
+	std::condition_variable m_cond;
+
+	bool m_running;
+	int  m_hold;
+
+	// foreground load pending (lock-free peek).
+	std::atomic<bool> m_held;
+
+	QHash<uint32_t, Item> m_cache;
+	Requests m_queue;
+
+	uint64_t m_usage;
+	uint64_t m_budget;
+	uint64_t m_stamp;
+};
+
+
+// ctor.
+drumkv1_programs::Prefetch::Prefetch ( drumkv1 *pDrumk )
+	: QThread(), m_pDrumk(pDrumk), m_running(true), m_hold(0),
+		m_held(false), m_usage(0), m_budget(0), m_stamp(0)
+{
+	// never compete with audio or foreground loads.
+	QThread::start(QThread::IdlePriority);
+}
+
+
+// dtor.
+drumkv1_programs::Prefetch::~Prefetch (void)
+{
+	{
+		const std::lock_guard<std::mutex> lock(m_mutex);
+		m_running = false;
+	}
+
+	m_cond.notify_all();
+	QThread::wait();
+
+	clear();
+}
+
+
+// (re)queue requests, highest priority first.
+void drumkv1_programs::Prefetch::request (
+	const Requests& reqs, uint64_t budget )
+{
+	QList<drumkv1_kit *> kits;
+	{
+		const std::lock_guard<std::mutex> lock(m_mutex);
+
+		m_budget = budget;
+		m_queue.clear();
+
+		// stamp in reverse priority order, so the first is the newest...
+		const int nreqs = reqs.count();
+		m_stamp += nreqs;
+
+		for (int i = 0; i < nreqs; ++i) {
+			const Request& req = reqs.at(i);
+			QHash<uint32_t, Item>::Iterator iter = m_cache.find(req.key);
+			if (iter != m_cache.end()) {
+				iter.value().stamp = m_stamp - i;
+			} else {
+				m_queue.append(req);
+				m_queue.last().stamp = m_stamp - i;
+			}
+		}
+
+		evict(kits);
+	}
+
+	free_kits(kits);
+
+	m_cond.notify_all();
+}
+
+
+// take a prefetched kit out of the cache, if any.
+drumkv1_kit *drumkv1_programs::Prefetch::take ( uint32_t key )
+{
+	const std::lock_guard<std::mutex> lock(m_mutex);
+
+	QHash<uint32_t, Item>::Iterator iter = m_cache.find(key);
+	if (iter == m_cache.end())
+		return nullptr;
+
+	drumkv1_kit *kit = iter.value().kit;
+	m_usage -= iter.value().size;
+	m_cache.erase(iter);
+
+	return kit;
+}
+
+
+// foreground program load in progress.
+void drumkv1_programs::Prefetch::hold ( bool on )
+{
+	{
+		const std::lock_guard<std::mutex> lock(m_mutex);
+		if (on)
+			++m_hold;
+		else
+		if (m_hold > 0)
+			--m_hold;
+		m_held = (m_hold > 0);
+	}
+
+	if (!on)
+		m_cond.notify_all();
+}
+
+
+// drop everything.
+void drumkv1_programs::Prefetch::clear (void)
+{
+	QList<drumkv1_kit *> kits;
+	{
+		const std::lock_guard<std::mutex> lock(m_mutex);
+
+		QHash<uint32_t, Item>::ConstIterator iter = m_cache.constBegin();
+		const QHash<uint32_t, Item>::ConstIterator& iter_end = m_cache.constEnd();
+		for ( ; iter != iter_end; ++iter)
+			kits.append(iter.value().kit);
+
+		m_cache.clear();
+		m_queue.clear();
+		m_usage = 0;
+	}
+
+	free_kits(kits);
+}
+
+
+// worker loop.
+void drumkv1_programs::Prefetch::run (void)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	while (m_running) {
+		// wait for work, while no foreground load is pending...
+		if (m_hold > 0 || m_queue.isEmpty()) {
+			m_cond.wait(lock);
+			continue;
+		}
+		const Request req = m_queue.takeFirst();
+		if (m_cache.contains(req.key))
+			continue;
+		lock.unlock();
+		// gives way to foreground loads, between elements...
+		drumkv1_kit *kit = drumkv1_param::loadKit(m_pDrumk, req.filename, &m_held);
+		const uint64_t size = m_pDrumk->elementsMemory(kit);
+		lock.lock();
+		if (kit == nullptr)
+			continue;
+		// cached, unless it's the first to go...
+		Item item;
+		item.kit   = kit;
+		item.size  = size;
+		item.stamp = req.stamp;
+		m_cache.insert(req.key, item);
+		m_usage += size;
+		QList<drumkv1_kit *> kits;
+		evict(kits);
+		// no room left for lower priority ones?
+		if (kits.contains(kit))
+			m_queue.clear();
+		if (!kits.isEmpty()) {
+			lock.unlock();
+			free_kits(kits);
+			lock.lock();
+		}
+	}
+}
+
+
+// evict least recently used over budget (locked).
+void drumkv1_programs::Prefetch::evict ( QList<drumkv1_kit *>& kits )
+{
+	while (m_usage > m_budget && !m_cache.isEmpty()) {
+		QHash<uint32_t, Item>::Iterator iter_lru = m_cache.begin();
+		QHash<uint32_t, Item>::Iterator iter = iter_lru;
+		const QHash<uint32_t, Item>::Iterator& iter_end = m_cache.end();
+		for (++iter; iter != iter_end; ++iter) {
+			if (iter_lru.value().stamp > iter.value().stamp)
+				iter_lru = iter;
+		}
+		kits.append(iter_lru.value().kit);
+		m_usage -= iter_lru.value().size;
+		m_cache.erase(iter_lru);
+	}
+}
+
+
+// free kits (unlocked).
+void drumkv1_programs::Prefetch::free_kits ( const QList<drumkv1_kit *>& kits )
+{
+	QListIterator<drumkv1_kit *> iter(kits);
+	while (iter.hasNext())
+		m_pDrumk->freeElements(iter.next());
+}
+
 
 //-------------------------------------------------------------------------
 // drumkv1_programs - Bank/programs database class (singleton).
@@ -30,7 +306,7 @@
 drumkv1_programs::drumkv1_programs ( drumkv1 *pDrumk )
 	: m_enabled(false), m_sched(pDrumk),
 		m_bank_msb(0), m_bank_lsb(0),
-		m_bank(nullptr), m_prog(nullptr)
+		m_bank(nullptr), m_prog(nullptr), m_prefetch(nullptr)
 {
 }
 
@@ -39,6 +315,7 @@ drumkv1_programs::drumkv1_programs ( drumkv1 *pDrumk )
 drumkv1_programs::~drumkv1_programs (void)
 {
 	clear_banks();
+	prefetch_clear();
 }
 
 
@@ -117,6 +394,9 @@ void drumkv1_programs::clear_banks (void)
 
 	qDeleteAll(m_banks);
 	m_banks.clear();
+
+	if (m_prefetch)
+		m_prefetch->clear();
 }
 
 
@@ -181,9 +461,101 @@ void drumkv1_programs::process_program (
 	m_prog = (m_bank ? m_bank->find_prog(prog_id) : nullptr);
 
 	if (m_prog) {
-		drumkv1_param::loadPreset(pDrumk, m_prog->name());
+		// keep ringing voices from the old kit?
+		drumkv1_config *pConfig = drumkv1_config::getInstance();
+		const bool bHold = (pConfig && pConfig->bProgramsHold);
+		// already prefetched?
+		drumkv1_kit *pKit = nullptr;
+		if (m_prefetch) {
+			m_prefetch->hold(true);
+			pKit = m_prefetch->take(Prefetch::key(bank_id, prog_id));
+		}
+		if (!pDrumk->adoptElements(pKit, bHold))
+			drumkv1_param::loadProgram(pDrumk, m_prog->name(), bHold);
+		if (m_prefetch)
+			m_prefetch->hold(false);
 		pDrumk->updateSample();
 		pDrumk->updateParams();
+		// get the neighbours ready...
+		prefetch_update(pDrumk);
+	}
+}
+
+
+// prefetched programs (adjacent/pinned; background thread).
+void drumkv1_programs::prefetch_update ( drumkv1 *pDrumk )
+{
+	drumkv1_config *pConfig = drumkv1_config::getInstance();
+	if (pConfig == nullptr)
+		return;
+
+	const int nadjacent = pConfig->iProgramsPrefetch;
+	const QStringList& pinned = pConfig->sProgramsPinned;
+	if (nadjacent < 1 && pinned.isEmpty()) {
+		prefetch_clear();
+		return;
+	}
+
+	if (m_prefetch == nullptr)
+		m_prefetch = new Prefetch(pDrumk);
+
+	// pinned programs first ("bank:prog"), then nearest neighbours...
+	QList<uint32_t> keys;
+
+	QStringListIterator pin_iter(pinned);
+	while (pin_iter.hasNext()) {
+		const QStringList& ids = pin_iter.next().split(':');
+		if (ids.count() == 2)
+			keys.append(Prefetch::key(ids.at(0).toUShort(), ids.at(1).toUShort()));
+	}
+
+	if (m_bank && m_prog && nadjacent > 0) {
+		const uint16_t bank_id = m_bank->id();
+		const QList<uint16_t>& prog_ids = m_bank->progs().keys();
+		const int i = prog_ids.indexOf(m_prog->id());
+		const int n = prog_ids.count();
+		for (int d = 1; d <= nadjacent; ++d) {
+			if (i + d < n)
+				keys.append(Prefetch::key(bank_id, prog_ids.at(i + d)));
+			if (i - d >= 0)
+				keys.append(Prefetch::key(bank_id, prog_ids.at(i - d)));
+		}
+	}
+
+	// resolve preset files here (config is not thread-safe)...
+	const uint32_t current_key
+		= (m_bank && m_prog ? Prefetch::key(m_bank->id(), m_prog->id()) : 0);
+
+	Prefetch::Requests reqs;
+	QList<uint32_t> dups;
+
+	QListIterator<uint32_t> key_iter(keys);
+	while (key_iter.hasNext()) {
+		const uint32_t key = key_iter.next();
+		if (key == current_key || dups.contains(key))
+			continue;
+		dups.append(key);
+		Bank *bank = find_bank(key >> 16);
+		Prog *prog = (bank ? bank->find_prog(key & 0xffff) : nullptr);
+		if (prog == nullptr)
+			continue;
+		Prefetch::Request req;
+		req.key = key;
+		req.filename = drumkv1_param::presetFilename(prog->name());
+		req.stamp = 0;
+		if (!req.filename.isEmpty())
+			reqs.append(req);
+	}
+
+	m_prefetch->request(reqs, uint64_t(pConfig->iProgramsPrefetchMem) << 20);
+}
+
+
+void drumkv1_programs::prefetch_clear (void)
+{
+	if (m_prefetch) {
+		delete m_prefetch;
+		m_prefetch = nullptr;
 	}
 }
 
@@ -113,6 +113,10 @@ public:
 
 	void process_program(drumkv1 *pDrumk, uint16_t bank_id, uint16_t prog_id);
 
+	// prefetched programs (adjacent/pinned; background thread).
+	void prefetch_update(drumkv1 *pDrumk);
+	void prefetch_clear();
+
 	Bank *current_bank() const { return m_bank; }
 	Prog *current_prog() const { return m_prog; }
 
@@ -120,6 +124,9 @@ protected:
 
 	uint16_t current_bank_id() const;
 
+	// prefetched programs cache (LRU).
+	class Prefetch;
+
 	// current bank/prog. scheduled thread
 	class Sched : public drumkv1_sched
 	{
@@ -129,6 +136,10 @@ protected:
 		Sched (drumkv1 *pDrumk)
 			: drumkv1_sched(pDrumk, Programs), m_bank_id(0), m_prog_id(0) {}
 
+		// dtor.
+		~Sched ()
+			{ sync_drain(); }
+
 		// schedule (override)
 		void select_program(uint16_t bank_id, uint16_t prog_id)
 		{
@@ -169,6 +180,8 @@ private:
 	Prog *m_prog;
 
 	Banks m_banks;
+
+	Prefetch *m_prefetch;
 };
 
 
@@ -0,0 +1,508 @@
+// drumkv1_render.cpp
+//
+/****************************************************************************
+   Copyright (C) 2012-2021, rncbc aka Rui Nuno Capela. All rights reserved.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*****************************************************************************/
+
+#include "drumkv1_render.h"
+
+#include "drumkv1_param.h"
+#include "drumkv1_state.h"
+#include "drumkv1_sched.h"
+#include "drumkv1_denormal.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+
+#include <sndfile.h>
+
+#include <mutex>
+#include <complex>
+
+#include <cstring>
+#include <cmath>
+
+
+//-------------------------------------------------------------------------
+// drumkv1_render - headless offline engine instance.
+//
+
+// ctor.
+drumkv1_render::drumkv1_render (
+	uint16_t nchannels, float srate, uint32_t nblock )
+	: drumkv1(nchannels, srate, nblock), m_nblock(nblock)
+{
+	m_ins  = new float * [nchannels];
+	m_outs = new float * [nchannels];
+	for (uint16_t k = 0; k < nchannels; ++k) {
+		m_ins[k]  = new float [nblock];
+		m_outs[k] = new float [nblock];
+		::memset(m_ins[k], 0, nblock * sizeof(float));
+	}
+
+	drumkv1::reset();
+}
+
+
+// dtor.
+drumkv1_render::~drumkv1_render (void)
+{
+	const uint16_t nchannels = drumkv1::channels();
+	for (uint16_t k = 0; k < nchannels; ++k) {
+		delete [] m_outs[k];
+		delete [] m_ins[k];
+	}
+
+	delete [] m_outs;
+	delete [] m_ins;
+}
+
+
+// load a preset (XML or bundle) or a binary state file.
+bool drumkv1_render::loadFile ( const QString& sFilename )
+{
+	// presets loading changes the current directory: one at a time.
+	static std::mutex s_mutex;
+	const std::lock_guard<std::mutex> lock(s_mutex);
+
+	bool ret = false;
+
+	QFile file(sFilename);
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+
+	const QByteArray& data = file.readAll();
+	file.close();
+
+	if (drumkv1_state::isState(data)) {
+		// relative sample paths are from the state file location...
+		const QString sCurrentDir = QDir::currentPath();
+		QDir::setCurrent(QFileInfo(sFilename).absolutePath());
+		drumkv1_param::map_path mapPath;
+		drumkv1_state state(this);
+		ret = state.load(data, mapPath);
+		QDir::setCurrent(sCurrentDir);
+		drumkv1::stabilize();
+		drumkv1::reset();
+	} else {
+		ret = drumkv1_param::loadPreset(this, sFilename);
+	}
+
+	// let any detached work (eg. reversing samples) settle...
+	drumkv1_sched::sync_idle();
+
+	return ret;
+}
+
+
+// render a MIDI sequence, block by block.
+uint64_t drumkv1_render::render (
+	const drumkv1_smf& smf, Writer *pWriter, float fTail )
+{
+	const uint16_t nchannels = drumkv1::channels();
+	const float srate = drumkv1::sampleRate();
+
+	const drumkv1_smf::Events& events = smf.events();
+	const uint32_t nevents = events.size();
+
+	const uint64_t nend = uint64_t(::llround(smf.duration() * srate))
+		+ uint64_t(::lrintf(fTail * srate));
+
+	// no VLAs: channel count is only known at run-time.
+	std::vector<float *> ins(nchannels), outs(nchannels);
+
+	// same FPU mode as any other front-end.
+	const drumkv1_denormal denormal;
+
+	uint32_t ievent = 0;
+	uint64_t nframe = 0;
+
+	while (nframe < nend) {
+		const uint32_t nframes
+			= (nend - nframe < m_nblock ? uint32_t(nend - nframe) : m_nblock);
+		for (uint16_t k = 0; k < nchannels; ++k) {
+			ins[k]  = m_ins[k];
+			outs[k] = m_outs[k];
+		}
+		uint32_t ndelta = 0;
+		for ( ; ievent < nevents; ++ievent) {
+			const drumkv1_smf::Event& event = events[ievent];
+			const uint64_t ntime = uint64_t(::llround(event.time * srate));
+			if (ntime >= nframe + nframes)
+				break;
+			const uint32_t noffset
+				= (ntime > nframe ? uint32_t(ntime - nframe) : 0);
+			if (noffset > ndelta) {
+				const uint32_t nread = noffset - ndelta;
+				drumkv1::process(ins.data(), outs.data(), nread);
+				for (uint16_t k = 0; k < nchannels; ++k) {
+					ins[k]  += nread;
+					outs[k] += nread;
+				}
+				ndelta = noffset;
+			}
+			uint8_t data[3];
+			::memcpy(data, event.data, sizeof(data));
+			drumkv1::process_midi(data, event.size);
+		}
+		if (nframes > ndelta)
+			drumkv1::process(ins.data(), outs.data(), nframes - ndelta);
+		if (pWriter && !pWriter->write(m_outs, nchannels, nframes))
+			return 0;
+		nframe += nframes;
+	}
+
+	return nframe;
+}
+
+
+// sound file writer.
+class drumkv1_render_sndfile : public drumkv1_render::Writer
+{
+public:
+
+	drumkv1_render_sndfile() : m_file(nullptr), m_buffer(nullptr), m_nsize(0) {}
+
+	~drumkv1_render_sndfile() { close(); }
+
+	bool open(const QString& sFilename,
+		uint16_t nchannels, float srate, int iFormat)
+	{
+		SF_INFO info;
+		::memset(&info, 0, sizeof(info));
+		info.samplerate = int(srate);
+		info.channels = nchannels;
+		info.format = iFormat;
+		m_file = ::sf_open(sFilename.toUtf8().constData(), SFM_WRITE, &info);
+		return (m_file != nullptr);
+	}
+
+	void close()
+	{
+		if (m_file) {
+			::sf_close(m_file);
+			m_file = nullptr;
+		}
+		if (m_buffer) {
+			delete [] m_buffer;
+			m_buffer = nullptr;
+			m_nsize = 0;
+		}
+	}
+
+	bool write(float **buffers, uint16_t nchannels, uint32_t nframes)
+	{
+		const uint32_t nsize = nchannels * nframes;
+		if (m_nsize < nsize) {
+			if (m_buffer)
+				delete [] m_buffer;
+			m_buffer = new float [nsize];
+			m_nsize = nsize;
+		}
+		float *frames = m_buffer;
+		for (uint32_t i = 0; i < nframes; ++i) {
+			for (uint16_t k = 0; k < nchannels; ++k)
+				*frames++ = buffers[k][i];
+		}
+		return (::sf_writef_float(m_file, m_buffer, nframes) == sf_count_t(nframes));
+	}
+
+private:
+
+	SNDFILE *m_file;
+	float   *m_buffer;
+	uint32_t m_nsize;
+};
+
+
+// in-memory output.
+bool drumkv1_render::Buffer::write (
+	float **buffers, uint16_t nchannels, uint32_t nframes )
+{
+	if (m_frames.size() != nchannels)
+		m_frames.resize(nchannels);
+
+	for (uint16_t k = 0; k < nchannels; ++k)
+		m_frames[k].insert(m_frames[k].end(), buffers[k], buffers[k] + nframes);
+
+	return true;
+}
+
+
+// reference sound file loader (must be at the same rate).
+bool drumkv1_render::Buffer::load ( const QString& sFilename, float srate )
+{
+	clear();
+
+	SF_INFO info;
+	::memset(&info, 0, sizeof(info));
+	SNDFILE *file = ::sf_open(sFilename.toUtf8().constData(), SFM_READ, &info);
+	if (file == nullptr)
+		return false;
+
+	if (info.samplerate != int(srate) || info.channels < 1) {
+		::sf_close(file);
+		return false;
+	}
+
+	const uint16_t nchannels = info.channels;
+	const uint32_t nblock = 4096;
+	float *buffer = new float [nchannels * nblock];
+	std::vector<float *> frames(nchannels);
+	for (uint16_t k = 0; k < nchannels; ++k)
+		frames[k] = new float [nblock];
+
+	sf_count_t nread;
+	while ((nread = ::sf_readf_float(file, buffer, nblock)) > 0) {
+		const float *ptr = buffer;
+		for (sf_count_t i = 0; i < nread; ++i) {
+			for (uint16_t k = 0; k < nchannels; ++k)
+				frames[k][i] = *ptr++;
+		}
+		write(frames.data(), nchannels, uint32_t(nread));
+	}
+
+	for (uint16_t k = 0; k < nchannels; ++k)
+		delete [] frames[k];
+	delete [] buffer;
+
+	::sf_close(file);
+
+	// an empty reference is still a reference.
+	if (m_frames.empty())
+		m_frames.resize(nchannels);
+
+	return true;
+}
+
+
+// sound file saver.
+bool drumkv1_render::Buffer::save (
+	const QString& sFilename, float srate, int iFormat ) const
+{
+	const uint16_t nchannels = channels();
+	if (nchannels < 1)
+		return false;
+
+	drumkv1_render_sndfile file;
+	if (!file.open(sFilename, nchannels, srate, iFormat))
+		return false;
+
+	const uint32_t nframes = frames();
+	const uint32_t nblock = 4096;
+	std::vector<float *> buffers(nchannels);
+	for (uint32_t i = 0; i < nframes; i += nblock) {
+		for (uint16_t k = 0; k < nchannels; ++k)
+			buffers[k] = const_cast<float *> (m_frames[k].data()) + i;
+		if (!file.write(buffers.data(), nchannels,
+				(nframes - i < nblock ? nframes - i : nblock)))
+			return false;
+	}
+
+	return true;
+}
+
+
+void drumkv1_render::Buffer::clear (void)
+{
+	m_frames.clear();
+}
+
+
+// in-place radix-2 complex FFT (size must be a power of 2).
+static void drumkv1_render_fft ( std::vector<std::complex<double> >& x )
+{
+	const uint32_t n = x.size();
+
+	for (uint32_t i = 1, j = 0; i < n; ++i) {
+		uint32_t bit = (n >> 1);
+		for ( ; j & bit; bit >>= 1)
+			j ^= bit;
+		j ^= bit;
+		if (i < j)
+			std::swap(x[i], x[j]);
+	}
+
+	for (uint32_t len = 2; len <= n; len <<= 1) {
+		const double a = -2.0 * M_PI / double(len);
+		const std::complex<double> wlen(::cos(a), ::sin(a));
+		for (uint32_t i = 0; i < n; i += len) {
+			std::complex<double> w(1.0);
+			for (uint32_t j = 0; j < (len >> 1); ++j) {
+				const std::complex<double> u = x[i + j];
+				const std::complex<double> v = x[i + j + (len >> 1)] * w;
+				x[i + j] = u + v;
+				x[i + j + (len >> 1)] = u - v;
+				w *= wlen;
+			}
+		}
+	}
+}
+
+
+// windowed power spectrum (dB, full-scale sine = 0dB, floored).
+static void drumkv1_render_spectrum ( const float *frames, uint32_t nframes,
+	const std::vector<double>& window, std::vector<double>& spectrum )
+{
+	const uint32_t nsize = window.size();
+	const uint32_t nbins = (nsize >> 1) + 1;
+
+	std::vector<std::complex<double> > x(nsize);
+	for (uint32_t i = 0; i < nsize; ++i)
+		x[i] = (i < nframes ? window[i] * double(frames[i]) : 0.0);
+
+	drumkv1_render_fft(x);
+
+	const double fs = double(nsize) * double(nsize) / 16.0;
+	spectrum.resize(nbins);
+	for (uint32_t i = 0; i < nbins; ++i) {
+		const double db = 10.0 * ::log10(std::norm(x[i]) / fs + 1E-12);
+		spectrum[i] = (db < -120.0 ? -120.0 : db);
+	}
+}
+
+
+// output difference.
+drumkv1_render::Diff drumkv1_render::compare ( const Buffer& a, const Buffer& b )
+{
+	Diff diff;
+	diff.max_abs  = 0.0;
+	diff.rms      = 0.0;
+	diff.spectral = 0.0;
+	diff.frames_a = a.frames();
+	diff.frames_b = b.frames();
+
+	const uint16_t nchannels
+		= (a.channels() < b.channels() ? a.channels() : b.channels());
+	const uint32_t nframes
+		= (a.frames() < b.frames() ? a.frames() : b.frames());
+
+	if (nchannels < 1 || nframes < 1)
+		return diff;
+
+	// sample differences...
+	double sum2 = 0.0;
+	for (uint16_t k = 0; k < nchannels; ++k) {
+		const float *pa = a.data(k);
+		const float *pb = b.data(k);
+		for (uint32_t i = 0; i < nframes; ++i) {
+			const double d = ::fabs(double(pa[i]) - double(pb[i]));
+			if (diff.max_abs < d)
+				diff.max_abs = d;
+			sum2 += d * d;
+		}
+	}
+	diff.rms = ::sqrt(sum2 / (double(nchannels) * double(nframes)));
+
+	// log-spectral distance, over half-overlapped Hann frames,
+	// silent ones (on both sides) left out...
+	const uint32_t nsize = 2048;
+	const uint32_t nhop = (nsize >> 1);
+	std::vector<double> window(nsize);
+	for (uint32_t i = 0; i < nsize; ++i)
+		window[i] = 0.5 - 0.5 * ::cos(2.0 * M_PI * double(i) / double(nsize));
+
+	std::vector<double> sa, sb;
+	double sum = 0.0;
+	uint32_t count = 0;
+	for (uint16_t k = 0; k < nchannels; ++k) {
+		for (uint32_t i = 0; i < nframes; i += nhop) {
+			const uint32_t n = (nframes - i < nsize ? nframes - i : nsize);
+			drumkv1_render_spectrum(a.data(k) + i, n, window, sa);
+			drumkv1_render_spectrum(b.data(k) + i, n, window, sb);
+			double peak = -120.0;
+			double d2 = 0.0;
+			for (uint32_t j = 0; j < sa.size(); ++j) {
+				const double d = sa[j] - sb[j];
+				d2 += d * d;
+				if (peak < sa[j]) peak = sa[j];
+				if (peak < sb[j]) peak = sb[j];
+			}
+			if (peak > -100.0) {
+				sum += ::sqrt(d2 / double(sa.size()));
+				++count;
+			}
+			if (n < nsize)
+				break;
+		}
+	}
+	if (count > 0)
+		diff.spectral = sum / double(count);
+
+	return diff;
+}
+
+
+// render a MIDI sequence to a sound file.
+uint64_t drumkv1_render::render ( const drumkv1_smf& smf,
+	const QString& sFilename, int iFormat, float fTail )
+{
+	drumkv1_render_sndfile file;
+	if (!file.open(sFilename,
+			drumkv1::channels(), drumkv1::sampleRate(), iFormat))
+		return 0;
+
+	return render(smf, &file, fTail);
+}
+
+
+// no observers here.
+void drumkv1_render::updatePreset ( bool /*bDirty*/ )
+{
+	// nothing to do here...
+}
+
+
+void drumkv1_render::updateParam ( drumkv1::ParamIndex /*index*/ )
+{
+	// nothing to do here...
+}
+
+
+void drumkv1_render::updateParams (void)
+{
+	// nothing to do here...
+}
+
+
+void drumkv1_render::updateSample (void)
+{
+	// nothing to do here...
+}
+
+
+void drumkv1_render::updateOffsetRange (void)
+{
+	// nothing to do here...
+}
+
+
+void drumkv1_render::selectSample ( int key )
+{
+	drumkv1::setCurrentElementEx(key);
+}
+
+
+void drumkv1_render::updateTuning (void)
+{
+	drumkv1::resetTuning();
+}
+
+
+// end of drumkv1_render.cpp
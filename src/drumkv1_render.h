@@ -0,0 +1,140 @@
+// drumkv1_render.h
+//
+/****************************************************************************
+   Copyright (C) 2012-2021, rncbc aka Rui Nuno Capela. All rights reserved.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*****************************************************************************/
+
+#ifndef __drumkv1_render_h
+#define __drumkv1_render_h
+
+#include "drumkv1.h"
+#include "drumkv1_smf.h"
+
+#include <QString>
+
+#include <vector>
+
+
+//-------------------------------------------------------------------------
+// drumkv1_render - headless offline engine instance.
+//
+
+class drumkv1_render : public drumkv1
+{
+public:
+
+	// ctor.
+	drumkv1_render(uint16_t nchannels, float srate, uint32_t nblock);
+
+	// dtor.
+	~drumkv1_render();
+
+	// load a preset (XML or bundle) or a binary state file,
+	// then wait for any detached (scheduled) work to settle.
+	bool loadFile(const QString& sFilename);
+
+	// rendered block sink (de-interleaved).
+	class Writer
+	{
+	public:
+
+		virtual ~Writer() {}
+
+		virtual bool write(float **buffers, uint16_t nchannels, uint32_t nframes) = 0;
+	};
+
+	// rendered output kept in memory (eg. for comparison).
+	class Buffer : public Writer
+	{
+	public:
+
+		Buffer() {}
+
+		bool write(float **buffers, uint16_t nchannels, uint32_t nframes);
+
+		// reference sound file load/save.
+		bool load(const QString& sFilename, float srate);
+		bool save(const QString& sFilename, float srate, int iFormat) const;
+
+		void clear();
+
+		uint16_t channels() const
+			{ return m_frames.size(); }
+		uint32_t frames() const
+			{ return (m_frames.empty() ? 0 : m_frames[0].size()); }
+		const float *data(uint16_t k) const
+			{ return m_frames[k].data(); }
+
+	private:
+
+		std::vector<std::vector<float> > m_frames;
+	};
+
+	// output difference, over the common length and channels;
+	// spectral is the mean log-spectral distance (dB).
+	struct Diff
+	{
+		double max_abs;
+		double rms;
+		double spectral;
+		uint32_t frames_a;
+		uint32_t frames_b;
+	};
+
+	static Diff compare(const Buffer& a, const Buffer& b);
+
+	// render a MIDI sequence, block by block, with sample-accurate
+	// event placement, plus some tail; returns the number of frames
+	// rendered (or zero on writer failure).
+	uint64_t render(const drumkv1_smf& smf, Writer *pWriter, float fTail);
+
+	// render a MIDI sequence to a sound file (libsndfile format).
+	uint64_t render(const drumkv1_smf& smf,
+		const QString& sFilename, int iFormat, float fTail);
+
+	// block size.
+	uint32_t blockSize() const
+		{ return m_nblock; }
+
+protected:
+
+	void updatePreset(bool bDirty);
+	void updateParam(drumkv1::ParamIndex index);
+	void updateParams();
+
+	void updateSample();
+
+	void updateOffsetRange();
+
+	void selectSample(int key);
+
+	void updateTuning();
+
+private:
+
+	// instance variables.
+	uint32_t m_nblock;
+
+	float **m_ins;
+	float **m_outs;
+};
+
+
+#endif	// __drumkv1_render_h
+
+// end of drumkv1_render.h
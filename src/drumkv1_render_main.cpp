@@ -0,0 +1,489 @@
+// drumkv1_render_main.cpp
+//
+/****************************************************************************
+   Copyright (C) 2012-2021, rncbc aka Rui Nuno Capela. All rights reserved.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*****************************************************************************/
+
+#include "drumkv1_render.h"
+#include "drumkv1_bundle.h"
+#include "drumkv1_sample.h"
+#include "drumkv1_resampler.h"
+#include "drumkv1_config.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QCommandLineOption>
+#include <QFileInfo>
+#include <QThread>
+#include <QDir>
+
+#include <sndfile.h>
+
+#include <atomic>
+#include <chrono>
+
+#include <cstdio>
+#include <cstring>
+
+
+//-------------------------------------------------------------------------
+// drumkv1_render_job - one MIDI file to one sound file.
+//
+
+struct drumkv1_render_split
+{
+	uint32_t nblock;
+	drumkv1_render::Diff diff;
+};
+
+
+struct drumkv1_render_job
+{
+	QString  sMidiFile;
+	QString  sOutputFile;
+	QString  sReferenceFile;
+	uint64_t nframes;
+	double   secs;
+	QString  sError;
+	drumkv1_render::Diff diff;
+	QList<drumkv1_render_split> splits;
+};
+
+
+struct drumkv1_render_opts
+{
+	QString  sPresetFile;
+	uint16_t nchannels;
+	float    srate;
+	uint32_t nblock;
+	float    fTail;
+	int      iFormat;
+	bool     bWrite;
+	QString  sReferenceDir;
+	QList<uint32_t> splits;
+	double   fMaxAbs;
+	double   fRms;
+	double   fSpectral;
+	double   fSplitMaxAbs;
+};
+
+
+// golden-render checks (reference and block-split).
+static bool drumkv1_render_diff_ok (
+	const drumkv1_render::Diff& diff, const drumkv1_render_opts& opts )
+{
+	return (diff.frames_a == diff.frames_b
+		&& diff.max_abs <= opts.fMaxAbs
+		&& diff.rms <= opts.fRms
+		&& diff.spectral <= opts.fSpectral);
+}
+
+
+static bool drumkv1_render_split_ok (
+	const drumkv1_render::Diff& diff, const drumkv1_render_opts& opts )
+{
+	return (diff.frames_a == diff.frames_b
+		&& diff.max_abs <= opts.fSplitMaxAbs);
+}
+
+
+// worker thread: one engine instance per job.
+class drumkv1_render_thread : public QThread
+{
+public:
+
+	drumkv1_render_thread(const drumkv1_render_opts& opts,
+		QList<drumkv1_render_job>& jobs, std::atomic<int>& next)
+		: QThread(), m_opts(opts), m_jobs(jobs), m_next(next) {}
+
+protected:
+
+	void run()
+	{
+		const int njobs = m_jobs.count();
+		for (;;) {
+			const int i = m_next.fetch_add(1);
+			if (i >= njobs)
+				break;
+			process(m_jobs[i]);
+		}
+	}
+
+	void process(drumkv1_render_job& job)
+	{
+		drumkv1_smf smf;
+		if (!smf.open(job.sMidiFile)) {
+			job.sError = QObject::tr("could not read MIDI file");
+			return;
+		}
+
+		// plain render, straight to file...
+		if (job.sReferenceFile.isEmpty() && m_opts.splits.isEmpty()) {
+			render(job, smf, m_opts.nblock, nullptr);
+			return;
+		}
+
+		// golden-render checks, in memory...
+		drumkv1_render::Buffer buffer;
+		if (!render(job, smf, m_opts.nblock, &buffer))
+			return;
+
+		if (m_opts.bWrite && !buffer.save(
+				job.sOutputFile, m_opts.srate, m_opts.iFormat)) {
+			job.sError = QObject::tr("could not write output file");
+			return;
+		}
+
+		if (!job.sReferenceFile.isEmpty()) {
+			drumkv1_render::Buffer reference;
+			if (!reference.load(job.sReferenceFile, m_opts.srate)) {
+				job.sError = QObject::tr("could not read reference file");
+				return;
+			}
+			if (reference.channels() != buffer.channels()) {
+				job.sError = QObject::tr("reference channels mismatch");
+				return;
+			}
+			job.diff = drumkv1_render::compare(buffer, reference);
+		}
+
+		// same input, other block sizes: same output...
+		foreach (const uint32_t nblock, m_opts.splits) {
+			drumkv1_render::Buffer buffer2;
+			if (!render(job, smf, nblock, &buffer2))
+				return;
+			drumkv1_render_split split;
+			split.nblock = nblock;
+			split.diff = drumkv1_render::compare(buffer, buffer2);
+			job.splits.append(split);
+		}
+	}
+
+	// one engine instance per render; the first one gets timed.
+	bool render(drumkv1_render_job& job, const drumkv1_smf& smf,
+		uint32_t nblock, drumkv1_render::Buffer *pBuffer)
+	{
+		drumkv1_render render(m_opts.nchannels, m_opts.srate, nblock);
+		if (!m_opts.sPresetFile.isEmpty()
+			&& !render.loadFile(m_opts.sPresetFile)) {
+			job.sError = QObject::tr("could not load preset");
+			return false;
+		}
+
+		const std::chrono::steady_clock::time_point t0
+			= std::chrono::steady_clock::now();
+		const uint64_t nframes = (pBuffer
+			? render.render(smf, pBuffer, m_opts.fTail)
+			: render.render(smf, job.sOutputFile, m_opts.iFormat, m_opts.fTail));
+		const std::chrono::steady_clock::time_point t1
+			= std::chrono::steady_clock::now();
+
+		if (nframes == 0) {
+			job.sError = QObject::tr("could not write output file");
+			return false;
+		}
+
+		if (job.nframes == 0) {
+			job.nframes = nframes;
+			job.secs = std::chrono::duration<double>(t1 - t0).count();
+		}
+
+		return true;
+	}
+
+private:
+
+	const drumkv1_render_opts& m_opts;
+
+	QList<drumkv1_render_job>& m_jobs;
+	std::atomic<int>& m_next;
+};
+
+
+//-------------------------------------------------------------------------
+// main
+
+static int drumkv1_render_format ( const QString& sFormat )
+{
+	if (sFormat == "wav")
+		return SF_FORMAT_WAV | SF_FORMAT_FLOAT;
+	if (sFormat == "flac")
+		return SF_FORMAT_FLAC | SF_FORMAT_PCM_24;
+	if (sFormat == "ogg")
+		return SF_FORMAT_OGG | SF_FORMAT_VORBIS;
+
+	return 0;
+}
+
+
+static int drumkv1_render_quality ( const QString& sQuality )
+{
+	for (int i = drumkv1_sample::Draft; i <= drumkv1_sample::Best; ++i) {
+		const drumkv1_sample::Quality quality = drumkv1_sample::Quality(i);
+		if (sQuality == drumkv1_sample::qualityName(quality))
+			return i;
+	}
+
+	return -1;
+}
+
+
+int main ( int argc, char *argv[] )
+{
+	QCoreApplication app(argc, argv);
+	app.setApplicationName(DRUMKV1_TITLE "_render");
+	app.setApplicationVersion(CONFIG_BUILD_VERSION);
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription(
+		DRUMKV1_TITLE " - " + QObject::tr("headless batch renderer."));
+
+	parser.addOption({{"p", "preset"},
+		QObject::tr("Load preset, kit bundle or binary state file"), "file"});
+	parser.addOption({{"o", "output-dir"},
+		QObject::tr("Output directory (default: current)"), "dir"});
+	parser.addOption({{"f", "format"},
+		QObject::tr("Output file format: wav, flac or ogg (default: wav)"), "format", "wav"});
+	parser.addOption({{"r", "sample-rate"},
+		QObject::tr("Sample rate (default: 48000)"), "hz", "48000"});
+	parser.addOption({{"b", "block-size"},
+		QObject::tr("Processing block size (default: 256)"), "frames", "256"});
+	parser.addOption({{"c", "channels"},
+		QObject::tr("Number of audio channels (default: 2)"), "n", "2"});
+	parser.addOption({{"q", "quality"},
+		QObject::tr("Sample resampler quality: draft, medium or best"
+			" (default: as configured)"), "quality"});
+	parser.addOption({{"t", "tail"},
+		QObject::tr("Seconds rendered past the last event (default: 2)"), "secs", "2"});
+	parser.addOption({{"R", "reference"},
+		QObject::tr("Compare against reference renders of the same name"
+			" in this directory (no output unless -o is given)"), "dir"});
+	parser.addOption({{"s", "split"},
+		QObject::tr("Comma separated block sizes that must render"
+			" the same output (eg. 64,1000)"), "list"});
+	parser.addOption({"max-abs",
+		QObject::tr("Reference tolerance, max. abs. error (default: 1e-4)"), "value", "1e-4"});
+	parser.addOption({"rms",
+		QObject::tr("Reference tolerance, RMS error (default: 1e-5)"), "value", "1e-5"});
+	parser.addOption({"spectral",
+		QObject::tr("Reference tolerance, log-spectral distance (default: 0.5dB)"), "db", "0.5"});
+	parser.addOption({"split-max-abs",
+		QObject::tr("Block-split tolerance, max. abs. error (default: 1e-6)"), "value", "1e-6"});
+	parser.addOption({{"x", "export"},
+		QObject::tr("Convert the preset (-p) to a kit bundle file"
+			" and exit, rendering nothing"), "file"});
+	parser.addOption({{"i", "import"},
+		QObject::tr("Convert the kit bundle (-p) to a preset file"
+			" and exit, rendering nothing"), "file"});
+	parser.addOption({{"j", "jobs"},
+		QObject::tr("Number of parallel jobs (default: %1)")
+			.arg(QThread::idealThreadCount()), "n"});
+	parser.addHelpOption();
+	parser.addVersionOption();
+	parser.addPositionalArgument("midi-files",
+		QObject::tr("Standard MIDI files to render"),
+		QObject::tr("midi-file..."));
+	parser.process(app);
+
+	drumkv1_render_opts opts;
+	opts.sPresetFile = parser.value("preset");
+	opts.nchannels = parser.value("channels").toUShort();
+	opts.srate = parser.value("sample-rate").toFloat();
+	opts.nblock = parser.value("block-size").toUInt();
+	opts.fTail = parser.value("tail").toFloat();
+	opts.iFormat = drumkv1_render_format(parser.value("format"));
+	opts.sReferenceDir = parser.value("reference");
+	opts.fMaxAbs = parser.value("max-abs").toDouble();
+	opts.fRms = parser.value("rms").toDouble();
+	opts.fSpectral = parser.value("spectral").toDouble();
+	opts.fSplitMaxAbs = parser.value("split-max-abs").toDouble();
+
+	int iQuality = int(drumkv1_sample::quality());
+	if (parser.isSet("quality"))
+		iQuality = drumkv1_render_quality(parser.value("quality"));
+
+	bool bSplits = true;
+	if (parser.isSet("split")) {
+		foreach (const QString& sBlock, parser.value("split").split(',')) {
+			const uint32_t nblock = sBlock.toUInt();
+			if (nblock < 1)
+				bSplits = false;
+			else
+				opts.splits.append(nblock);
+		}
+	}
+
+	// checking only: write output files only if asked to.
+	opts.bWrite = (parser.isSet("output-dir")
+		|| (opts.sReferenceDir.isEmpty() && opts.splits.isEmpty()));
+
+	if (opts.nchannels < 1 || opts.srate < 1.0f
+		|| opts.nblock < 1 || opts.fTail < 0.0f || opts.iFormat == 0
+		|| iQuality < 0 || !bSplits || opts.fMaxAbs < 0.0 || opts.fRms < 0.0
+		|| opts.fSpectral < 0.0 || opts.fSplitMaxAbs < 0.0) {
+		::fputs(QObject::tr("Invalid option value.\n").toUtf8().constData(), stderr);
+		return 1;
+	}
+
+	// kit bundle conversion only...
+	if (parser.isSet("export") || parser.isSet("import")) {
+		const bool bExport = parser.isSet("export");
+		const QString& sFilename
+			= parser.value(bExport ? "export" : "import");
+		if (opts.sPresetFile.isEmpty() || sFilename.isEmpty()) {
+			::fputs(QObject::tr("Conversion needs a preset (-p).\n")
+				.toUtf8().constData(), stderr);
+			return 1;
+		}
+		drumkv1_render render(opts.nchannels, opts.srate, opts.nblock);
+		const bool bRet = (bExport
+			? drumkv1_bundle::exportPreset(&render, opts.sPresetFile, sFilename)
+			: drumkv1_bundle::importBundle(&render, opts.sPresetFile, sFilename));
+		if (!bRet) {
+			::fprintf(stderr, "%s: %s\n", sFilename.toUtf8().constData(),
+				QObject::tr("could not convert preset").toUtf8().constData());
+			return 1;
+		}
+		::fprintf(stdout, "%s: ok\n", sFilename.toUtf8().constData());
+		return 0;
+	}
+
+	const QDir outputDir(parser.isSet("output-dir")
+		? parser.value("output-dir") : QDir::currentPath());
+	const QDir referenceDir(opts.sReferenceDir);
+	const QString& sSuffix = parser.value("format");
+
+	QList<drumkv1_render_job> jobs;
+	foreach (const QString& sMidiFile, parser.positionalArguments()) {
+		const QString& sName
+			= QFileInfo(sMidiFile).completeBaseName() + '.' + sSuffix;
+		drumkv1_render_job job;
+		job.sMidiFile = sMidiFile;
+		job.sOutputFile = outputDir.absoluteFilePath(sName);
+		if (!opts.sReferenceDir.isEmpty())
+			job.sReferenceFile = referenceDir.absoluteFilePath(sName);
+		job.nframes = 0;
+		job.secs = 0.0;
+		::memset(&job.diff, 0, sizeof(job.diff));
+		jobs.append(job);
+	}
+
+	if (jobs.isEmpty()) {
+		parser.showHelp(1);
+		return 1;
+	}
+
+	// fast preview or best final render: the same for all jobs,
+	// whatever each engine instance finds configured.
+	if (parser.isSet("quality"))
+		drumkv1_sample::setQuality(drumkv1_sample::Quality(iQuality), true);
+
+	int nthreads = QThread::idealThreadCount();
+	if (parser.isSet("jobs"))
+		nthreads = parser.value("jobs").toInt();
+	if (nthreads > jobs.count())
+		nthreads = jobs.count();
+	if (nthreads < 1)
+		nthreads = 1;
+
+	const std::chrono::steady_clock::time_point t0
+		= std::chrono::steady_clock::now();
+
+	std::atomic<int> next(0);
+	QList<drumkv1_render_thread *> threads;
+	for (int i = 0; i < nthreads; ++i) {
+		drumkv1_render_thread *pThread
+			= new drumkv1_render_thread(opts, jobs, next);
+		pThread->start();
+		threads.append(pThread);
+	}
+
+	foreach (drumkv1_render_thread *pThread, threads) {
+		pThread->wait();
+		delete pThread;
+	}
+
+	const std::chrono::steady_clock::time_point t1
+		= std::chrono::steady_clock::now();
+	const double secs = std::chrono::duration<double>(t1 - t0).count();
+
+	// report...
+	int nerrors = 0;
+	int nfailed = 0;
+	uint64_t nframes = 0;
+	foreach (const drumkv1_render_job& job, jobs) {
+		if (!job.sError.isEmpty()) {
+			::fprintf(stderr, "%s: %s\n",
+				job.sMidiFile.toUtf8().constData(),
+				job.sError.toUtf8().constData());
+			++nerrors;
+			continue;
+		}
+		const QByteArray& aName = (opts.bWrite
+			? job.sOutputFile : job.sMidiFile).toUtf8();
+		const double audio = double(job.nframes) / opts.srate;
+		::fprintf(stdout, "%s: %.3fs in %.3fs (%.1fx real-time)\n",
+			aName.constData(), audio, job.secs,
+			job.secs > 0.0 ? audio / job.secs : 0.0);
+		nframes += job.nframes;
+		if (!job.sReferenceFile.isEmpty()) {
+			const drumkv1_render::Diff& diff = job.diff;
+			const bool bOk = drumkv1_render_diff_ok(diff, opts);
+			::fprintf(stdout, "%s: reference: frames %u/%u, max-abs %g,"
+				" rms %g, spectral %.3fdB: %s\n", aName.constData(),
+				diff.frames_a, diff.frames_b, diff.max_abs, diff.rms,
+				diff.spectral, bOk ? "ok" : "FAILED");
+			if (!bOk)
+				++nfailed;
+		}
+		foreach (const drumkv1_render_split& split, job.splits) {
+			const drumkv1_render::Diff& diff = split.diff;
+			const bool bOk = drumkv1_render_split_ok(diff, opts);
+			::fprintf(stdout, "%s: block %u vs. %u: frames %u/%u,"
+				" max-abs %g: %s\n", aName.constData(),
+				opts.nblock, split.nblock, diff.frames_a, diff.frames_b,
+				diff.max_abs, bOk ? "ok" : "FAILED");
+			if (!bOk)
+				++nfailed;
+		}
+	}
+
+	drumkv1_resampler::Table::Stats st;
+	drumkv1_resampler::Table::stats(st);
+	::fprintf(stdout, "resampler: %s kernel, %s quality,"
+		" %u table(s) cached (%.1fKB), %u hit(s), %u miss(es)\n",
+		drumkv1_resampler::kernel(),
+		drumkv1_sample::qualityName(drumkv1_sample::quality()),
+		st.tables, double(st.bytes) / 1024.0, st.hits, st.misses);
+
+	const double audio = double(nframes) / opts.srate;
+	::fprintf(stdout, "total: %d file(s), %.3fs in %.3fs"
+		" on %d thread(s) (%.1fx real-time)\n",
+		jobs.count() - nerrors, audio, secs, nthreads,
+		secs > 0.0 ? audio / secs : 0.0);
+
+	if (nfailed > 0) {
+		::fprintf(stdout, "%d check(s) FAILED\n", nfailed);
+		return 2;
+	}
+
+	return (nerrors > 0 ? 1 : 0);
+}
+
+
+// end of drumkv1_render_main.cpp
@@ -27,6 +27,135 @@
 
 #include <cmath>
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DRUMKV1_RESAMPLER_X86 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define DRUMKV1_RESAMPLER_NEON 1
+#include <arm_neon.h>
+#endif
+
+
+// ----------------------------------------------------------------------------
+// drumkv1_resampler - polyphase inner-product kernels.
+//
+// Computes sum(q1[i] * c1[i] + q2[i] * c2[i]), i = 0..n-1,
+// where both data and coefficient vectors are contiguous.
+
+static float dotp_scalar ( const float *q1, const float *c1,
+	const float *q2, const float *c2, unsigned int n )
+{
+	float s = 0.0f;
+	for (unsigned int i = 0; i < n; ++i)
+		s += q1[i] * c1[i] + q2[i] * c2[i];
+	return s;
+}
+
+
+#ifdef DRUMKV1_RESAMPLER_X86
+
+__attribute__((target("sse")))
+static float dotp_sse ( const float *q1, const float *c1,
+	const float *q2, const float *c2, unsigned int n )
+{
+	__m128 v = _mm_setzero_ps();
+	unsigned int i = 0;
+	for (; i + 4 <= n; i += 4) {
+		v = _mm_add_ps(v, _mm_mul_ps(_mm_loadu_ps(q1 + i), _mm_loadu_ps(c1 + i)));
+		v = _mm_add_ps(v, _mm_mul_ps(_mm_loadu_ps(q2 + i), _mm_loadu_ps(c2 + i)));
+	}
+	float t[4];
+	_mm_storeu_ps(t, v);
+	float s = (t[0] + t[1]) + (t[2] + t[3]);
+	for (; i < n; ++i)
+		s += q1[i] * c1[i] + q2[i] * c2[i];
+	return s;
+}
+
+
+__attribute__((target("avx2,fma")))
+static float dotp_avx2 ( const float *q1, const float *c1,
+	const float *q2, const float *c2, unsigned int n )
+{
+	__m256 v = _mm256_setzero_ps();
+	unsigned int i = 0;
+	for (; i + 8 <= n; i += 8) {
+		v = _mm256_fmadd_ps(_mm256_loadu_ps(q1 + i), _mm256_loadu_ps(c1 + i), v);
+		v = _mm256_fmadd_ps(_mm256_loadu_ps(q2 + i), _mm256_loadu_ps(c2 + i), v);
+	}
+	__m128 w = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+	for (; i + 4 <= n; i += 4) {
+		w = _mm_fmadd_ps(_mm_loadu_ps(q1 + i), _mm_loadu_ps(c1 + i), w);
+		w = _mm_fmadd_ps(_mm_loadu_ps(q2 + i), _mm_loadu_ps(c2 + i), w);
+	}
+	float t[4];
+	_mm_storeu_ps(t, w);
+	float s = (t[0] + t[1]) + (t[2] + t[3]);
+	for (; i < n; ++i)
+		s += q1[i] * c1[i] + q2[i] * c2[i];
+	return s;
+}
+
+#endif	// DRUMKV1_RESAMPLER_X86
+
+
+#ifdef DRUMKV1_RESAMPLER_NEON
+
+static float dotp_neon ( const float *q1, const float *c1,
+	const float *q2, const float *c2, unsigned int n )
+{
+	float32x4_t v = vdupq_n_f32(0.0f);
+	unsigned int i = 0;
+	for (; i + 4 <= n; i += 4) {
+		v = vmlaq_f32(v, vld1q_f32(q1 + i), vld1q_f32(c1 + i));
+		v = vmlaq_f32(v, vld1q_f32(q2 + i), vld1q_f32(c2 + i));
+	}
+	float t[4];
+	vst1q_f32(t, v);
+	float s = (t[0] + t[1]) + (t[2] + t[3]);
+	for (; i < n; ++i)
+		s += q1[i] * c1[i] + q2[i] * c2[i];
+	return s;
+}
+
+#endif	// DRUMKV1_RESAMPLER_NEON
+
+
+// Best kernel available on this CPU.
+struct drumkv1_resampler_kernel
+{
+	drumkv1_resampler_kernel() : proc(dotp_scalar), name("scalar")
+	{
+	#ifdef DRUMKV1_RESAMPLER_X86
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+			proc = dotp_avx2;
+			name = "avx2";
+		}
+		else
+		if (__builtin_cpu_supports("sse")) {
+			proc = dotp_sse;
+			name = "sse";
+		}
+	#endif
+	#ifdef DRUMKV1_RESAMPLER_NEON
+		proc = dotp_neon;
+		name = "neon";
+	#endif
+	}
+
+	drumkv1_resampler::DotProc proc;
+	const char *name;
+};
+
+static const drumkv1_resampler_kernel g_kernel;
+
+
+const char *drumkv1_resampler::kernel (void)
+{
+	return g_kernel.name;
+}
+
 
 // ----------------------------------------------------------------------------
 // drumkv1_resampler
@@ -51,95 +180,145 @@ static float wind ( float x )
 }
 
 
-drumkv1_resampler::Table *drumkv1_resampler::Table::g_list = nullptr;
-drumkv1_resampler::Mutex  drumkv1_resampler::Table::g_mutex;
+// Lock-free table cache: an insert-only list, where unused
+// tables are kept around for reuse and only freed on exit.
+std::atomic<drumkv1_resampler::Table *> drumkv1_resampler::Table::g_list(nullptr);
+
+std::atomic<unsigned int> drumkv1_resampler::Table::g_hits(0);
+std::atomic<unsigned int> drumkv1_resampler::Table::g_misses(0);
+
+
+// Table cache cleanup (on exit).
+struct drumkv1_resampler_tables
+{
+	~drumkv1_resampler_tables()
+	{
+		drumkv1_resampler::Table::Stats st;
+		drumkv1_resampler::Table::stats(st);
+		if (st.used == 0)
+			drumkv1_resampler::Table::purge();
+	}
+};
+
+static drumkv1_resampler_tables g_tables;
 
 
 drumkv1_resampler::Table::Table (
 	float fr0, unsigned int hl0, unsigned int np0 )
-	: next(nullptr), refc(0), ctab(nullptr), fr(fr0), hl(hl0), np(np0)
+	: next(nullptr), refc(0), ctab(nullptr), rtab(nullptr),
+		fr(fr0), hl(hl0), np(np0)
 {
 	unsigned int i, j;
 	float t;
-	float *ptab;
+	float *ptab, *qtab;
 
+	// rtab holds each phase row reversed, so that the
+	// backward half of the inner product is contiguous.
 	ctab = new float [hl * (np + 1)];
+	rtab = new float [hl * (np + 1)];
 	ptab = ctab;
+	qtab = rtab;
 	for (j = 0; j <= np; ++j) {
 		t = float(j) / float(np);
 		for (i = 0; i < hl; ++i) {
 			ptab[hl - i - 1] = float(fr * sinc(t * fr) * wind(t / hl));
+			qtab[i] = ptab[hl - i - 1];
 			t += 1.0f;
 		}
 		ptab += hl;
+		qtab += hl;
 	}
 }
 
 
 drumkv1_resampler::Table::~Table (void)
 {
+	delete [] rtab;
 	delete [] ctab;
 }
 
 
-drumkv1_resampler::Table *drumkv1_resampler::Table::create (
-	float fr0, unsigned int hl0, unsigned int np0 )
+drumkv1_resampler::Table *drumkv1_resampler::Table::lookup (
+	Table *p, Table *end, float fr0, unsigned int hl0, unsigned int np0 )
 {
-	Table *p;
+	for (; p && p != end; p = p->next) {
+		if (p->matches(fr0, hl0, np0))
+			return p;
+	}
 
-	g_mutex.lock();
+	return nullptr;
+}
 
-	p = g_list;
 
-	while (p) {
-		if ((fr0 >= p->fr * 0.999f) &&
-			(fr0 <= p->fr * 1.001f) &&
-			(hl0 == p->hl) && (np0 == p->np)) {
-			p->refc++;
-			g_mutex.unlock();
+drumkv1_resampler::Table *drumkv1_resampler::Table::create (
+	float fr0, unsigned int hl0, unsigned int np0 )
+{
+	Table *head = g_list.load(std::memory_order_acquire);
+	Table *p = lookup(head, nullptr, fr0, hl0, np0);
+	if (p) {
+		p->refc.fetch_add(1, std::memory_order_relaxed);
+		g_hits.fetch_add(1, std::memory_order_relaxed);
+		return p;
+	}
+
+	// miss: build it outside of any critical section...
+	Table *q = new drumkv1_resampler::Table(fr0, hl0, np0);
+	q->refc.store(1, std::memory_order_relaxed);
+	q->next = head;
+
+	while (!g_list.compare_exchange_weak(q->next, q,
+			std::memory_order_release, std::memory_order_acquire)) {
+		// someone else got in first; check whether
+		// it was for the very same table...
+		p = lookup(q->next, head, fr0, hl0, np0);
+		if (p) {
+			p->refc.fetch_add(1, std::memory_order_relaxed);
+			g_hits.fetch_add(1, std::memory_order_relaxed);
+			delete q;
 			return p;
 		}
-		p = p->next;
+		head = q->next;
 	}
 
-	p = new drumkv1_resampler::Table(fr0, hl0, np0);
-	p->refc = 1;
-	p->next = g_list;
-	g_list  = p;
-
-	g_mutex.unlock();
-
-	return p;
+	g_misses.fetch_add(1, std::memory_order_relaxed);
+	return q;
 }
 
 
 void drumkv1_resampler::Table::destroy ( drumkv1_resampler::Table *table )
 {
-	Table *p, *q;
+	// tables are left cached when unreferenced.
+	if (table)
+		table->refc.fetch_sub(1, std::memory_order_relaxed);
+}
 
-	g_mutex.lock();
 
-	if (table) {
-		table->refc--;
-		if (table->refc == 0) {
-			p = g_list;
-			q = nullptr;
-			while (p) {
-				if (p == table) {
-					if (q)
-						q->next = table->next;
-					else
-						g_list = table->next;
-					break;
-				}
-				q = p;
-				p = p->next;
-			}
-			delete table;
-		}
+void drumkv1_resampler::Table::stats ( Stats& st )
+{
+	st.hits   = g_hits.load(std::memory_order_relaxed);
+	st.misses = g_misses.load(std::memory_order_relaxed);
+	st.tables = 0;
+	st.used   = 0;
+	st.bytes  = 0;
+
+	Table *p = g_list.load(std::memory_order_acquire);
+	for (; p; p = p->next) {
+		++st.tables;
+		if (p->refc.load(std::memory_order_relaxed) > 0)
+			++st.used;
+		st.bytes += 2 * p->hl * (p->np + 1) * sizeof(float);
 	}
+}
 
-	g_mutex.unlock();
+
+void drumkv1_resampler::Table::purge (void)
+{
+	Table *p = g_list.exchange(nullptr, std::memory_order_acq_rel);
+	while (p) {
+		Table *q = p->next;
+		delete p;
+		p = q;
+	}
 }
 
 
@@ -313,6 +492,8 @@ bool drumkv1_resampler::process (void)
 	p1 = m_buff + in * m_nchan;
 	p2 = p1 + n;
 
+	const DotProc dotp = g_kernel.proc;
+
 	while (out_count) {
 		if (nr) {
 			if (inp_count == 0)
@@ -333,6 +514,13 @@ bool drumkv1_resampler::process (void)
 			inp_count--;
 		} else {
 			if (out_data) {
+				if (nz < 2 * hl && m_nchan == 1) {
+					// mono: contiguous vectorized kernel.
+					const float *c1 = m_table->ctab + hl * ph;
+					const float *c2 = m_table->rtab + hl * (np - ph);
+					*out_data++ = dotp(p1, c1, p2 - hl, c2, hl);
+				}
+				else
 				if (nz < 2 * hl) {
 					float *c1 = m_table->ctab + hl * ph;
 					float *c2 = m_table->ctab + hl * (np - ph);
@@ -358,7 +546,7 @@ bool drumkv1_resampler::process (void)
 				nr = ph / np;
 				ph -= nr * np;
 				in += nr;
-				p1 += nr * m_nchan;;
+				p1 += nr * m_nchan;
 				if (in >= m_inmax) {
 					n = (2 * hl - nr) * m_nchan;
 					::memcpy(m_buff, p1, n * sizeof(float));
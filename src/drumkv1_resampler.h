@@ -23,7 +23,7 @@
 #ifndef __drumkv1_resampler_h
 #define __drumkv1_resampler_h
 
-#include <pthread.h>
+#include <atomic>
 
 
 // ----------------------------------------------------------------------------
@@ -49,26 +49,17 @@ public:
 	int  inpdist() const; 
 	bool process();
 
+	// inner-product kernel (runtime dispatched).
+	typedef float (*DotProc)(const float *q1, const float *c1,
+		const float *q2, const float *c2, unsigned int n);
+
+	static const char *kernel();
+
 	unsigned int inp_count;
 	unsigned int out_count;
 	float       *inp_data;
 	float       *out_data;
 
-	class Mutex
-	{
-	public:
-
-		Mutex() { pthread_mutex_init(&m_mutex, 0); }
-		~Mutex() { pthread_mutex_destroy(&m_mutex); }
-
-		void lock() { pthread_mutex_lock(&m_mutex); }
-		void unlock() { pthread_mutex_unlock(&m_mutex); }
-
-	private:
-
-		pthread_mutex_t m_mutex;
-	};
-
 	class Table
 	{
 	public:
@@ -77,8 +68,9 @@ public:
 		~Table();
 
 		Table        *next;
-		unsigned int  refc;
+		std::atomic<unsigned int> refc;
 		float        *ctab;
+		float        *rtab;
 		float         fr;
 		unsigned int  hl;
 		unsigned int  np;
@@ -86,10 +78,36 @@ public:
 		static Table *create(float fr0, unsigned int hl0, unsigned int np0);
 		static void destroy(Table *table);
 
+		// cache statistics.
+		struct Stats
+		{
+			unsigned int hits;
+			unsigned int misses;
+			unsigned int tables;
+			unsigned int used;
+			unsigned long bytes;
+		};
+
+		static void stats(Stats& st);
+
+		// free all cached tables (no resampler may be alive).
+		static void purge();
+
+		bool matches(float fr0, unsigned int hl0, unsigned int np0) const
+		{
+			return (fr0 >= fr * 0.999f) && (fr0 <= fr * 1.001f)
+				&& (hl0 == hl) && (np0 == np);
+		}
+
 	private:
 
-		static Table *g_list;
-		static Mutex  g_mutex;
+		static Table *lookup(Table *p, Table *end,
+			float fr0, unsigned int hl0, unsigned int np0);
+
+		static std::atomic<Table *> g_list;
+
+		static std::atomic<unsigned int> g_hits;
+		static std::atomic<unsigned int> g_misses;
 	};
 
 private:
@@ -109,4 +127,4 @@ private:
 
 #endif	// __drumkv1_resampler_h
 
-// end of psolva1_resampler.h
+// end of drumkv1_resampler.h
@@ -22,8 +22,11 @@
 #ifndef __drumkv1_reverb_h
 #define __drumkv1_reverb_h
 
+#include "drumkv1_fx.h"
+
 #include <cstdint>
 #include <cstring>
+#include <cmath>
 
 
 //-------------------------------------------------------------------------
@@ -32,13 +35,25 @@
 // -- borrowed, stirred and refactored from original FreeVerb --
 //    by Jezar at Dreampoint, June 2000 (public domain)
 //
+//   The comb bank is processed in blocks no longer than the shortest
+//   delay line, so all the delayed reads of a block are known upfront;
+//   the lines are then run side by side (one comb per SIMD lane) and
+//   the allpass diffusers run stage by stage over the whole block.
+//
+//   The optional FDN mode replaces the parallel comb bank by a denser
+//   16-line feedback delay network (Hadamard mixing), at a comparable
+//   cost.
+//
 
 class drumkv1_reverb
 {
 public:
 
+	enum Mode { Comb = 0, Fdn };
+
 	drumkv1_reverb (float srate = 44100.0f)
-		: m_srate(srate), m_room(0.5f), m_damp(0.5f), m_feedb(0.5f)
+		: m_srate(srate), m_mode(Comb),
+			m_room(0.5f), m_damp(0.5f), m_feedb(0.5f)
 			{ reset(); }
 
 	void setSampleRate(float srate)
@@ -46,17 +61,28 @@ public:
 	float sampleRate() const
 		{ return m_srate; }
 
+	// mode switch (takes effect on next reset).
+	void setMode(Mode mode)
+		{ m_mode = mode; }
+	Mode mode() const
+		{ return m_mode; }
+
 	void reset()
 	{
 		static const uint32_t s_comb[NUM_COMBS]
 			= { 1116, 1188, 1277, 1356, 1422, 1491, 1557, 1617, 1685, 1748 };
 		static const uint32_t s_allpass[NUM_ALLPASSES]
 			= { 556, 441, 341, 225, 180, 153 };
+		static const uint32_t s_lines[NUM_LINES]
+			= { 1109, 1187, 1277, 1361, 1423, 1489, 1559, 1613,
+				1693, 1747, 1129, 1213, 1301, 1381, 1451, 1511 };
 
 		const float sr = m_srate / 44100.0f;
 
 		uint32_t j;
 
+		m_nblock = NBLOCK;
+
 		for (j = 0; j < NUM_ALLPASSES; ++j) {
 			m_allpass0[j].resize(uint32_t(s_allpass[j] * sr));
 			m_allpass0[j].reset();
@@ -64,22 +90,77 @@ public:
 			m_allpass1[j].reset();
 		}
 
-		for (j = 0; j < NUM_COMBS; ++j) {
-			m_comb0[j].resize(uint32_t(s_comb[j] * sr));
-			m_comb0[j].reset();
-			m_comb1[j].resize(uint32_t((s_comb[j] + STEREO_SPREAD) * sr));
-			m_comb1[j].reset();
+		if (m_mode == Fdn) {
+			for (j = 0; j < NUM_LINES; ++j) {
+				m_lines[j].resize(uint32_t(s_lines[j] * sr));
+				m_lines[j].reset();
+				if (m_nblock > m_lines[j].size())
+					m_nblock = m_lines[j].size();
+				m_fdn_out[j] = 0.0f;
+			}
+		} else {
+			for (j = 0; j < NUM_COMBS; ++j) {
+				m_comb0[j].resize(uint32_t(s_comb[j] * sr));
+				m_comb0[j].reset();
+				m_comb1[j].resize(uint32_t((s_comb[j] + STEREO_SPREAD) * sr));
+				m_comb1[j].reset();
+				if (m_nblock > m_comb0[j].size())
+					m_nblock = m_comb0[j].size();
+				m_comb_out0[j] = 0.0f;
+				m_comb_out1[j] = 0.0f;
+			}
 		}
 
 		reset_feedb();
-		reset_room();
-		reset_damp();
+
+		// longest delay line plus the allpass chain.
+		m_nhold = 0;
+		if (m_mode == Fdn) {
+			for (j = 0; j < NUM_LINES; ++j) {
+				if (m_nhold < m_lines[j].size())
+					m_nhold = m_lines[j].size();
+			}
+		} else {
+			for (j = 0; j < NUM_COMBS; ++j) {
+				if (m_nhold < m_comb1[j].size())
+					m_nhold = m_comb1[j].size();
+			}
+		}
+		for (j = 0; j < NUM_ALLPASSES; ++j)
+			m_nhold += m_allpass1[j].size();
+
+		m_tail.reset();
+	}
+
+	bool idle() const
+		{ return m_tail.idle(); }
+
+	// allocated buffers size (bytes).
+	uint32_t bufferSize() const
+	{
+		uint32_t nsize = 0;
+		uint32_t j;
+
+		for (j = 0; j < NUM_ALLPASSES; ++j)
+			nsize += m_allpass0[j].size() + m_allpass1[j].size();
+		for (j = 0; j < NUM_COMBS; ++j)
+			nsize += m_comb0[j].size() + m_comb1[j].size();
+		for (j = 0; j < NUM_LINES; ++j)
+			nsize += m_lines[j].size();
+
+		return nsize * sizeof(float);
 	}
 
 	void process(float *in0, float *in1, uint32_t nframes,
 		float wet, float feedb, float room, float damp, float width)
 	{
-		if (wet < 1E-9f)
+		if (wet < 1E-9f) {
+			m_tail.reset();
+			return;
+		}
+
+		// silent input and no tail left?
+		if (!m_tail.active(in0, in1, nframes, m_nhold))
 			return;
 
 		if (m_feedb != feedb) {
@@ -87,80 +168,71 @@ public:
 			reset_feedb();
 		}
 
-		if (m_room != room) {
-			m_room  = room;
-			reset_room();
-		}
+		m_room = room;
+		m_damp = damp;
 
-		if (m_damp != damp) {
-			m_damp  = damp;
-			reset_damp();
-		}
+		float tmp0[NBLOCK];
+		float tmp1[NBLOCK];
 
-		uint32_t i, j;
+		float level = 0.0f;
 
-		for (i = 0; i < nframes; ++i) {
+		uint32_t i, j;
 
-			float out0 = *in0 * 0.05f; // 0.015f;
-			float out1 = *in1 * 0.05f; // 0.015f;
+		for (i = 0; i < nframes; i += m_nblock) {
 
-			float tmp0 = 0.0f;
-			float tmp1 = 0.0f;
+			const uint32_t n
+				= (nframes - i < m_nblock ? nframes - i : m_nblock);
 
-			for (j = 0; j < NUM_COMBS; ++j) {
-				tmp0 += m_comb0[j].output(out0);
-				tmp1 += m_comb1[j].output(out1);
+			for (j = 0; j < n; ++j) {
+				tmp0[j] = in0[i + j] * 0.05f; // 0.015f;
+				tmp1[j] = in1[i + j] * 0.05f; // 0.015f;
 			}
 
+			if (m_mode == Fdn)
+				process_fdn(tmp0, tmp1, n);
+			else
+				process_combs(tmp0, tmp1, n);
+
 			for (j = 0; j < NUM_ALLPASSES; ++j) {
-				tmp0 = m_allpass0[j].output(tmp0);
-				tmp1 = m_allpass1[j].output(tmp1);
+				m_allpass0[j].process(tmp0, n);
+				m_allpass1[j].process(tmp1, n);
 			}
 
+			const float peak = drumkv1_fx_tail::peak(tmp0, tmp1, n);
+			if (level < peak)
+				level = peak;
+
+			float *out0 = in0 + i;
+			float *out1 = in1 + i;
+
 			if (width < 0.0f) {
-				out0 = tmp0 * (1.0f + width) - tmp1 * width;
-				out1 = tmp1 * (1.0f + width) - tmp0 * width;
+				const float w1 = 1.0f + width;
+				for (j = 0; j < n; ++j) {
+					out0[j] += wet * (tmp0[j] * w1 - tmp1[j] * width);
+					out1[j] += wet * (tmp1[j] * w1 - tmp0[j] * width);
+				}
 			} else {
-				out0 = tmp0 * width + tmp1 * (1.0f - width);
-				out1 = tmp1 * width + tmp0 * (1.0f - width);
+				const float w1 = 1.0f - width;
+				for (j = 0; j < n; ++j) {
+					out0[j] += wet * (tmp0[j] * width + tmp1[j] * w1);
+					out1[j] += wet * (tmp1[j] * width + tmp0[j] * w1);
+				}
 			}
-
-			*in0++ += wet * out0;
-			*in1++ += wet * out1;
 		}
+
+		// tail state (reverb output level)
+		m_tail.ringing(level, nframes, m_nhold);
+		m_tail.tick(nframes);
 	}
 
 protected:
 
 	static const uint32_t NUM_COMBS     = 10;
 	static const uint32_t NUM_ALLPASSES = 6;
+	static const uint32_t NUM_LINES     = 16;
 	static const uint32_t STEREO_SPREAD = 23;
 
-	void reset_room()
-	{
-		for (uint32_t j = 0; j < NUM_COMBS; ++j) {
-			m_comb0[j].set_feedb(m_room);
-			m_comb1[j].set_feedb(m_room);
-		}
-	}
-
-	void reset_damp()
-	{
-		const float damp2 = m_damp * m_damp;
-		for (uint32_t j = 0; j < NUM_COMBS; ++j) {
-			m_comb0[j].set_damp(damp2);
-			m_comb1[j].set_damp(damp2);
-		}
-	}
-
-	void reset_feedb()
-	{
-		const float feedb2 = 2.0f * m_feedb * (2.0f - m_feedb) / 3.0f;
-		for (uint32_t j = 0; j < NUM_ALLPASSES; ++j) {
-			m_allpass0[j].set_feedb(feedb2);
-			m_allpass1[j].set_feedb(feedb2);
-		}
-	}
+	static const uint32_t NBLOCK = 64;
 
 	class sample_buffer
 	{
@@ -195,102 +267,245 @@ protected:
 			}
 		}
 
-		float *tick()
+		uint32_t size() const
+			{ return m_size; }
+
+		// block read of the next n frames (n <= size).
+		void read(float *out, uint32_t n, uint32_t stride) const
+		{
+			uint32_t nrun = m_size - m_index;
+			if (nrun > n)
+				nrun = n;
+			const float *buf = m_buffer + m_index;
+			uint32_t i = 0;
+			for ( ; i < nrun; ++i)
+				out[i * stride] = buf[i];
+			for (buf = m_buffer - nrun; i < n; ++i)
+				out[i * stride] = buf[i];
+		}
+
+		// block write-back of the same n frames, advancing.
+		void write(const float *in, uint32_t n, uint32_t stride)
 		{
+			uint32_t nrun = m_size - m_index;
+			if (nrun > n)
+				nrun = n;
 			float *buf = m_buffer + m_index;
-			if (++m_index >= m_size)
-				m_index = 0;
-			return buf;
+			uint32_t i = 0;
+			for ( ; i < nrun; ++i)
+				buf[i] = in[i * stride];
+			for (buf = m_buffer - nrun; i < n; ++i)
+				buf[i] = in[i * stride];
+			m_index += n;
+			if (m_index >= m_size)
+				m_index -= m_size;
 		}
 
-	private:
+	protected:
 
 		float   *m_buffer;
 		uint32_t m_size;
 		uint32_t m_index;
 	};
 
-	class comb_filter : public sample_buffer
+	class allpass_filter : public sample_buffer
 	{
 	public:
 
-		comb_filter (uint32_t size = 0)
-			: sample_buffer(size), m_feedb(0.5f), m_damp(0.5f), m_out(0.0f) {}
+		allpass_filter(uint32_t size = 0)
+			: sample_buffer(size), m_feedb(0.5f) {}
 
 		void set_feedb(float feedb)
 			{ m_feedb = feedb; }
-		float feedb() const
+		float feedb () const
 			{ return m_feedb; }
 
-		void set_damp(float damp)
-			{ m_damp = damp; }
-		float damp() const
-			{ return m_damp; }
-
-		void reset()
-			{ sample_buffer::reset(); m_out = 0.0f; }
-
-		float output(float in)
+		// in-place block process, split on wrap.
+		void process(float *inout, uint32_t n)
 		{
-			float *buf = tick();
-			float  out = *buf;
-			m_out = denormal(out * (1.0f - m_damp) + m_out * m_damp);
-			*buf = in + (m_out * m_feedb);
-			return out;
+			uint32_t i = 0;
+			while (i < n) {
+				uint32_t nrun = m_size - m_index;
+				if (nrun > n - i)
+					nrun = n - i;
+				float *buf = m_buffer + m_index;
+				float *x = inout + i;
+				for (uint32_t j = 0; j < nrun; ++j) {
+					const float in  = x[j];
+					const float out = buf[j];
+					buf[j] = denormal(in + out * m_feedb);
+					x[j] = out - in;
+				}
+				m_index += nrun;
+				if (m_index >= m_size)
+					m_index = 0;
+				i += nrun;
+			}
 		}
 
 	private:
 
 		float m_feedb;
-		float m_damp;
-		float m_out;
 	};
 
-	class allpass_filter : public sample_buffer
+	// flush denormals (and zeros) to zero.
+	static float denormal(float v)
+		{ return (::fabsf(v) < 1.175494351E-38f ? 0.0f : v); }
+
+	void reset_feedb()
 	{
-	public:
+		const float feedb2 = 2.0f * m_feedb * (2.0f - m_feedb) / 3.0f;
+		for (uint32_t j = 0; j < NUM_ALLPASSES; ++j) {
+			m_allpass0[j].set_feedb(feedb2);
+			m_allpass1[j].set_feedb(feedb2);
+		}
+	}
 
-		allpass_filter(uint32_t size = 0)
-			: sample_buffer(size), m_feedb(0.5f) {}
+	// parallel comb bank, one comb per lane.
+	void process_combs(float *tmp0, float *tmp1, uint32_t n)
+	{
+		comb_bank(m_comb0, m_comb_out0, tmp0, n);
+		comb_bank(m_comb1, m_comb_out1, tmp1, n);
+	}
 
-		void set_feedb(float feedb)
-			{ m_feedb = feedb; }
-		float feedb () const
-			{ return m_feedb; }
+	void comb_bank(sample_buffer *combs, float *outs, float *tmp, uint32_t n)
+	{
+		const float damp = m_damp * m_damp;
+		const float damp1 = 1.0f - damp;
+		const float room = m_room;
 
-		float output(float in)
-		{
-			float *buf = tick();
-			float  out = *buf;
-			*buf = denormal(in + out * m_feedb);
-			return out - in;
+		float lanes[NBLOCK][NUM_COMBS];
+		float filt[NUM_COMBS];
+
+		uint32_t i, j;
+
+		for (j = 0; j < NUM_COMBS; ++j) {
+			combs[j].read(&lanes[0][j], n, NUM_COMBS);
+			filt[j] = outs[j];
 		}
 
-	private:
+		for (i = 0; i < n; ++i) {
+			const float in = tmp[i];
+			float *lane = lanes[i];
+			float sum = 0.0f;
+			for (j = 0; j < NUM_COMBS; ++j) {
+				const float out = lane[j];
+				filt[j] = denormal(out * damp1 + filt[j] * damp);
+				lane[j] = in + filt[j] * room;
+				sum += out;
+			}
+			tmp[i] = sum;
+		}
 
-		float m_feedb;
-	};
+		for (j = 0; j < NUM_COMBS; ++j) {
+			combs[j].write(&lanes[0][j], n, NUM_COMBS);
+			outs[j] = filt[j];
+		}
+	}
 
-	static float denormal(float v)
+	// feedback delay network, Hadamard mixing matrix:
+	// left feeds/taps the lower half lines, right the upper half.
+	void process_fdn(float *tmp0, float *tmp1, uint32_t n)
+	{
+		const float damp = m_damp * m_damp;
+		const float damp1 = 1.0f - damp;
+		// orthonormal 16x16 Hadamard scale (1/4).
+		const float room = 0.25f * m_room;
+
+		const uint32_t NHALF = (NUM_LINES >> 1);
+
+		float lanes[NBLOCK][NUM_LINES];
+		float filt[NUM_LINES];
+
+		uint32_t i, j;
+
+		for (j = 0; j < NUM_LINES; ++j) {
+			m_lines[j].read(&lanes[0][j], n, NUM_LINES);
+			filt[j] = m_fdn_out[j];
+		}
+
+		for (i = 0; i < n; ++i) {
+			float *lane = lanes[i];
+			float v[NUM_LINES];
+			float sum0 = 0.0f;
+			float sum1 = 0.0f;
+			for (j = 0; j < NHALF; ++j) {
+				sum0 += lane[j];
+				sum1 += lane[j + NHALF];
+			}
+			for (j = 0; j < NUM_LINES; ++j) {
+				filt[j] = denormal(lane[j] * damp1 + filt[j] * damp);
+				v[j] = filt[j] * room;
+			}
+			hadamard16(v);
+			for (j = 0; j < NHALF; ++j) {
+				lane[j] = tmp0[i] + v[j];
+				lane[j + NHALF] = tmp1[i] + v[j + NHALF];
+			}
+			tmp0[i] = sum0 * 1.25f; // ~NUM_COMBS / NHALF
+			tmp1[i] = sum1 * 1.25f;
+		}
+
+		for (j = 0; j < NUM_LINES; ++j) {
+			m_lines[j].write(&lanes[0][j], n, NUM_LINES);
+			m_fdn_out[j] = filt[j];
+		}
+	}
+
+	// in-place fast Walsh-Hadamard transform (unnormalized),
+	// butterfly stages unrolled for contiguous (SIMD) access.
+	static void hadamard16(float *v)
 	{
-		union { float f; uint32_t w; } u;
-		u.f = v;
-		return (u.w & 0x7f800000) ? v : 0.0f;
+		float a[16], b[16];
+		for (uint32_t j = 0; j < 8; ++j) {
+			a[j] = v[j] + v[j + 8];
+			a[j + 8] = v[j] - v[j + 8];
+		}
+		for (uint32_t k = 0; k < 16; k += 8) {
+			for (uint32_t j = 0; j < 4; ++j) {
+				b[k + j] = a[k + j] + a[k + j + 4];
+				b[k + j + 4] = a[k + j] - a[k + j + 4];
+			}
+		}
+		for (uint32_t k = 0; k < 16; k += 4) {
+			for (uint32_t j = 0; j < 2; ++j) {
+				a[k + j] = b[k + j] + b[k + j + 2];
+				a[k + j + 2] = b[k + j] - b[k + j + 2];
+			}
+		}
+		for (uint32_t k = 0; k < 16; k += 2) {
+			v[k] = a[k] + a[k + 1];
+			v[k + 1] = a[k] - a[k + 1];
+		}
 	}
 
 private:
 
 	float m_srate;
 
+	Mode  m_mode;
+
 	float m_room;
 	float m_damp;
 	float m_feedb;
 
-	comb_filter m_comb0[NUM_COMBS];
-	comb_filter m_comb1[NUM_COMBS];
+	sample_buffer m_comb0[NUM_COMBS];
+	sample_buffer m_comb1[NUM_COMBS];
+
+	float m_comb_out0[NUM_COMBS];
+	float m_comb_out1[NUM_COMBS];
+
+	sample_buffer m_lines[NUM_LINES];
+
+	float m_fdn_out[NUM_LINES];
 
 	allpass_filter m_allpass0[NUM_ALLPASSES];
 	allpass_filter m_allpass1[NUM_ALLPASSES];
+
+	uint32_t m_nblock;
+	uint32_t m_nhold;
+
+	drumkv1_fx_tail m_tail;
 };
 
 
@@ -22,9 +22,83 @@
 #include "drumkv1_sample.h"
 
 #include "drumkv1_resampler.h"
+#include "drumkv1_trace.h"
 
 #include <sndfile.h>
 
+#include <atomic>
+#include <thread>
+#include <system_error>
+
+
+//-------------------------------------------------------------------------
+// drumkv1_sample - resampler settings.
+//
+
+// Current resampler quality.
+static std::atomic<int> g_quality(drumkv1_sample::Medium);
+static std::atomic<bool> g_quality_pinned(false);
+
+// Resampler filter half-lengths per quality.
+static const uint32_t g_filtsize[] = { 16, 32, 64 };
+
+// Minimum frames per channel worth a parallel conversion.
+static const uint32_t PARALLEL_NFRAMES = 65536;
+
+// Resample one (mono) channel.
+static void drumkv1_sample_resample ( drumkv1_resampler *resampler,
+	float *inpb, uint32_t ninp, float *outb, uint32_t *nout )
+{
+	resampler->inp_count = ninp;
+	resampler->inp_data  = inpb;
+	resampler->out_count = *nout;
+	resampler->out_data  = outb;
+	resampler->process();
+
+	*nout -= resampler->out_count;
+}
+
+
+//-------------------------------------------------------------------------
+// drumkv1_sample_frames - decoded frame storage (shared by reference).
+//
+
+class drumkv1_sample_frames : public drumkv1_sample_data
+{
+public:
+
+	// ctor.
+	drumkv1_sample_frames(uint16_t nchannels, uint32_t nsize)
+		: m_nchannels(nchannels)
+	{
+		m_frames = new float * [m_nchannels];
+		for (uint16_t k = 0; k < m_nchannels; ++k) {
+			m_frames[k] = new float [nsize];
+			::memset(m_frames[k], 0, nsize * sizeof(float));
+		}
+	}
+
+	// accessor.
+	float *frames(uint16_t k) const
+		{ return m_frames[k]; }
+
+protected:
+
+	// dtor.
+	~drumkv1_sample_frames()
+	{
+		for (uint16_t k = 0; k < m_nchannels; ++k)
+			delete [] m_frames[k];
+		delete [] m_frames;
+	}
+
+private:
+
+	// instance variables.
+	uint16_t m_nchannels;
+	float  **m_frames;
+};
+
 
 //-------------------------------------------------------------------------
 // drumkv1_sample - sampler wave table.
@@ -35,7 +109,7 @@ drumkv1_sample::drumkv1_sample ( float srate )
 	: m_srate(srate), m_filename(nullptr), m_nchannels(0),
 		m_rate0(0.0f), m_freq0(1.0f), m_ratio(0.0f),
 		m_nframes(0), m_pframes(nullptr), m_reverse(false),
-		m_offset(false), m_offset_start(0), m_offset_end(0),
+		m_data(nullptr), m_offset(false), m_offset_start(0), m_offset_end(0),
 		m_offset_phase0(0.0f), m_offset_end2(0)
 {
 }
@@ -73,6 +147,9 @@ bool drumkv1_sample::open ( const char *filename, float freq0 )
 	if (file == nullptr)
 		return false;
 
+	// decoding (and resampling) cost, per frame count.
+	DRUMKV1_TRACE_SCOPE("sample_open", info.frames);
+
 	m_nchannels = info.channels;
 	m_rate0     = float(info.samplerate);
 	m_nframes   = info.frames;
@@ -80,69 +157,260 @@ bool drumkv1_sample::open ( const char *filename, float freq0 )
 	float *buffer = new float [m_nchannels * m_nframes];
 
 	const int nread = ::sf_readf_float(file, buffer, m_nframes);
+	::sf_close(file);
+
+	bool resampled = false;
 	if (nread > 0) {
-		// resample start...
 		const uint32_t ninp = uint32_t(nread);
 		const uint32_t rinp = uint32_t(m_rate0);
 		const uint32_t rout = uint32_t(m_srate);
-		if (rinp != rout) {
-			drumkv1_resampler resampler;
-			const uint32_t nout = uint32_t(float(ninp) * m_srate / m_rate0);
-			const uint32_t FILTSIZE = 32; // resample medium quality
-			if (resampler.setup(rinp, rout, m_nchannels, FILTSIZE)) {
-				float *inpb = buffer;
-				float *outb = new float [m_nchannels * nout];
-				resampler.inp_count = ninp;
-				resampler.inp_data  = inpb;
-				resampler.out_count = nout;
-				resampler.out_data  = outb;
-				resampler.process();
-				buffer = outb;
-				delete [] inpb;
-				// identical rates now...
-				m_rate0 = float(rout);
-				m_nframes = (nout - resampler.out_count);
-			}
+		if (rinp != rout)
+			resampled = resample(buffer, ninp, rinp, rout);
+		if (!resampled)
+			m_nframes = ninp;
+	}
+
+	if (!resampled) {
+		alloc_frames(m_nframes + 4);
+		uint32_t i = 0;
+		for (uint32_t j = 0; j < m_nframes; ++j) {
+			for (uint16_t k = 0; k < m_nchannels; ++k)
+				m_pframes[k][j] = buffer[i++];
 		}
-		else m_nframes = ninp;
-		// resample end.
 	}
 
-	const uint32_t nsize = m_nframes + 4;
+	delete [] buffer;
+
+	if (m_reverse)
+		reverse_sync();
+
+	reset(freq0);
+
+	updateOffset();
+	return true;
+}
+
+
+// init. from already decoded (de-interleaved) frames.
+bool drumkv1_sample::attach ( const char *filename, uint16_t nchannels,
+	float rate0, uint32_t nframes, float *const *frames,
+	drumkv1_sample_data *data, float freq0 )
+{
+	if (filename == nullptr || frames == nullptr || nchannels < 1)
+		return false;
+
+	const bool same_filename
+		= (m_filename && ::strcmp(m_filename, filename) == 0);
+
+	char *filename2 = ::strdup(filename);
+
+	close();
+
+	if (!same_filename)
+		setOffsetRange(0, 0);
+
+	m_filename = filename2;
+
+	m_nchannels = nchannels;
+	m_rate0     = rate0;
+	m_nframes   = nframes;
+
+	bool resampled = false;
+	const uint32_t rinp = uint32_t(m_rate0);
+	const uint32_t rout = uint32_t(m_srate);
+	if (rinp != rout && m_nframes > 0) {
+		float *buffer = new float [m_nchannels * m_nframes];
+		uint32_t i = 0;
+		for (uint32_t j = 0; j < m_nframes; ++j) {
+			for (uint16_t k = 0; k < m_nchannels; ++k)
+				buffer[i++] = frames[k][j];
+		}
+		resampled = resample(buffer, m_nframes, rinp, rout);
+		delete [] buffer;
+	}
+
+	if (!resampled) {
+		if (data) {
+			// share (and hold) the given storage...
+			m_pframes = new float * [m_nchannels];
+			m_data = data;
+			m_data->addref();
+			for (uint16_t k = 0; k < m_nchannels; ++k)
+				m_pframes[k] = frames[k];
+		} else {
+			alloc_frames(m_nframes + 4);
+			for (uint16_t k = 0; k < m_nchannels; ++k)
+				::memcpy(m_pframes[k], frames[k], m_nframes * sizeof(float));
+		}
+	}
+
+	if (m_reverse)
+		reverse_sync();
+
+	reset(freq0);
+
+	updateOffset();
+	return true;
+}
+
+
+// init. sharing another sample's frames, as they are.
+bool drumkv1_sample::share ( const drumkv1_sample& sample, float freq0 )
+{
+	if (sample.m_filename == nullptr || sample.m_pframes == nullptr
+		|| sample.m_data == nullptr || sample.m_srate != m_srate)
+		return false;
+
+	const bool same_filename
+		= (m_filename && ::strcmp(m_filename, sample.m_filename) == 0);
+
+	char *filename2 = ::strdup(sample.m_filename);
+
+	close();
+
+	if (!same_filename)
+		setOffsetRange(0, 0);
+
+	m_filename = filename2;
+
+	m_nchannels = sample.m_nchannels;
+	m_rate0     = sample.m_rate0;
+	m_nframes   = sample.m_nframes;
+	m_reverse   = sample.m_reverse;
+
 	m_pframes = new float * [m_nchannels];
+	m_data = sample.m_data;
+	m_data->addref();
+	for (uint16_t k = 0; k < m_nchannels; ++k)
+		m_pframes[k] = sample.m_pframes[k];
+
+	reset(freq0);
+
+	updateOffset();
+	return true;
+}
+
+
+// resample and de-interleave into frame buffers.
+bool drumkv1_sample::resample ( const float *buffer,
+	uint32_t ninp, uint32_t rinp, uint32_t rout )
+{
+	const uint32_t filtsize = g_filtsize[g_quality.load()];
+
+	// each channel gets its own mono resampler,
+	// so the vectorized kernel path is taken...
+	drumkv1_resampler *resamplers = new drumkv1_resampler [m_nchannels];
 	for (uint16_t k = 0; k < m_nchannels; ++k) {
-		m_pframes[k] = new float [nsize];
-		::memset(m_pframes[k], 0, nsize * sizeof(float));
+		if (!resamplers[k].setup(rinp, rout, 1, filtsize)) {
+			delete [] resamplers;
+			return false;
+		}
 	}
 
+	float *inpb = new float [m_nchannels * ninp];
 	uint32_t i = 0;
-	for (uint32_t j = 0; j < m_nframes; ++j) {
+	for (uint32_t j = 0; j < ninp; ++j) {
 		for (uint16_t k = 0; k < m_nchannels; ++k)
-			m_pframes[k][j] = buffer[i++];
+			inpb[k * ninp + j] = buffer[i++];
 	}
 
-	delete [] buffer;
-	::sf_close(file);
+	const uint32_t nout = uint32_t(float(ninp) * m_srate / m_rate0);
+	alloc_frames(nout + 4);
 
-	if (m_reverse)
-		reverse_sync();
+	uint32_t *nouts = new uint32_t [m_nchannels];
+	for (uint16_t k = 0; k < m_nchannels; ++k)
+		nouts[k] = nout;
+
+	// long multi-channel files get converted in parallel...
+	if (m_nchannels > 1 && ninp >= PARALLEL_NFRAMES) {
+		std::thread *threads = new std::thread [m_nchannels - 1];
+		for (uint16_t k = 1; k < m_nchannels; ++k) {
+			try {
+				threads[k - 1] = std::thread(drumkv1_sample_resample,
+					&resamplers[k], inpb + k * ninp, ninp, m_pframes[k], &nouts[k]);
+			}
+			catch (const std::system_error&) {
+				// no thread to spare, do it ourselves...
+				drumkv1_sample_resample(
+					&resamplers[k], inpb + k * ninp, ninp, m_pframes[k], &nouts[k]);
+			}
+		}
+		drumkv1_sample_resample(
+			&resamplers[0], inpb, ninp, m_pframes[0], &nouts[0]);
+		for (uint16_t k = 1; k < m_nchannels; ++k) {
+			if (threads[k - 1].joinable())
+				threads[k - 1].join();
+		}
+		delete [] threads;
+	} else {
+		for (uint16_t k = 0; k < m_nchannels; ++k) {
+			drumkv1_sample_resample(
+				&resamplers[k], inpb + k * ninp, ninp, m_pframes[k], &nouts[k]);
+		}
+	}
 
-	reset(freq0);
+	m_nframes = nout;
+	for (uint16_t k = 0; k < m_nchannels; ++k) {
+		if (m_nframes > nouts[k])
+			m_nframes = nouts[k];
+	}
+
+	delete [] nouts;
+	delete [] inpb;
+	delete [] resamplers;
+
+	// identical rates now...
+	m_rate0 = float(rout);
 
-	updateOffset();
 	return true;
 }
 
 
+// resampler quality (filter length).
+void drumkv1_sample::setQuality ( Quality quality, bool pinned )
+{
+	if (g_quality_pinned.load() && !pinned)
+		return;
+
+	if (quality < Draft)
+		quality = Draft;
+	else
+	if (quality > Best)
+		quality = Best;
+
+	g_quality.store(int(quality));
+
+	if (pinned)
+		g_quality_pinned.store(true);
+}
+
+
+drumkv1_sample::Quality drumkv1_sample::quality (void)
+{
+	return Quality(g_quality.load());
+}
+
+
+const char *drumkv1_sample::qualityName ( Quality quality )
+{
+	static const char *s_names[] = { "draft", "medium", "best" };
+
+	return (quality >= Draft && quality <= Best ? s_names[quality] : nullptr);
+}
+
+
 void drumkv1_sample::close (void)
 {
 	if (m_pframes) {
-		for (uint16_t k = 0; k < m_nchannels; ++k)
-			delete [] m_pframes[k];
 		delete [] m_pframes;
 		m_pframes = nullptr;
 	}
 
+	if (m_data) {
+		m_data->release();
+		m_data = nullptr;
+	}
+
 	m_nframes   = 0;
 	m_ratio     = 0.0f;
 	m_freq0     = 1.0f;
@@ -162,6 +430,9 @@ void drumkv1_sample::close (void)
 void drumkv1_sample::reverse_sync (void)
 {
 	if (m_nframes > 0 && m_pframes) {
+		// never in place on someone else's frames.
+		if (m_data && m_data->isShared())
+			unshare_frames();
 		const uint32_t nsize1 = (m_nframes - 1);
 		const uint32_t nsize2 = (m_nframes >> 1);
 		for (uint16_t k = 0; k < m_nchannels; ++k) {
@@ -177,6 +448,37 @@ void drumkv1_sample::reverse_sync (void)
 }
 
 
+// (re)allocate owned (shareable) frame buffers.
+void drumkv1_sample::alloc_frames ( uint32_t nsize )
+{
+	drumkv1_sample_frames *data
+		= new drumkv1_sample_frames(m_nchannels, nsize);
+
+	m_pframes = new float * [m_nchannels];
+	for (uint16_t k = 0; k < m_nchannels; ++k)
+		m_pframes[k] = data->frames(k);
+
+	m_data = data;
+}
+
+
+// copy on write: the shared frames stay valid for
+// whoever still reads them (eg. the audio thread).
+void drumkv1_sample::unshare_frames (void)
+{
+	drumkv1_sample_frames *data
+		= new drumkv1_sample_frames(m_nchannels, m_nframes + 4);
+
+	for (uint16_t k = 0; k < m_nchannels; ++k) {
+		::memcpy(data->frames(k), m_pframes[k], m_nframes * sizeof(float));
+		m_pframes[k] = data->frames(k);
+	}
+
+	m_data->release();
+	m_data = data;
+}
+
+
 // offset range.
 void drumkv1_sample::setOffsetRange ( uint32_t start, uint32_t end )
 {
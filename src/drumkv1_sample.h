@@ -27,11 +27,46 @@
 #include <cstdlib>
 #include <cstring>
 
+#include <atomic>
+
 
 // forward decls.
 class drumkv1;
 
 
+//-------------------------------------------------------------------------
+// drumkv1_sample_data - shared frame storage (eg. memory-mapped bundle).
+//
+
+class drumkv1_sample_data
+{
+public:
+
+	// ctor.
+	drumkv1_sample_data() : m_refcount(1) {}
+
+	// reference counting.
+	void addref()
+		{ m_refcount.fetch_add(1); }
+	void release()
+		{ if (m_refcount.fetch_sub(1) == 1) delete this; }
+
+	// whether held by more than one owner.
+	bool isShared() const
+		{ return m_refcount.load() > 1; }
+
+protected:
+
+	// dtor.
+	virtual ~drumkv1_sample_data() {}
+
+private:
+
+	// instance variables.
+	std::atomic<uint32_t> m_refcount;
+};
+
+
 //-------------------------------------------------------------------------
 // drumkv1_sample - sampler wave table.
 //
@@ -91,6 +126,24 @@ public:
 	bool open(const char *filename, float freq0 = 1.0f);
 	void close();
 
+	// init. from already decoded (de-interleaved) frames; these
+	// are shared, not copied, if owned by data at the same rate.
+	bool attach(const char *filename, uint16_t nchannels, float rate0,
+		uint32_t nframes, float *const *frames, drumkv1_sample_data *data,
+		float freq0 = 1.0f);
+
+	// init. sharing another sample's frames, as they are (eg.
+	// already resampled and reversed); copied on first write.
+	bool share(const drumkv1_sample& sample, float freq0 = 1.0f);
+
+	// resampler quality (filter length); once pinned (eg. by the
+	// render tool command line) it may not be changed anymore.
+	enum Quality { Draft = 0, Medium = 1, Best = 2 };
+
+	static void setQuality(Quality quality, bool pinned = false);
+	static Quality quality();
+	static const char *qualityName(Quality quality);
+
 	// accessors.
 	const char *filename() const
 		{ return m_filename; }
@@ -127,6 +180,10 @@ protected:
 	// reverse sample buffer.
 	void reverse_sync();
 
+	// (re)allocate owned (shareable) frame buffers.
+	void alloc_frames(uint32_t nsize);
+	void unshare_frames();
+
 	// zero-crossing aliasing .
 	uint32_t zero_crossing(uint32_t i, int *slope) const;
 	float zero_crossing_k(uint32_t i) const;
@@ -134,6 +191,10 @@ protected:
 	// offset updater.
 	void updateOffset();
 
+	// resample and de-interleave into frame buffers.
+	bool resample(const float *buffer,
+		uint32_t ninp, uint32_t rinp, uint32_t rout);
+
 private:
 
 	// instance variables.
@@ -147,6 +208,8 @@ private:
 	float  **m_pframes;
 	bool     m_reverse;
 
+	drumkv1_sample_data *m_data;
+
 	bool     m_offset;
 	uint32_t m_offset_start;
 	uint32_t m_offset_end;
@@ -20,142 +20,450 @@
 *****************************************************************************/
 
 #include "drumkv1_sched.h"
+#include "drumkv1_trace.h"
 
 #include <QThread>
-#include <QMutex>
-#include <QWaitCondition>
 
-#include <QHash>
+#include <climits>
+#include <mutex>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <dispatch/dispatch.h>
+#else
+#include <semaphore.h>
+#include <cerrno>
+#endif
 
 
 //-------------------------------------------------------------------------
-// drumkv1_sched_thread - worker/schedule thread decl.
+// drumkv1_sched_sem - counting semaphore (lock-free post).
 //
 
-class drumkv1_sched_thread : public QThread
+class drumkv1_sched_sem
+{
+public:
+
+#if defined(_WIN32)
+	drumkv1_sched_sem() { m_sem = ::CreateSemaphore(nullptr, 0, LONG_MAX, nullptr); }
+	~drumkv1_sched_sem() { ::CloseHandle(m_sem); }
+	void post() { ::ReleaseSemaphore(m_sem, 1, nullptr); }
+	void wait() { ::WaitForSingleObject(m_sem, INFINITE); }
+private:
+	HANDLE m_sem;
+#elif defined(__APPLE__)
+	drumkv1_sched_sem() { m_sem = ::dispatch_semaphore_create(0); }
+	~drumkv1_sched_sem() { ::dispatch_release(m_sem); }
+	void post() { ::dispatch_semaphore_signal(m_sem); }
+	void wait() { ::dispatch_semaphore_wait(m_sem, DISPATCH_TIME_FOREVER); }
+private:
+	dispatch_semaphore_t m_sem;
+#else
+	drumkv1_sched_sem() { ::sem_init(&m_sem, 0, 0); }
+	~drumkv1_sched_sem() { ::sem_destroy(&m_sem); }
+	void post() { ::sem_post(&m_sem); }
+	void wait() { while (::sem_wait(&m_sem) < 0 && errno == EINTR); }
+private:
+	sem_t m_sem;
+#endif
+};
+
+
+//-------------------------------------------------------------------------
+// drumkv1_sched_pool - worker/schedule thread pool decl.
+//
+//   Scheduled instances are pushed into an intrusive, lock-free
+//   multi-producer queue (each drumkv1_sched is its own node, and is
+//   queued at most once) and served by a pool of worker threads,
+//   so that one slow task does not hold up everyone else's.
+//
+//   All scheds of the same drumkv1 instance make up one lane, served
+//   by one worker at a time, just like the old single worker thread
+//   did; a sched popped while its lane is busy elsewhere is deferred
+//   until that other worker is done with it.
+
+class drumkv1_sched_pool
 {
 public:
 
 	// ctor.
-	drumkv1_sched_thread(uint32_t nsize = 32);
+	drumkv1_sched_pool(uint32_t nthreads);
 
 	// dtor.
-	~drumkv1_sched_thread();
+	~drumkv1_sched_pool();
 
-	// schedule processing and wake from wait condition.
+	// schedule processing and wake a worker (lock-free).
 	void schedule(drumkv1_sched *sched);
 
+	// grow the pool, if needed.
+	void start(uint32_t nthreads);
+
+	// number of worker threads.
+	uint32_t threads() const;
+
+	// whether a worker is still holding on it.
+	bool busy(const drumkv1_sched *sched) const;
+
+	// whether a worker is holding on any sched of this lane.
+	bool busy_lane(const drumkv1 *pLane) const;
+
+	// whether nothing is queued nor running.
+	bool idle();
+
 protected:
 
-	// main thread executive.
-	void run();
+	// worker thread executive.
+	void run(uint32_t index);
+
+	// lock-free queue ops.
+	void push(drumkv1_sched *sched);
+	drumkv1_sched *pop();
+
+	// next sched whose lane is free, deferring the others (locked).
+	drumkv1_sched *pop_lane();
+
+	// requeue the ones deferred on this lane (locked).
+	void resume_lane(const drumkv1 *pLane);
 
 private:
 
-	// sync queue instance reference.
-	uint32_t m_nsize;
-	uint32_t m_nmask;
+	// worker thread.
+	class Worker : public QThread
+	{
+	public:
+
+		Worker(drumkv1_sched_pool *pool, uint32_t index)
+			: QThread(), m_pool(pool), m_index(index) {}
+
+	protected:
+
+		void run() { m_pool->run(m_index); }
+
+	private:
+
+		drumkv1_sched_pool *m_pool;
+		uint32_t m_index;
+	};
+
+	// queue stub node.
+	class Stub : public drumkv1_sched
+	{
+	public:
+
+		Stub() : drumkv1_sched(nullptr, Sample) {}
+
+		void process(int) {}
+	};
 
-	drumkv1_sched **m_items;
+	// queue head (producers) and tail (consumers).
+	std::atomic<drumkv1_sched *> m_head;
+	drumkv1_sched *m_tail;
 
-	volatile uint32_t m_iread;
-	volatile uint32_t m_iwrite;
+	Stub *m_stub;
 
-	// whether the thread is logically running.
-	volatile bool m_running;
+	// consumers exclusion (worker threads only).
+	std::mutex m_mutex;
 
-	// thread synchronization objects.
-	QMutex m_mutex;
-	QWaitCondition m_cond;
+	// popped while their lane was busy (locked).
+	std::vector<drumkv1_sched *> m_deferred;
+
+	drumkv1_sched_sem m_sem;
+
+	// whether the pool is logically running.
+	std::atomic<bool> m_running;
+
+	static const uint32_t MAX_THREADS = 8;
+
+	Worker *m_workers[MAX_THREADS];
+	uint32_t m_nthreads;
+
+	// currently processing, per worker.
+	std::atomic<drumkv1_sched *> m_current[MAX_THREADS];
 };
 
 
-static drumkv1_sched_thread *g_sched_thread = nullptr;
+static drumkv1_sched_pool *g_sched_pool = nullptr;
 static uint32_t g_sched_refcount = 0;
+static uint32_t g_sched_threads = 2;
+
+static drumkv1_sched *g_sched_list = nullptr;
 
-static QHash<drumkv1 *, QList<drumkv1_sched::Notifier *> > g_sched_notifiers;
+static std::mutex g_sched_mutex;
 
 
 //-------------------------------------------------------------------------
-// drumkv1_sched_thread - worker/schedule thread impl.
+// drumkv1_sched_notifiers - sharded notifier registry.
 //
+//   Each shard holds an immutable table, read-copy-updated: readers
+//   (worker threads) neither lock nor allocate, while writers (the UI
+//   thread, opening or closing an editor) copy, publish the new table
+//   and wait for any reader to be gone before reclaiming the old one.
 
-// ctor.
-drumkv1_sched_thread::drumkv1_sched_thread ( uint32_t nsize ) : QThread()
+class drumkv1_sched_notifiers
 {
-	m_nsize = (4 << 1);
-	while (m_nsize < nsize)
-		m_nsize <<= 1;
-	m_nmask = (m_nsize - 1);
-	m_items = new drumkv1_sched * [m_nsize];
+public:
+
+	// dtor.
+	~drumkv1_sched_notifiers();
+
+	// register/unregister a notifier (writers).
+	void add(drumkv1 *pDrumk, drumkv1_sched::Notifier *pNotifier);
+	void remove(drumkv1 *pDrumk, drumkv1_sched::Notifier *pNotifier);
 
-	m_iread  = 0;
-	m_iwrite = 0;
+	// signal broadcast (readers).
+	void notify(drumkv1 *pDrumk, drumkv1_sched::Type stype, int sid);
 
-	::memset(m_items, 0, m_nsize * sizeof(drumkv1_sched *));
+private:
+
+	struct Entry
+	{
+		drumkv1 *pDrumk;
+		drumkv1_sched::Notifier *pNotifier;
+	};
+
+	typedef std::vector<Entry> Table;
+
+	struct alignas(64) Shard
+	{
+		std::atomic<Table *> table { nullptr };
+		std::atomic<uint32_t> readers { 0 };
+		std::mutex mutex;
+	};
+
+	static const uint32_t NUM_SHARDS = 64;
+
+	Shard& shard(drumkv1 *pDrumk)
+	{
+		const uintptr_t h = (uintptr_t(pDrumk) >> 4) * 2654435761U;
+		return m_shards[(h >> 8) & (NUM_SHARDS - 1)];
+	}
+
+	// publish a new table, reclaim the old one.
+	static void update(Shard& shard, Table *table);
 
-	m_running = false;
+	Shard m_shards[NUM_SHARDS];
+};
+
+
+static drumkv1_sched_notifiers g_sched_notifiers;
+
+
+//-------------------------------------------------------------------------
+// drumkv1_sched_pool - worker/schedule thread pool impl.
+//
+
+// ctor.
+drumkv1_sched_pool::drumkv1_sched_pool ( uint32_t nthreads )
+	: m_running(true), m_nthreads(0)
+{
+	// queue starts with the stub node only.
+	m_stub = new Stub();
+	m_head.store(m_stub);
+	m_tail = m_stub;
+
+	for (uint32_t i = 0; i < MAX_THREADS; ++i) {
+		m_workers[i] = nullptr;
+		m_current[i].store(nullptr);
+	}
+
+	start(nthreads);
 }
 
 
 // dtor.
-drumkv1_sched_thread::~drumkv1_sched_thread (void)
-{
-	// fake sync and wait
-	if (m_running && isRunning()) do {
-		if (m_mutex.tryLock()) {
-			m_running = false;
-			m_cond.wakeAll();
-			m_mutex.unlock();
-		}
-	} while (!wait(100));
+drumkv1_sched_pool::~drumkv1_sched_pool (void)
+{
+	m_running.store(false);
 
-	delete [] m_items;
+	uint32_t i;
+
+	for (i = 0; i < m_nthreads; ++i)
+		m_sem.post();
+
+	for (i = 0; i < m_nthreads; ++i) {
+		m_workers[i]->wait();
+		delete m_workers[i];
+		m_workers[i] = nullptr;
+	}
+
+	delete m_stub;
+}
+
+
+// grow the pool, if needed.
+void drumkv1_sched_pool::start ( uint32_t nthreads )
+{
+	if (nthreads < 1)
+		nthreads = 1;
+	if (nthreads > MAX_THREADS)
+		nthreads = MAX_THREADS;
+
+	while (m_nthreads < nthreads) {
+		Worker *worker = new Worker(this, m_nthreads);
+		m_workers[m_nthreads++] = worker;
+		worker->start();
+	}
+}
+
+
+// number of worker threads.
+uint32_t drumkv1_sched_pool::threads (void) const
+{
+	return m_nthreads;
 }
 
 
-// schedule processing and wake from wait condition.
-void drumkv1_sched_thread::schedule ( drumkv1_sched *sched )
+// whether a worker is still holding on it.
+bool drumkv1_sched_pool::busy ( const drumkv1_sched *sched ) const
+{
+	for (uint32_t i = 0; i < MAX_THREADS; ++i) {
+		if (m_current[i].load() == sched)
+			return true;
+	}
+
+	return false;
+}
+
+
+// whether a worker is holding on any sched of this lane.
+bool drumkv1_sched_pool::busy_lane ( const drumkv1 *pLane ) const
+{
+	for (uint32_t i = 0; i < MAX_THREADS; ++i) {
+		const drumkv1_sched *sched = m_current[i].load();
+		if (sched && sched->lane() == pLane)
+			return true;
+	}
+
+	return false;
+}
+
+
+// whether nothing is queued nor running.
+bool drumkv1_sched_pool::idle (void)
+{
+	const std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (m_tail != m_stub || m_head.load() != m_stub
+		|| m_stub->m_sync_next.load() != nullptr
+		|| !m_deferred.empty())
+		return false;
+
+	for (uint32_t i = 0; i < MAX_THREADS; ++i) {
+		if (m_current[i].load() != nullptr)
+			return false;
+	}
+
+	return true;
+}
+
+
+// schedule processing and wake a worker (lock-free).
+void drumkv1_sched_pool::schedule ( drumkv1_sched *sched )
 {
 	if (!sched->sync_wait()) {
-		const uint32_t w = (m_iwrite + 1) & m_nmask;
-		if (w != m_iread) {
-			m_items[m_iwrite] = sched;
-			m_iwrite = w;
-		}
+		push(sched);
+		m_sem.post();
 	}
+}
+
 
-	if (m_mutex.tryLock()) {
-		m_cond.wakeAll();
-		m_mutex.unlock();
+// lock-free (wait-free) multi-producer push.
+void drumkv1_sched_pool::push ( drumkv1_sched *sched )
+{
+	sched->m_sync_next.store(nullptr, std::memory_order_relaxed);
+	drumkv1_sched *prev = m_head.exchange(sched, std::memory_order_acq_rel);
+	prev->m_sync_next.store(sched, std::memory_order_release);
+}
+
+
+// consumer pop (under consumers mutex); null when empty,
+// or when a producer is half-way through (it will post anyway).
+drumkv1_sched *drumkv1_sched_pool::pop (void)
+{
+	drumkv1_sched *tail = m_tail;
+	drumkv1_sched *next = tail->m_sync_next.load(std::memory_order_acquire);
+	if (tail == m_stub) {
+		if (next == nullptr)
+			return nullptr;
+		m_tail = next;
+		tail = next;
+		next = next->m_sync_next.load(std::memory_order_acquire);
+	}
+	if (next) {
+		m_tail = next;
+		return tail;
+	}
+	if (tail != m_head.load(std::memory_order_acquire))
+		return nullptr;
+	push(m_stub);
+	next = tail->m_sync_next.load(std::memory_order_acquire);
+	if (next) {
+		m_tail = next;
+		return tail;
+	}
+	return nullptr;
+}
+
+
+// next sched whose lane is free, deferring the others (locked).
+drumkv1_sched *drumkv1_sched_pool::pop_lane (void)
+{
+	drumkv1_sched *sched = pop();
+	while (sched && busy_lane(sched->lane())) {
+		m_deferred.push_back(sched);
+		sched = pop();
 	}
+
+	return sched;
 }
 
 
-// main thread executive.
-void drumkv1_sched_thread::run (void)
+// requeue the ones deferred on this lane (locked).
+void drumkv1_sched_pool::resume_lane ( const drumkv1 *pLane )
 {
-	m_mutex.lock();
+	std::vector<drumkv1_sched *>::iterator iter = m_deferred.begin();
+	while (iter != m_deferred.end()) {
+		drumkv1_sched *sched = *iter;
+		if (sched->lane() == pLane) {
+			iter = m_deferred.erase(iter);
+			push(sched);
+			m_sem.post();
+		}
+		else ++iter;
+	}
+}
+
 
-	m_running = true;
+// worker thread executive.
+void drumkv1_sched_pool::run ( uint32_t index )
+{
+	std::atomic<drumkv1_sched *>& current = m_current[index];
 
-	while (m_running) {
+	while (m_running.load()) {
+		// wait for sync...
+		m_sem.wait();
 		// do whatever we must...
-		uint32_t r = m_iread;
-		while (r != m_iwrite) {
-			drumkv1_sched *sched = m_items[r];
-			if (sched) {
-				sched->sync_process();
-				m_items[r] = nullptr;
+		for (;;) {
+			drumkv1_sched *sched = nullptr;
+			{
+				const std::lock_guard<std::mutex> lock(m_mutex);
+				sched = pop_lane();
+				current.store(sched);
 			}
-			++r &= m_nmask;
+			if (sched == nullptr)
+				break;
+			sched->sync_process();
+			// more work came in while busy?
+			if (sched->sync_pending())
+				schedule(sched);
+			// release the lane...
+			const std::lock_guard<std::mutex> lock(m_mutex);
+			current.store(nullptr);
+			resume_lane(sched->lane());
 		}
-		m_iread = r;
-		// wait for sync...
-		m_cond.wait(&m_mutex);
 	}
-
-	m_mutex.unlock();
 }
 
 
@@ -165,36 +473,93 @@ void drumkv1_sched_thread::run (void)
 
 // ctor.
 drumkv1_sched::drumkv1_sched ( drumkv1 *pDrumk, Type stype, uint32_t nsize )
-	: m_pDrumk(pDrumk), m_stype(stype), m_sync_wait(false)
+	: m_pDrumk(pDrumk), m_stype(stype), m_iread(0), m_iwrite(0),
+		m_overruns(0), m_sync_wait(false), m_sync_next(nullptr),
+		m_list_prev(nullptr), m_list_next(nullptr)
 {
 	m_nsize = (4 << 1);
 	while (m_nsize < nsize)
 		m_nsize <<= 1;
 	m_nmask = (m_nsize - 1);
-	m_items = new int [m_nsize];
+	m_items = new Item [m_nsize];
 
-	m_iread  = 0;
-	m_iwrite = 0;
+	for (uint32_t i = 0; i < m_nsize; ++i) {
+		m_items[i].seq.store(i, std::memory_order_relaxed);
+		m_items[i].sid = 0;
+	}
 
-	::memset(m_items, 0, m_nsize * sizeof(int));
+	for (uint32_t i = 0; i < MAX_OVERFLOW; ++i)
+		m_overflow[i].store(INT_MIN, std::memory_order_relaxed);
 
-	if (++g_sched_refcount == 1 && g_sched_thread == nullptr) {
-		g_sched_thread = new drumkv1_sched_thread();
-		g_sched_thread->start();
-	}
+	// pool stub node is no real instance (see above).
+	if (m_pDrumk == nullptr)
+		return;
+
+	const std::lock_guard<std::mutex> lock(g_sched_mutex);
+
+	if (++g_sched_refcount == 1 && g_sched_pool == nullptr)
+		g_sched_pool = new drumkv1_sched_pool(g_sched_threads);
+
+	m_list_next = g_sched_list;
+	if (g_sched_list)
+		g_sched_list->m_list_prev = this;
+	g_sched_list = this;
 }
 
 
 // dtor (virtual).
 drumkv1_sched::~drumkv1_sched (void)
 {
+	if (m_pDrumk) {
+		// should have been drained by the derived dtor already...
+		sync_drain();
+		const std::lock_guard<std::mutex> lock(g_sched_mutex);
+		if (m_list_prev)
+			m_list_prev->m_list_next = m_list_next;
+		else
+			g_sched_list = m_list_next;
+		if (m_list_next)
+			m_list_next->m_list_prev = m_list_prev;
+		if (--g_sched_refcount == 0 && g_sched_pool) {
+			delete g_sched_pool;
+			g_sched_pool = nullptr;
+		}
+	}
+
 	delete [] m_items;
+}
 
-	if (--g_sched_refcount == 0) {
-		if (g_sched_thread) {
-			delete g_sched_thread;
-			g_sched_thread = nullptr;
+
+// wait for any queued/running work to finish.
+void drumkv1_sched::sync_drain (void)
+{
+	while (g_sched_pool
+		&& (m_sync_wait.load() || g_sched_pool->busy(this)))
+		QThread::msleep(1);
+}
+
+
+// wait for all queued/running work of a lane (instance) to finish;
+// not holding the lock while waiting, as a sched being processed
+// may well construct or destroy other scheds (eg. loading a kit).
+void drumkv1_sched::sync_drain_lane ( const drumkv1 *pLane )
+{
+	for (;;) {
+		bool busy = false;
+		{
+			const std::lock_guard<std::mutex> lock(g_sched_mutex);
+			if (g_sched_pool == nullptr)
+				break;
+			drumkv1_sched *sched = g_sched_list;
+			for (; sched && !busy; sched = sched->m_list_next) {
+				if (sched->lane() == pLane)
+					busy = (sched->m_sync_wait.load()
+						|| g_sched_pool->busy(sched));
+			}
 		}
+		if (!busy)
+			break;
+		QThread::msleep(1);
 	}
 }
 
@@ -206,29 +571,109 @@ drumkv1 *drumkv1_sched::instance (void) const
 }
 
 
-// schedule process.
+// schedule process (lock-free, any thread).
 void drumkv1_sched::schedule ( int sid )
 {
-	const uint32_t w = (m_iwrite + 1) & m_nmask;
-	if (w != m_iread) {
-		m_items[m_iwrite] = sid;
-		m_iwrite = w;
+	DRUMKV1_TRACE_EVENT("schedule", sid);
+
+	if (!push(sid))
+		coalesce(sid);
+
+	if (g_sched_pool)
+		g_sched_pool->schedule(this);
+}
+
+
+// bounded multi-producer queue (D. Vyukov's).
+bool drumkv1_sched::push ( int sid )
+{
+	uint32_t w = m_iwrite.load(std::memory_order_relaxed);
+	for (;;) {
+		Item& item = m_items[w & m_nmask];
+		const uint32_t seq = item.seq.load(std::memory_order_acquire);
+		const int32_t diff = int32_t(seq - w);
+		if (diff == 0) {
+			if (m_iwrite.compare_exchange_weak(w, w + 1,
+					std::memory_order_relaxed))
+				break;
+		}
+		else
+		if (diff < 0)
+			return false; // full.
+		else
+			w = m_iwrite.load(std::memory_order_relaxed);
+	}
+	Item& item = m_items[w & m_nmask];
+	item.sid = sid;
+	item.seq.store(w + 1, std::memory_order_release);
+	return true;
+}
+
+
+// single consumer (one worker at a time).
+bool drumkv1_sched::pop ( int& sid )
+{
+	const uint32_t r = m_iread.load(std::memory_order_relaxed);
+	Item& item = m_items[r & m_nmask];
+	const uint32_t seq = item.seq.load(std::memory_order_acquire);
+	if (int32_t(seq - (r + 1)) < 0)
+		return false; // empty.
+	sid = item.sid;
+	item.seq.store(r + m_nsize, std::memory_order_release);
+	m_iread.store(r + 1, std::memory_order_relaxed);
+	return true;
+}
+
+
+// overflow coalescing, per sid.
+void drumkv1_sched::coalesce ( int sid )
+{
+	uint32_t i;
+
+	for (i = 0; i < MAX_OVERFLOW; ++i) {
+		if (m_overflow[i].load(std::memory_order_relaxed) == sid)
+			return; // already pending.
+	}
+
+	for (i = 0; i < MAX_OVERFLOW; ++i) {
+		int empty = INT_MIN;
+		if (m_overflow[i].compare_exchange_strong(empty, sid))
+			return;
+		if (empty == sid)
+			return;
 	}
 
-	if (g_sched_thread)
-		g_sched_thread->schedule(this);
+	// lost, but not silently.
+	m_overruns.fetch_add(1);
 }
 
 
-// test-and-set.
-bool drumkv1_sched::sync_wait (void)
+// lost schedules (queue and overflow set both full).
+uint32_t drumkv1_sched::overruns (void) const
+{
+	return m_overruns.load();
+}
+
+
+// whether there's still work queued.
+bool drumkv1_sched::sync_pending (void) const
 {
-	const bool sync_wait = m_sync_wait;
+	if (m_iread.load() != m_iwrite.load())
+		return true;
 
-	if (!sync_wait)
-		m_sync_wait = true;
+	for (uint32_t i = 0; i < MAX_OVERFLOW; ++i) {
+		if (m_overflow[i].load() != INT_MIN)
+			return true;
+	}
 
-	return sync_wait;
+	return false;
+}
+
+
+// test-and-set.
+bool drumkv1_sched::sync_wait (void)
+{
+	return m_sync_wait.exchange(true);
 }
 
 
@@ -236,30 +681,150 @@ bool drumkv1_sched::sync_wait (void)
 void drumkv1_sched::sync_process (void)
 {
 	// do whatever we must...
-	uint32_t r = m_iread;
-	while (r != m_iwrite) {
-		const int sid = m_items[r];
+	int sid = 0;
+	while (pop(sid)) {
 		process(sid);
 		sync_notify(m_pDrumk, m_stype, sid);
-		m_items[r] = 0;
-		++r &= m_nmask;
 	}
-	m_iread = r;
 
-	m_sync_wait = false;
+	// and the overflown ones...
+	for (uint32_t i = 0; i < MAX_OVERFLOW; ++i) {
+		sid = m_overflow[i].exchange(INT_MIN);
+		if (sid != INT_MIN) {
+			process(sid);
+			sync_notify(m_pDrumk, m_stype, sid);
+		}
+	}
+
+	m_sync_wait.store(false);
+}
+
+
+// wait for the whole worker pool to settle (static, offline use).
+void drumkv1_sched::sync_idle (void)
+{
+	while (g_sched_pool && !g_sched_pool->idle())
+		QThread::msleep(1);
+}
+
+
+// worker thread pool size (static).
+void drumkv1_sched::setThreads ( uint32_t nthreads )
+{
+	const std::lock_guard<std::mutex> lock(g_sched_mutex);
+
+	if (g_sched_threads < nthreads)
+		g_sched_threads = nthreads;
+
+	if (g_sched_pool)
+		g_sched_pool->start(g_sched_threads);
+}
+
+
+uint32_t drumkv1_sched::threads (void)
+{
+	const std::lock_guard<std::mutex> lock(g_sched_mutex);
+
+	return (g_sched_pool ? g_sched_pool->threads() : g_sched_threads);
 }
 
 
 // signal broadcast (static).
 void drumkv1_sched::sync_notify ( drumkv1 *pDrumk, Type stype, int sid )
 {
-	if (g_sched_notifiers.contains(pDrumk)) {
-		const QList<Notifier *>& list
-			= g_sched_notifiers.value(pDrumk);
-		QListIterator<Notifier *> iter(list);
-		while (iter.hasNext())
-			iter.next()->notify(stype, sid);
+	g_sched_notifiers.notify(pDrumk, stype, sid);
+}
+
+
+//-------------------------------------------------------------------------
+// drumkv1_sched_notifiers - sharded notifier registry impl.
+//
+
+// dtor.
+drumkv1_sched_notifiers::~drumkv1_sched_notifiers (void)
+{
+	for (uint32_t i = 0; i < NUM_SHARDS; ++i)
+		delete m_shards[i].table.exchange(nullptr);
+}
+
+
+// register a notifier (writer).
+void drumkv1_sched_notifiers::add (
+	drumkv1 *pDrumk, drumkv1_sched::Notifier *pNotifier )
+{
+	Shard& s = shard(pDrumk);
+	const std::lock_guard<std::mutex> lock(s.mutex);
+
+	const Table *old_table = s.table.load();
+	Table *table = (old_table ? new Table(*old_table) : new Table());
+	table->push_back({ pDrumk, pNotifier });
+
+	update(s, table);
+}
+
+
+// unregister a notifier (writer).
+void drumkv1_sched_notifiers::remove (
+	drumkv1 *pDrumk, drumkv1_sched::Notifier *pNotifier )
+{
+	Shard& s = shard(pDrumk);
+	const std::lock_guard<std::mutex> lock(s.mutex);
+
+	const Table *old_table = s.table.load();
+	if (old_table == nullptr)
+		return;
+
+	Table *table = new Table();
+	table->reserve(old_table->size());
+	for (const Entry& entry : *old_table) {
+		if (entry.pDrumk != pDrumk || entry.pNotifier != pNotifier)
+			table->push_back(entry);
 	}
+
+	if (table->size() == old_table->size()) {
+		delete table; // not registered (anymore).
+		return;
+	}
+
+	if (table->empty()) {
+		delete table;
+		table = nullptr;
+	}
+
+	update(s, table);
+}
+
+
+// publish a new table, reclaim the old one (writer).
+void drumkv1_sched_notifiers::update ( Shard& s, Table *table )
+{
+	Table *old_table = s.table.exchange(table);
+
+	// grace period: wait for current readers...
+	while (s.readers.load() > 0)
+		QThread::yieldCurrentThread();
+
+	delete old_table;
+}
+
+
+// signal broadcast (reader).
+void drumkv1_sched_notifiers::notify (
+	drumkv1 *pDrumk, drumkv1_sched::Type stype, int sid )
+{
+	Shard& s = shard(pDrumk);
+
+	s.readers.fetch_add(1);
+
+	const Table *table = s.table.load();
+	if (table) {
+		for (const Entry& entry : *table) {
+			if (entry.pDrumk == pDrumk)
+				entry.pNotifier->notify(stype, sid);
+		}
+	}
+
+	s.readers.fetch_sub(1);
 }
 
 
@@ -271,19 +836,27 @@ void drumkv1_sched::sync_notify ( drumkv1 *pDrumk, Type stype, int sid )
 drumkv1_sched::Notifier::Notifier ( drumkv1 *pDrumk )
 	: m_pDrumk(pDrumk)
 {
-	g_sched_notifiers[pDrumk].append(this);
 }
 
 
 // dtor.
 drumkv1_sched::Notifier::~Notifier (void)
 {
-	if (g_sched_notifiers.contains(m_pDrumk)) {
-		QList<Notifier *>& list = g_sched_notifiers[m_pDrumk];
-		list.removeAll(this);
-		if (list.isEmpty())
-			g_sched_notifiers.remove(m_pDrumk);
-	}
+	close();
+}
+
+
+// register.
+void drumkv1_sched::Notifier::open (void)
+{
+	g_sched_notifiers.add(m_pDrumk, this);
+}
+
+
+// unregister, waiting for any notification in flight.
+void drumkv1_sched::Notifier::close (void)
+{
+	g_sched_notifiers.remove(m_pDrumk, this);
 }
 
 
@@ -24,6 +24,8 @@
 
 #include <cstdint>
 
+#include <atomic>
+
 
 // forward decls.
 class drumkv1;
@@ -38,7 +40,7 @@ class drumkv1_sched
 public:
 
 	// plausible sched types.
-	enum Type { Sample, Programs, Controls, Controller, MidiIn };
+	enum Type { Sample, Programs, Controls, Controller, MidiIn, Effects, Elements, State };
 
 	// ctor.
 	drumkv1_sched(drumkv1 *pDrumk, Type stype, uint32_t nsize = 8);
@@ -49,7 +51,11 @@ public:
 	// instance access.
 	drumkv1 *instance() const;
 
-	// schedule process.
+	// lane key: scheds of the same instance never run concurrently.
+	const drumkv1 *lane() const
+		{ return m_pDrumk; }
+
+	// schedule process (lock-free, any thread).
 	void schedule(int sid = 0);
 
 	// test-and-set wait.
@@ -58,12 +64,31 @@ public:
 	// scheduled processor.
 	void sync_process();
 
+	// wait for any queued/running work to finish; derived classes
+	// must call it from their own dtor, as process() is pure virtual.
+	void sync_drain();
+
+	// wait for all queued/running work of a lane (instance) to finish;
+	// to be called before tearing down anything process() might use.
+	static void sync_drain_lane(const drumkv1 *pLane);
+
 	// (pure) virtual processor.
 	virtual void process(int sid) = 0;
 
 	// signal broadcast (static).
 	static void sync_notify(drumkv1 *pDrumk, Type stype, int sid);
 
+	// lost schedules (queue and overflow set both full).
+	uint32_t overruns() const;
+
+	// wait until no work is queued nor running (static);
+	// meant for offline rendering, eg. after loading a preset.
+	static void sync_idle();
+
+	// worker thread pool size (static).
+	static void setThreads(uint32_t nthreads);
+	static uint32_t threads();
+
 	// Notifier - Worker/schedule proxy decl.
 	//
 	class Notifier
@@ -79,12 +104,30 @@ public:
 		// signal notifier.
 		virtual void notify(drumkv1_sched::Type stype, int sid) const = 0;
 
+		// register/unregister (the latter waits for any notification
+		// in flight); to be called from derived class ctors/dtors,
+		// as notify() may be called right away.
+		void open();
+		void close();
+
 	private:
 
 		// instance variables.
 		drumkv1 *m_pDrumk;
 	};
 
+protected:
+
+	// sid queue (bounded, multi-producer).
+	bool push(int sid);
+	bool pop(int& sid);
+
+	// overflow coalescing, per sid.
+	void coalesce(int sid);
+
+	// whether there's still work queued.
+	bool sync_pending() const;
+
 private:
 
 	// instance variables.
@@ -96,12 +139,33 @@ private:
 	uint32_t m_nsize;
 	uint32_t m_nmask;
 
-	int *m_items;
+	struct Item
+	{
+		std::atomic<uint32_t> seq;
+		int sid;
+	};
+
+	Item *m_items;
+
+	std::atomic<uint32_t> m_iread;
+	std::atomic<uint32_t> m_iwrite;
+
+	// overflow set.
+	static const uint32_t MAX_OVERFLOW = 16;
+
+	std::atomic<int> m_overflow[MAX_OVERFLOW];
+	std::atomic<uint32_t> m_overruns;
+
+	std::atomic<bool> m_sync_wait;
+
+	// worker queue link (intrusive).
+	std::atomic<drumkv1_sched *> m_sync_next;
 
-	volatile uint32_t m_iread;
-	volatile uint32_t m_iwrite;
+	// all live instances list (intrusive, under a global lock).
+	drumkv1_sched *m_list_prev;
+	drumkv1_sched *m_list_next;
 
-	volatile bool m_sync_wait;
+	friend class drumkv1_sched_pool;
 };
 
 
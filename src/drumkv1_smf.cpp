@@ -0,0 +1,327 @@
+// drumkv1_smf.cpp
+//
+/****************************************************************************
+   Copyright (C) 2012-2021, rncbc aka Rui Nuno Capela. All rights reserved.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*****************************************************************************/
+
+#include "drumkv1_smf.h"
+
+#include <QFile>
+
+#include <algorithm>
+
+#include <cstring>
+
+
+//-------------------------------------------------------------------------
+// drumkv1_smf_reader - big-endian chunk reader.
+//
+
+class drumkv1_smf_reader
+{
+public:
+
+	drumkv1_smf_reader(const uint8_t *data, uint32_t size)
+		: m_data(data), m_size(size), m_pos(0), m_ok(true) {}
+
+	bool ok() const { return m_ok; }
+	bool at_end() const { return m_pos >= m_size; }
+
+	uint32_t pos() const { return m_pos; }
+
+	bool check(uint32_t n)
+	{
+		if (m_ok && n > m_size - m_pos)
+			m_ok = false;
+		return m_ok;
+	}
+
+	uint8_t read_u8()
+	{
+		return (check(1) ? m_data[m_pos++] : 0);
+	}
+
+	uint8_t peek_u8()
+	{
+		return (check(1) ? m_data[m_pos] : 0);
+	}
+
+	uint32_t read_be(uint32_t n)
+	{
+		uint32_t v = 0;
+		for (uint32_t i = 0; i < n && m_ok; ++i)
+			v = (v << 8) | read_u8();
+		return v;
+	}
+
+	// variable-length quantity (max. 4 bytes).
+	uint32_t read_vlq()
+	{
+		uint32_t v = 0;
+		for (int i = 0; i < 4 && m_ok; ++i) {
+			const uint8_t c = read_u8();
+			v = (v << 7) | (c & 0x7f);
+			if ((c & 0x80) == 0)
+				break;
+		}
+		return v;
+	}
+
+	bool read_tag(const char *tag)
+	{
+		if (!check(4))
+			return false;
+		const bool ret = (::memcmp(m_data + m_pos, tag, 4) == 0);
+		m_pos += 4;
+		return ret;
+	}
+
+	void skip(uint32_t n)
+	{
+		if (check(n))
+			m_pos += n;
+	}
+
+	const uint8_t *data() const
+		{ return m_data + m_pos; }
+
+private:
+
+	const uint8_t *m_data;
+	uint32_t m_size;
+	uint32_t m_pos;
+	bool m_ok;
+};
+
+
+//-------------------------------------------------------------------------
+// drumkv1_smf - Standard MIDI File (SMF) reader.
+//
+
+// tick-stamped event, before the tempo map gets applied.
+struct drumkv1_smf_item
+{
+	uint64_t tick;
+	uint32_t order;
+	uint32_t tempo;		// usecs per quarter-note (0 = channel event).
+	uint8_t  data[3];
+	uint8_t  size;
+};
+
+static bool drumkv1_smf_item_less (
+	const drumkv1_smf_item& a, const drumkv1_smf_item& b )
+{
+	return (a.tick < b.tick || (a.tick == b.tick && a.order < b.order));
+}
+
+
+// ctor.
+drumkv1_smf::drumkv1_smf (void)
+	: m_format(0), m_tracks(0)
+{
+}
+
+
+// reset to empty.
+void drumkv1_smf::clear (void)
+{
+	m_format = 0;
+	m_tracks = 0;
+
+	m_events.clear();
+}
+
+
+// file reader.
+bool drumkv1_smf::open ( const QString& sFilename )
+{
+	QFile file(sFilename);
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+
+	const QByteArray& data = file.readAll();
+	file.close();
+
+	return read(data);
+}
+
+
+// data reader.
+bool drumkv1_smf::read ( const QByteArray& data )
+{
+	clear();
+
+	drumkv1_smf_reader r(
+		reinterpret_cast<const uint8_t *> (data.constData()), data.size());
+
+	// header chunk...
+	if (!r.read_tag("MThd"))
+		return false;
+	const uint32_t hlen = r.read_be(4);
+	if (hlen < 6)
+		return false;
+	const uint16_t format = r.read_be(2);
+	const uint16_t ntracks = r.read_be(2);
+	const uint16_t division = r.read_be(2);
+	r.skip(hlen - 6);
+	if (!r.ok() || division == 0)
+		return false;
+
+	// seconds per tick (SMPTE) or ticks per quarter-note...
+	double tick_secs = 0.0;
+	uint32_t tpqn = 0;
+	if (division & 0x8000) {
+		const int fps = -int(int8_t(division >> 8));
+		const int tpf = (division & 0xff);
+		if (fps <= 0 || tpf <= 0)
+			return false;
+		tick_secs = (fps == 29 ? 1.0 / (29.97 * tpf) : 1.0 / (fps * tpf));
+	} else {
+		tpqn = division;
+	}
+
+	std::vector<drumkv1_smf_item> items;
+	uint32_t order = 0;
+
+	// track chunks...
+	uint16_t ntrack = 0;
+	while (ntrack < ntracks && !r.at_end() && r.ok()) {
+		const bool bTrack = r.read_tag("MTrk");
+		const uint32_t tlen = r.read_be(4);
+		if (!r.check(tlen))
+			return false;
+		if (!bTrack) {
+			r.skip(tlen); // unknown chunk.
+			continue;
+		}
+		drumkv1_smf_reader t(r.data(), tlen);
+		r.skip(tlen);
+		++ntrack;
+		uint64_t tick = 0;
+		uint8_t status = 0;
+		while (!t.at_end() && t.ok()) {
+			tick += t.read_vlq();
+			uint8_t c = t.peek_u8();
+			if (c & 0x80) {
+				t.read_u8();
+				if (c < 0xf0)
+					status = c; // running status.
+			}
+			else
+			if (status) {
+				c = status;
+			}
+			else {
+				return false; // data byte without status.
+			}
+			if (c == 0xff) {
+				// meta event...
+				const uint8_t type = t.read_u8();
+				const uint32_t len = t.read_vlq();
+				if (type == 0x2f)
+					break; // end of track.
+				if (type == 0x51 && len >= 3) {
+					drumkv1_smf_item item;
+					item.tick  = tick;
+					item.order = order++;
+					item.tempo = t.read_be(3);
+					item.size  = 0;
+					t.skip(len - 3);
+					if (item.tempo > 0)
+						items.push_back(item);
+				}
+				else t.skip(len);
+			}
+			else
+			if (c == 0xf0 || c == 0xf7) {
+				// sysex (dropped)...
+				t.skip(t.read_vlq());
+			}
+			else
+			if (c >= 0xf0) {
+				// system common/real-time (not in files anyway).
+				continue;
+			}
+			else {
+				// channel event...
+				drumkv1_smf_item item;
+				item.tick  = tick;
+				item.order = order++;
+				item.tempo = 0;
+				item.data[0] = c;
+				item.data[1] = t.read_u8() & 0x7f;
+				item.data[2] = 0;
+				item.size = 2;
+				const uint8_t type = (c & 0xf0);
+				if (type != 0xc0 && type != 0xd0) {
+					item.data[2] = t.read_u8() & 0x7f;
+					item.size = 3;
+				}
+				if (t.ok())
+					items.push_back(item);
+			}
+		}
+	}
+
+	if (!r.ok())
+		return false;
+
+	// merge all tracks, apply the tempo map...
+	std::stable_sort(items.begin(), items.end(), drumkv1_smf_item_less);
+
+	m_events.reserve(items.size());
+
+	uint32_t tempo = 500000; // 120bpm.
+	uint64_t tick0 = 0;
+	double time0 = 0.0;
+
+	std::vector<drumkv1_smf_item>::const_iterator iter = items.begin();
+	for ( ; iter != items.end(); ++iter) {
+		const drumkv1_smf_item& item = *iter;
+		const double secs = (tpqn > 0
+			? 1E-6 * double(tempo) / double(tpqn) : tick_secs);
+		time0 += double(item.tick - tick0) * secs;
+		tick0 = item.tick;
+		if (item.tempo > 0) {
+			tempo = item.tempo;
+			continue;
+		}
+		Event event;
+		event.time = time0;
+		event.data[0] = item.data[0];
+		event.data[1] = item.data[1];
+		event.data[2] = item.data[2];
+		event.size = item.size;
+		m_events.push_back(event);
+	}
+
+	m_format = format;
+	m_tracks = ntrack;
+
+	return true;
+}
+
+
+// last event time (seconds).
+double drumkv1_smf::duration (void) const
+{
+	return (m_events.empty() ? 0.0 : m_events.back().time);
+}
+
+
+// end of drumkv1_smf.cpp
@@ -0,0 +1,89 @@
+// drumkv1_smf.h
+//
+/****************************************************************************
+   Copyright (C) 2012-2021, rncbc aka Rui Nuno Capela. All rights reserved.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*****************************************************************************/
+
+#ifndef __drumkv1_smf_h
+#define __drumkv1_smf_h
+
+#include <QString>
+#include <QByteArray>
+
+#include <vector>
+
+#include <stdint.h>
+
+
+//-------------------------------------------------------------------------
+// drumkv1_smf - Standard MIDI File (SMF) reader.
+//
+// All tracks are merged into one single time-ordered list of channel
+// events, with the tempo map already applied (times in seconds).
+// System exclusive and meta events (other than tempo) are dropped.
+//
+
+class drumkv1_smf
+{
+public:
+
+	// ctor.
+	drumkv1_smf();
+
+	// channel event.
+	struct Event
+	{
+		double  time;		// seconds.
+		uint8_t data[3];
+		uint8_t size;
+	};
+
+	typedef std::vector<Event> Events;
+
+	// file/data readers.
+	bool open(const QString& sFilename);
+	bool read(const QByteArray& data);
+
+	// reset to empty.
+	void clear();
+
+	// accessors.
+	const Events& events() const
+		{ return m_events; }
+
+	uint16_t format() const
+		{ return m_format; }
+	uint16_t tracks() const
+		{ return m_tracks; }
+
+	// last event time (seconds).
+	double duration() const;
+
+private:
+
+	// instance variables.
+	uint16_t m_format;
+	uint16_t m_tracks;
+
+	Events m_events;
+};
+
+
+#endif	// __drumkv1_smf_h
+
+// end of drumkv1_smf.h
@@ -0,0 +1,573 @@
+// drumkv1_state.cpp
+//
+/****************************************************************************
+   Copyright (C) 2012-2021, rncbc aka Rui Nuno Capela. All rights reserved.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*****************************************************************************/
+
+#include "drumkv1_state.h"
+#include "drumkv1_sample.h"
+
+#include <QString>
+
+
+//-------------------------------------------------------------------------
+// drumkv1_state - chunk format (little-endian):
+//
+//   magic[8] version flags
+//   [Elements] nelems nparams
+//     { note offset-start offset-end rate file params[nparams] } ...
+//   [Params] nglobals params[nglobals]
+//   [Tuning] enabled ref-pitch ref-note scale-file keymap-file
+//
+// Strings are length prefixed UTF-8 (no terminator).
+//
+
+static const char     DRUMKV1_STATE_MAGIC[8] = { 'd','r','u','m','k','v','1','s' };
+static const uint32_t DRUMKV1_STATE_VERSION  = 1;
+
+
+// Chunk writer.
+class drumkv1_state_writer
+{
+public:
+
+	drumkv1_state_writer(QByteArray& data) : m_data(data) {}
+
+	void write_u32(uint32_t v)
+	{
+		const char b[4] = {
+			char(v & 0xff), char((v >> 8) & 0xff),
+			char((v >> 16) & 0xff), char((v >> 24) & 0xff) };
+		m_data.append(b, 4);
+	}
+
+	void write_f32(float f)
+	{
+		uint32_t v;
+		::memcpy(&v, &f, sizeof(v));
+		write_u32(v);
+	}
+
+	void write_str(const QByteArray& s)
+	{
+		write_u32(s.size());
+		m_data.append(s.constData(), s.size());
+	}
+
+private:
+
+	QByteArray& m_data;
+};
+
+
+// Chunk reader.
+class drumkv1_state_reader
+{
+public:
+
+	drumkv1_state_reader(const QByteArray& data)
+		: m_data(reinterpret_cast<const uint8_t *> (data.constData())),
+			m_size(data.size()), m_pos(0), m_ok(true) {}
+
+	bool ok() const { return m_ok; }
+
+	bool at_end() const { return m_pos >= m_size; }
+
+	bool check(uint64_t n)
+	{
+		if (m_ok && n > uint64_t(m_size - m_pos))
+			m_ok = false;
+		return m_ok;
+	}
+
+	uint32_t read_u32()
+	{
+		if (!check(4))
+			return 0;
+		const uint8_t *b = m_data + m_pos;
+		m_pos += 4;
+		return uint32_t(b[0]) | (uint32_t(b[1]) << 8)
+			| (uint32_t(b[2]) << 16) | (uint32_t(b[3]) << 24);
+	}
+
+	float read_f32()
+	{
+		const uint32_t v = read_u32();
+		float f;
+		::memcpy(&f, &v, sizeof(f));
+		return f;
+	}
+
+	QByteArray read_str()
+	{
+		const uint32_t n = read_u32();
+		if (!check(n))
+			return QByteArray();
+		const char *s = reinterpret_cast<const char *> (m_data + m_pos);
+		m_pos += n;
+		return QByteArray(s, n);
+	}
+
+	bool read_magic()
+	{
+		if (!check(sizeof(DRUMKV1_STATE_MAGIC)))
+			return false;
+		const bool ret = (::memcmp(m_data + m_pos,
+			DRUMKV1_STATE_MAGIC, sizeof(DRUMKV1_STATE_MAGIC)) == 0);
+		m_pos += sizeof(DRUMKV1_STATE_MAGIC);
+		return ret;
+	}
+
+private:
+
+	const uint8_t *m_data;
+	uint32_t m_size;
+	uint32_t m_pos;
+	bool m_ok;
+};
+
+
+//-------------------------------------------------------------------------
+// drumkv1_state - compact binary plugin state codec.
+//
+
+// ctor.
+drumkv1_state::drumkv1_state ( drumkv1 *pDrumk )
+	: m_pDrumk(pDrumk), m_changed(false),
+		m_serial(0), m_load_serial(0), m_sched(pDrumk, this)
+{
+}
+
+
+// dtor.
+drumkv1_state::~drumkv1_state (void)
+{
+	// cancel any pending load (m_sched waits for it to bail out)...
+	const std::lock_guard<std::mutex> lock(m_mutex);
+	m_resolved.clear();
+	++m_serial;
+}
+
+
+// encode current state.
+const QByteArray& drumkv1_state::save (
+	const drumkv1_param::map_path& mapPath, int flags )
+{
+	// still loading? give back what was handed over,
+	// with sample paths mapped as saved right here...
+	QByteArray resolved;
+	{
+		const std::lock_guard<std::mutex> lock(m_mutex);
+		resolved = m_resolved;
+	}
+
+	if (!resolved.isEmpty()) {
+		const QByteArray& data = resolve(resolved, mapPath, true);
+		m_changed = (data != m_data);
+		if (m_changed)
+			m_data = data;
+		return m_data;
+	}
+
+	QByteArray data;
+	data.reserve(m_data.size());
+
+	drumkv1_state_writer w(data);
+
+	data.append(DRUMKV1_STATE_MAGIC, sizeof(DRUMKV1_STATE_MAGIC));
+	w.write_u32(DRUMKV1_STATE_VERSION);
+	w.write_u32(flags);
+
+	if (flags & Elements) {
+		QList<drumkv1_element *> elements;
+		for (int note = 0; note < 128; ++note) {
+			drumkv1_element *element = m_pDrumk->element(note);
+			if (element && element->sampleFile())
+				elements.append(element);
+		}
+		w.write_u32(elements.count());
+		w.write_u32(drumkv1::NUM_ELEMENT_PARAMS);
+		QListIterator<drumkv1_element *> iter(elements);
+		while (iter.hasNext()) {
+			drumkv1_element *element = iter.next();
+			drumkv1_sample *sample = element->sample();
+			w.write_u32(element->note());
+			w.write_u32(element->offsetStart());
+			w.write_u32(element->offsetEnd());
+			w.write_f32(sample ? sample->rate() : 0.0f);
+			w.write_str(mapPath.abstractPath(
+				drumkv1_param::saveFilename(
+					QString::fromUtf8(element->sampleFile()), false)).toUtf8());
+			for (uint32_t i = 0; i < drumkv1::NUM_ELEMENT_PARAMS; ++i)
+				w.write_f32(element->paramValue(drumkv1::ParamIndex(i)));
+		}
+	}
+
+	if (flags & Params) {
+		w.write_u32(drumkv1::NUM_PARAMS - drumkv1::NUM_ELEMENT_PARAMS);
+		for (uint32_t i = drumkv1::NUM_ELEMENT_PARAMS; i < drumkv1::NUM_PARAMS; ++i)
+			w.write_f32(m_pDrumk->paramValue(drumkv1::ParamIndex(i)));
+	}
+
+	if (flags & Tuning) {
+		w.write_u32(m_pDrumk->isTuningEnabled() ? 1 : 0);
+		w.write_f32(m_pDrumk->tuningRefPitch());
+		w.write_u32(uint32_t(m_pDrumk->tuningRefNote()));
+		w.write_str(QByteArray(m_pDrumk->tuningScaleFile()));
+		w.write_str(QByteArray(m_pDrumk->tuningKeyMapFile()));
+	}
+
+	// dirty? otherwise keep the last one.
+	m_changed = (data != m_data);
+	if (m_changed)
+		m_data = data;
+
+	return m_data;
+}
+
+
+// decode and apply.
+bool drumkv1_state::load (
+	const QByteArray& data, const drumkv1_param::map_path& mapPath )
+{
+	return decode(data, mapPath, false);
+}
+
+
+// decode and apply (current or staged element set).
+bool drumkv1_state::decode ( const QByteArray& data,
+	const drumkv1_param::map_path& mapPath, bool bStaged )
+{
+	drumkv1_state_reader r(data);
+
+	if (!r.read_magic() || r.read_u32() != DRUMKV1_STATE_VERSION)
+		return false;
+
+	const uint32_t flags = r.read_u32();
+
+	if (flags & Elements) {
+		bool keep[128];
+		::memset(keep, 0, sizeof(keep));
+		const uint32_t nelems = r.read_u32();
+		const uint32_t nparams = r.read_u32();
+		for (uint32_t n = 0; n < nelems && r.ok(); ++n) {
+			const uint32_t note = r.read_u32();
+			const uint32_t iOffsetStart = r.read_u32();
+			const uint32_t iOffsetEnd = r.read_u32();
+			const float fRate = r.read_f32();
+			const QString& sSampleFile = QString::fromUtf8(r.read_str());
+			if (!r.check(uint64_t(nparams) * sizeof(float)) || note > 127)
+				break;
+			// staged: a fresh set, nothing to look up there.
+			drumkv1_element *element = nullptr;
+			if (!bStaged)
+				element = m_pDrumk->element(note);
+			if (element == nullptr)
+				element = m_pDrumk->addElement(note);
+			if (element == nullptr)
+				break;
+			for (uint32_t i = nparams; i < drumkv1::NUM_ELEMENT_PARAMS; ++i) {
+				const drumkv1::ParamIndex index = drumkv1::ParamIndex(i);
+				const float fDefValue = drumkv1_param::paramDefaultValue(index);
+				element->setParamValue(index, fDefValue, 0);
+				element->setParamValue(index, fDefValue);
+			}
+			// same sample already in place? keep it; staged, share
+			// its frames with the current (still playing) element...
+			drumkv1_element *current = element;
+			if (bStaged)
+				current = m_pDrumk->element(note);
+			const QByteArray aSampleFile
+				= drumkv1_param::loadFilename(
+					mapPath.absolutePath(sSampleFile)).toUtf8();
+			const char *pszSampleFile
+				= (current ? current->sampleFile() : nullptr);
+			drumkv1_sample *sample = (current ? current->sample() : nullptr);
+			const bool bSameSample = (pszSampleFile && sample
+				&& ::strcmp(pszSampleFile, aSampleFile.constData()) == 0
+				&& sample->rate() == fRate
+				&& sample->sampleRate() == m_pDrumk->sampleRate());
+			if (!bSameSample || (bStaged && !element->shareSample(current)))
+				element->setSampleFile(aSampleFile.constData());
+			if (!bSameSample || bStaged
+				|| element->offsetStart() != iOffsetStart
+				|| element->offsetEnd() != iOffsetEnd)
+				element->setOffsetRange(iOffsetStart, iOffsetEnd);
+			for (uint32_t i = 0; i < nparams; ++i) {
+				const float fValue = r.read_f32();
+				if (i >= drumkv1::NUM_ELEMENT_PARAMS)
+					continue;
+				const drumkv1::ParamIndex index = drumkv1::ParamIndex(i);
+				const float fSafeValue
+					= drumkv1_param::paramSafeValue(index, fValue);
+				element->setParamValue(index, fSafeValue, 0);
+				element->setParamValue(index, fSafeValue);
+			}
+			keep[note] = true;
+			// staged: report progress, bail out if superseded...
+			if (bStaged) {
+				if (!isCurrent(m_load_serial))
+					return false;
+				drumkv1_sched::sync_notify(m_pDrumk,
+					drumkv1_sched::State, 1 + (99 * n) / nelems);
+			}
+		}
+		// drop all the others (unless truncated)...
+		for (int note = 0; note < 128 && r.ok() && !bStaged; ++note) {
+			if (!keep[note] && m_pDrumk->element(note))
+				m_pDrumk->removeElement(note);
+		}
+	}
+
+	if (flags & Params) {
+		const uint32_t nglobals = r.read_u32();
+		for (uint32_t i = 0; i < nglobals && r.ok(); ++i) {
+			const float fValue = r.read_f32();
+			const uint32_t j = drumkv1::NUM_ELEMENT_PARAMS + i;
+			if (j >= drumkv1::NUM_PARAMS)
+				continue;
+			const drumkv1::ParamIndex index = drumkv1::ParamIndex(j);
+			m_pDrumk->setParamValue(index,
+				drumkv1_param::paramSafeValue(index, fValue));
+		}
+	}
+
+	if ((flags & Tuning) && r.ok()) {
+		const bool bEnabled = (r.read_u32() > 0);
+		const float fRefPitch = r.read_f32();
+		const int iRefNote = int(r.read_u32());
+		const QByteArray aScaleFile = r.read_str();
+		const QByteArray aKeyMapFile = r.read_str();
+		if (r.ok()) {
+			m_pDrumk->setTuningEnabled(bEnabled);
+			m_pDrumk->setTuningRefPitch(fRefPitch);
+			m_pDrumk->setTuningRefNote(iRefNote);
+			m_pDrumk->setTuningScaleFile(aScaleFile.constData());
+			m_pDrumk->setTuningKeyMapFile(aKeyMapFile.constData());
+			// staged: consolidated on commit.
+			if (!bStaged)
+				m_pDrumk->updateTuning();
+		}
+	}
+
+	return r.ok();
+}
+
+
+// whether all element samples are already in place.
+bool drumkv1_state::isLoaded (
+	const QByteArray& data, const drumkv1_param::map_path& mapPath ) const
+{
+	drumkv1_state_reader r(data);
+
+	if (!r.read_magic() || r.read_u32() != DRUMKV1_STATE_VERSION)
+		return false;
+
+	const uint32_t flags = r.read_u32();
+	if ((flags & Elements) == 0)
+		return true;
+
+	const uint32_t nelems = r.read_u32();
+	const uint32_t nparams = r.read_u32();
+	for (uint32_t n = 0; n < nelems && r.ok(); ++n) {
+		const uint32_t note = r.read_u32();
+		r.read_u32(); // offset-start
+		r.read_u32(); // offset-end
+		const float fRate = r.read_f32();
+		const QString& sSampleFile = QString::fromUtf8(r.read_str());
+		if (!r.check(uint64_t(nparams) * sizeof(float)) || note > 127)
+			return false;
+		for (uint32_t i = 0; i < nparams; ++i)
+			r.read_f32();
+		drumkv1_element *element = m_pDrumk->element(note);
+		if (element == nullptr)
+			return false;
+		const QByteArray aSampleFile
+			= drumkv1_param::loadFilename(
+				mapPath.absolutePath(sSampleFile)).toUtf8();
+		const char *pszSampleFile = element->sampleFile();
+		drumkv1_sample *sample = element->sample();
+		if (pszSampleFile == nullptr || sample == nullptr
+			|| ::strcmp(pszSampleFile, aSampleFile.constData())
+			|| sample->rate() != fRate
+			|| sample->sampleRate() != m_pDrumk->sampleRate())
+			return false;
+	}
+
+	return r.ok();
+}
+
+
+// same chunk, with all sample paths made absolute (or abstract).
+QByteArray drumkv1_state::resolve ( const QByteArray& data,
+	const drumkv1_param::map_path& mapPath, bool bAbstract )
+{
+	drumkv1_state_reader r(data);
+
+	if (!r.read_magic() || r.read_u32() != DRUMKV1_STATE_VERSION)
+		return QByteArray();
+
+	QByteArray ret;
+	ret.reserve(data.size());
+
+	drumkv1_state_writer w(ret);
+
+	ret.append(DRUMKV1_STATE_MAGIC, sizeof(DRUMKV1_STATE_MAGIC));
+	w.write_u32(DRUMKV1_STATE_VERSION);
+
+	const uint32_t flags = r.read_u32();
+	w.write_u32(flags);
+
+	if (flags & Elements) {
+		const uint32_t nelems = r.read_u32();
+		const uint32_t nparams = r.read_u32();
+		w.write_u32(nelems);
+		w.write_u32(nparams);
+		for (uint32_t n = 0; n < nelems && r.ok(); ++n) {
+			w.write_u32(r.read_u32()); // note
+			w.write_u32(r.read_u32()); // offset-start
+			w.write_u32(r.read_u32()); // offset-end
+			w.write_f32(r.read_f32()); // rate
+			const QString& sSampleFile = QString::fromUtf8(r.read_str());
+			if (bAbstract) {
+				w.write_str(mapPath.abstractPath(
+					drumkv1_param::saveFilename(sSampleFile, false)).toUtf8());
+			} else {
+				w.write_str(drumkv1_param::loadFilename(
+					mapPath.absolutePath(sSampleFile)).toUtf8());
+			}
+			if (!r.check(uint64_t(nparams) * sizeof(float)))
+				break;
+			for (uint32_t i = 0; i < nparams; ++i)
+				w.write_f32(r.read_f32());
+		}
+	}
+
+	if (flags & Params) {
+		const uint32_t nglobals = r.read_u32();
+		w.write_u32(nglobals);
+		for (uint32_t i = 0; i < nglobals && r.ok(); ++i)
+			w.write_f32(r.read_f32());
+	}
+
+	if (flags & Tuning) {
+		w.write_u32(r.read_u32());
+		w.write_f32(r.read_f32());
+		w.write_u32(r.read_u32());
+		w.write_str(r.read_str());
+		w.write_str(r.read_str());
+	}
+
+	if (!r.ok() || !r.at_end())
+		return QByteArray();
+
+	return ret;
+}
+
+
+// asynchronous load.
+bool drumkv1_state::schedule (
+	const QByteArray& data, const drumkv1_param::map_path& mapPath )
+{
+	// mapPath may not outlive this call: resolve it now.
+	const QByteArray& resolved = resolve(data, mapPath);
+	if (resolved.isEmpty())
+		return false;
+
+	{
+		const std::lock_guard<std::mutex> lock(m_mutex);
+		m_resolved = resolved;
+		++m_serial;
+	}
+
+	m_sched.schedule();
+	return true;
+}
+
+
+// whether an asynchronous load is still pending.
+bool drumkv1_state::isPending (void) const
+{
+	const std::lock_guard<std::mutex> lock(m_mutex);
+	return !m_resolved.isEmpty();
+}
+
+
+// whether an asynchronous load is still the latest.
+bool drumkv1_state::isCurrent ( uint32_t serial ) const
+{
+	const std::lock_guard<std::mutex> lock(m_mutex);
+	return (serial == m_serial);
+}
+
+
+// asynchronous load processor (scheduled thread).
+void drumkv1_state::process_load (void)
+{
+	QByteArray data;
+	{
+		const std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_resolved.isEmpty())
+			return;
+		data = m_resolved;
+		m_load_serial = m_serial;
+	}
+
+	// paths are all absolute by now.
+	drumkv1_param::map_path mapPath;
+
+	m_pDrumk->beginElements();
+
+	const bool ret = decode(data, mapPath, true);
+
+	drumkv1_kit *pKit = m_pDrumk->takeElements();
+
+	bool bCurrent = false;
+	{
+		const std::lock_guard<std::mutex> lock(m_mutex);
+		bCurrent = (m_load_serial == m_serial);
+		if (bCurrent)
+			m_resolved.clear();
+	}
+
+	// superseded or broken: just drop it...
+	if (!ret || !bCurrent) {
+		m_pDrumk->freeElements(pKit);
+		// done, whatever the outcome (clears progress).
+		drumkv1_sched::sync_notify(m_pDrumk, drumkv1_sched::State, 0);
+		return;
+	}
+
+	// adopted right away when inactive, otherwise at the next
+	// block boundary (notified then, see drumkv1::adoptElements).
+	m_pDrumk->adoptElements(pKit);
+
+	drumkv1_sched::sync_notify(m_pDrumk, drumkv1_sched::State, 0);
+}
+
+
+// whether it looks like a binary state chunk.
+bool drumkv1_state::isState ( const QByteArray& data )
+{
+	return (uint32_t(data.size()) >= sizeof(DRUMKV1_STATE_MAGIC)
+		&& ::memcmp(data.constData(),
+			DRUMKV1_STATE_MAGIC, sizeof(DRUMKV1_STATE_MAGIC)) == 0);
+}
+
+
+// end of drumkv1_state.cpp
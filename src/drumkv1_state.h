@@ -0,0 +1,147 @@
+// drumkv1_state.h
+//
+/****************************************************************************
+   Copyright (C) 2012-2021, rncbc aka Rui Nuno Capela. All rights reserved.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*****************************************************************************/
+
+#ifndef __drumkv1_state_h
+#define __drumkv1_state_h
+
+#include "drumkv1_param.h"
+#include "drumkv1_sched.h"
+
+#include <QByteArray>
+
+#include <mutex>
+
+
+//-------------------------------------------------------------------------
+// drumkv1_state - compact binary plugin state codec.
+//
+
+class drumkv1_state
+{
+public:
+
+	// ctor.
+	drumkv1_state(drumkv1 *pDrumk);
+
+	// dtor.
+	~drumkv1_state();
+
+	// state sections.
+	enum Flags { Elements = 1, Params = 2, Tuning = 4 };
+
+	// encode current state; the last chunk is kept as is
+	// (and so reused) when nothing has changed since; while
+	// an asynchronous load is pending, that one is given back
+	// (sample paths mapped as saved).
+	const QByteArray& save(const drumkv1_param::map_path& mapPath, int flags);
+
+	// whether the last save() produced a new chunk.
+	bool isChanged() const
+		{ return m_changed; }
+
+	// last saved chunk.
+	const QByteArray& data() const
+		{ return m_data; }
+
+	// decode and apply; elements already holding the same
+	// sample file, at the same rate, are not reloaded (staged
+	// sets share those frames with the current elements).
+	bool load(const QByteArray& data, const drumkv1_param::map_path& mapPath);
+
+	// whether all element samples are already in place,
+	// ie. load() would not have to decode anything.
+	bool isLoaded(const QByteArray& data,
+		const drumkv1_param::map_path& mapPath) const;
+
+	// asynchronous load: sample paths are resolved and the chunk
+	// checked right away, then decoded into a staged element set
+	// off-thread and committed at a block boundary (non-blocking).
+	bool schedule(const QByteArray& data,
+		const drumkv1_param::map_path& mapPath);
+
+	// whether an asynchronous load is still pending.
+	bool isPending() const;
+
+	// whether it looks like a binary state chunk (vs. legacy XML).
+	static bool isState(const QByteArray& data);
+
+protected:
+
+	// decode and apply (current or staged element set).
+	bool decode(const QByteArray& data,
+		const drumkv1_param::map_path& mapPath, bool bStaged);
+
+	// same chunk, with all sample paths made absolute, or
+	// abstract as saved (empty if malformed).
+	static QByteArray resolve(const QByteArray& data,
+		const drumkv1_param::map_path& mapPath, bool bAbstract = false);
+
+	// whether an asynchronous load is still the latest.
+	bool isCurrent(uint32_t serial) const;
+
+	// asynchronous load processor (scheduled thread).
+	void process_load();
+
+	// asynchronous load scheduled thread.
+	class Sched : public drumkv1_sched
+	{
+	public:
+
+		// ctor.
+		Sched (drumkv1 *pDrumk, drumkv1_state *pState)
+			: drumkv1_sched(pDrumk, State), m_pState(pState) {}
+
+		// dtor.
+		~Sched ()
+			{ sync_drain(); }
+
+		// process (virtual).
+		void process(int)
+			{ m_pState->process_load(); }
+
+	private:
+
+		// instance variables.
+		drumkv1_state *m_pState;
+	};
+
+private:
+
+	// instance variables.
+	drumkv1 *m_pDrumk;
+
+	QByteArray m_data;
+	bool m_changed;
+
+	// pending asynchronous load.
+	mutable std::mutex m_mutex;
+
+	QByteArray m_resolved;
+	uint32_t   m_serial;
+	uint32_t   m_load_serial;
+
+	Sched m_sched;
+};
+
+
+#endif	// __drumkv1_state_h
+
+// end of drumkv1_state.h
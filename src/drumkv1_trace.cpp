@@ -0,0 +1,397 @@
+// drumkv1_trace.cpp
+//
+/****************************************************************************
+   Copyright (C) 2012-2021, rncbc aka Rui Nuno Capela. All rights reserved.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*****************************************************************************/
+
+#include "drumkv1_trace.h"
+
+
+#ifdef CONFIG_TRACE
+
+#include "drumkv1_load.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+
+// default output file and drain period (msecs).
+#define DRUMKV1_TRACE_FILE   "drumkv1-trace.json"
+#define DRUMKV1_TRACE_PERIOD 100
+
+
+//-------------------------------------------------------------------------
+// drumkv1_trace_ring - per-thread record ring (single writer/reader).
+//
+
+// max. traced threads and records per thread (power of two).
+static const uint32_t MaxRings   = 16;
+static const uint32_t NumRecords = 8192;
+
+struct drumkv1_trace_ring
+{
+	drumkv1_trace::Record records[NumRecords];
+
+	std::atomic<uint32_t> iwrite;
+	std::atomic<uint32_t> iread;
+	std::atomic<uint32_t> dropped;
+
+	std::atomic<uint32_t> state;
+	std::atomic<uint32_t> tid;
+};
+
+
+// ring states: free, owned by a thread or released on its exit
+// (then freed by the writer, as soon as it's all drained).
+enum { RingFree = 0, RingUsed, RingReleased };
+
+
+// all rings preallocated, claimed on first use by each thread;
+// threads in excess of MaxRings at a time are not traced at all,
+// just counted (unclaimed).
+static drumkv1_trace_ring g_trace_rings[MaxRings];
+static std::atomic<uint32_t> g_trace_ntids(0);
+static std::atomic<uint32_t> g_trace_unclaimed(0);
+
+
+//-------------------------------------------------------------------------
+// drumkv1_trace_claim - per-thread ring claim (released on thread exit).
+//
+
+class drumkv1_trace_claim
+{
+public:
+
+	drumkv1_trace_claim() : m_ring(nullptr), m_claimed(false) {}
+	~drumkv1_trace_claim() { release(); }
+
+	// claimed once, on first use.
+	drumkv1_trace_ring *ring()
+	{
+		if (!m_claimed)
+			claim();
+		return m_ring;
+	}
+
+protected:
+
+	void claim();
+	void release();
+
+private:
+
+	drumkv1_trace_ring *m_ring;
+	bool m_claimed;
+};
+
+
+void drumkv1_trace_claim::claim (void)
+{
+	m_claimed = true;
+
+	for (uint32_t i = 0; i < MaxRings; ++i) {
+		drumkv1_trace_ring& ring = g_trace_rings[i];
+		uint32_t state = RingFree;
+		if (ring.state.compare_exchange_strong(state, RingUsed,
+				std::memory_order_acq_rel)) {
+			ring.tid.store(g_trace_ntids.fetch_add(1,
+				std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			m_ring = &ring;
+			return;
+		}
+	}
+
+	g_trace_unclaimed.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+void drumkv1_trace_claim::release (void)
+{
+	if (m_ring) {
+		m_ring->state.store(RingReleased, std::memory_order_release);
+		m_ring = nullptr;
+	}
+}
+
+
+static thread_local drumkv1_trace_claim g_trace_claim;
+
+
+//-------------------------------------------------------------------------
+// drumkv1_trace_writer - background JSON writer thread.
+//
+
+class drumkv1_trace_writer
+{
+public:
+
+	drumkv1_trace_writer(FILE *file);
+	~drumkv1_trace_writer();
+
+protected:
+
+	void run();
+	void drain();
+
+	void write_ring(uint32_t i, drumkv1_trace_ring& ring);
+	void free_ring(uint32_t i, drumkv1_trace_ring& ring);
+
+private:
+
+	FILE *m_file;
+	bool m_first;
+	uint64_t m_stamp0;
+
+	uint32_t m_dropped[MaxRings];
+	uint32_t m_unclaimed;
+
+	bool m_running;
+	std::mutex m_mutex;
+	std::condition_variable m_cond;
+	std::thread m_thread;
+};
+
+
+// ctor.
+drumkv1_trace_writer::drumkv1_trace_writer ( FILE *file )
+	: m_file(file), m_first(true),
+		m_stamp0(drumkv1_trace::now()), m_running(true)
+{
+	// rings released before this very session are stale.
+	for (uint32_t i = 0; i < MaxRings; ++i) {
+		drumkv1_trace_ring& ring = g_trace_rings[i];
+		if (ring.state.load(std::memory_order_acquire) == RingReleased) {
+			ring.iread.store(ring.iwrite.load(std::memory_order_acquire),
+				std::memory_order_relaxed);
+			free_ring(i, ring);
+		}
+		m_dropped[i] = ring.dropped.load();
+	}
+
+	m_unclaimed = g_trace_unclaimed.load();
+
+	// JSON array format: readable even if never closed.
+	::fputs("[\n", m_file);
+
+	m_thread = std::thread([this] { run(); });
+}
+
+
+// dtor.
+drumkv1_trace_writer::~drumkv1_trace_writer (void)
+{
+	{
+		const std::lock_guard<std::mutex> lock(m_mutex);
+		m_running = false;
+	}
+
+	m_cond.notify_all();
+
+	if (m_thread.joinable())
+		m_thread.join();
+
+	drain();
+
+	::fputs("\n]\n", m_file);
+	::fclose(m_file);
+}
+
+
+// writer thread loop.
+void drumkv1_trace_writer::run (void)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (m_running) {
+		m_cond.wait_for(lock,
+			std::chrono::milliseconds(DRUMKV1_TRACE_PERIOD));
+		drain();
+	}
+}
+
+
+// dump all pending records.
+void drumkv1_trace_writer::drain (void)
+{
+	for (uint32_t i = 0; i < MaxRings; ++i) {
+		drumkv1_trace_ring& ring = g_trace_rings[i];
+		const uint32_t state = ring.state.load(std::memory_order_acquire);
+		if (state == RingFree)
+			continue;
+		write_ring(i, ring);
+		// owner thread is gone, nothing left to drain.
+		if (state == RingReleased)
+			free_ring(i, ring);
+	}
+
+	// threads left untraced (no free ring)?
+	const uint32_t unclaimed = g_trace_unclaimed.load(std::memory_order_relaxed);
+	if (m_unclaimed != unclaimed) {
+		m_unclaimed = unclaimed;
+		const double ts = 1E-3 * double(drumkv1_trace::now() - m_stamp0);
+		::fprintf(m_file, "%s{\"name\":\"unclaimed\",\"ph\":\"C\",\"pid\":1,"
+			"\"tid\":0,\"ts\":%.3f,\"args\":{\"threads\":%u}}",
+			m_first ? "" : ",\n", ts, unclaimed);
+		m_first = false;
+	}
+
+	::fflush(m_file);
+}
+
+
+void drumkv1_trace_writer::write_ring (
+	uint32_t i, drumkv1_trace_ring& ring )
+{
+	const uint32_t iwrite = ring.iwrite.load(std::memory_order_acquire);
+	const uint32_t tid = ring.tid.load(std::memory_order_relaxed);
+
+	uint32_t iread = ring.iread.load(std::memory_order_relaxed);
+	for ( ; iread != iwrite; ++iread) {
+		const drumkv1_trace::Record& rec
+			= ring.records[iread & (NumRecords - 1)];
+		// older than this very session?
+		if (rec.stamp < m_stamp0)
+			continue;
+		const double ts = 1E-3 * double(rec.stamp - m_stamp0);
+		::fputs(m_first ? "" : ",\n", m_file);
+		if (rec.dur > 0) {
+			::fprintf(m_file, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,"
+				"\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"arg\":%d}}",
+				rec.name, tid, ts, 1E-3 * double(rec.dur), int(rec.arg));
+		} else {
+			::fprintf(m_file, "{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\","
+				"\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"args\":{\"arg\":%d}}",
+				rec.name, tid, ts, int(rec.arg));
+		}
+		m_first = false;
+	}
+
+	ring.iread.store(iread, std::memory_order_release);
+
+	// ring was full at some point?
+	const uint32_t dropped = ring.dropped.load(std::memory_order_relaxed);
+	if (m_dropped[i] != dropped) {
+		m_dropped[i] = dropped;
+		const double ts = 1E-3 * double(drumkv1_trace::now() - m_stamp0);
+		::fprintf(m_file, "%s{\"name\":\"dropped\",\"ph\":\"C\",\"pid\":1,"
+			"\"tid\":%u,\"ts\":%.3f,\"args\":{\"records\":%u}}",
+			m_first ? "" : ",\n", tid, ts, dropped);
+		m_first = false;
+	}
+}
+
+
+// back to the free list, fresh for the next claiming thread.
+void drumkv1_trace_writer::free_ring (
+	uint32_t i, drumkv1_trace_ring& ring )
+{
+	ring.dropped.store(0, std::memory_order_relaxed);
+	m_dropped[i] = 0;
+
+	ring.state.store(RingFree, std::memory_order_release);
+}
+
+
+//-------------------------------------------------------------------------
+// drumkv1_trace - audio thread trace recorder.
+//
+
+static std::mutex g_trace_mutex;
+static uint32_t g_trace_refs = 0;
+static drumkv1_trace_writer *g_trace_writer = nullptr;
+
+
+// background writer (reference counted).
+void drumkv1_trace::open (void)
+{
+	const std::lock_guard<std::mutex> lock(g_trace_mutex);
+
+	if (++g_trace_refs > 1)
+		return;
+
+	const char *filename = ::getenv("DRUMKV1_TRACE_FILE");
+	if (filename == nullptr || *filename == '\0')
+		filename = DRUMKV1_TRACE_FILE;
+
+	FILE *file = ::fopen(filename, "w");
+	if (file == nullptr) {
+		::fprintf(stderr, "drumkv1_trace: could not open \"%s\".\n", filename);
+		return;
+	}
+
+	g_trace_writer = new drumkv1_trace_writer(file);
+}
+
+
+void drumkv1_trace::close (void)
+{
+	const std::lock_guard<std::mutex> lock(g_trace_mutex);
+
+	if (g_trace_refs < 1 || --g_trace_refs > 0)
+		return;
+
+	if (g_trace_writer) {
+		delete g_trace_writer;
+		g_trace_writer = nullptr;
+	}
+}
+
+
+// any thread: record a complete (or instant) event.
+void drumkv1_trace::record (
+	const char *name, uint64_t stamp, uint32_t dur, int arg )
+{
+	drumkv1_trace_ring *pRing = g_trace_claim.ring();
+	if (pRing == nullptr)
+		return;
+
+	drumkv1_trace_ring& ring = *pRing;
+
+	const uint32_t iwrite = ring.iwrite.load(std::memory_order_relaxed);
+	if (iwrite - ring.iread.load(std::memory_order_acquire) >= NumRecords) {
+		ring.dropped.store(ring.dropped.load(std::memory_order_relaxed) + 1,
+			std::memory_order_relaxed);
+		return;
+	}
+
+	Record& rec = ring.records[iwrite & (NumRecords - 1)];
+	rec.stamp = stamp;
+	rec.dur   = dur;
+	rec.arg   = int32_t(arg);
+	rec.name  = name;
+
+	ring.iwrite.store(iwrite + 1, std::memory_order_release);
+}
+
+
+// monotonic clock (nanoseconds).
+uint64_t drumkv1_trace::now (void)
+{
+	return drumkv1_load::now();
+}
+
+
+#endif	// CONFIG_TRACE
+
+
+// end of drumkv1_trace.cpp
@@ -0,0 +1,114 @@
+// drumkv1_trace.h
+//
+/****************************************************************************
+   Copyright (C) 2012-2021, rncbc aka Rui Nuno Capela. All rights reserved.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program; if not, write to the Free Software Foundation, Inc.,
+   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+*****************************************************************************/
+
+#ifndef __drumkv1_trace_h
+#define __drumkv1_trace_h
+
+#include "config.h"
+
+
+//-------------------------------------------------------------------------
+// drumkv1_trace - audio thread trace recorder (CONFIG_TRACE only).
+//
+//   Trace points write fixed-size records into a per-thread lock-free
+//   ring (preallocated, never blocks); a background thread drains all
+//   rings into a Chrome-trace (Perfetto) JSON file, as given by the
+//   DRUMKV1_TRACE_FILE environment variable (default: drumkv1-trace.json).
+//   Rings are released on thread exit; threads finding none free are
+//   not traced, only counted ("unclaimed").
+//
+//   Names must be string literals (only the pointer gets recorded).
+//
+
+#ifdef CONFIG_TRACE
+
+#include <stdint.h>
+
+
+class drumkv1_trace
+{
+public:
+
+	// fixed-size record.
+	struct Record
+	{
+		uint64_t    stamp;	// nanoseconds (monotonic).
+		uint32_t    dur;	// nanoseconds, zero on instant events.
+		int32_t     arg;
+		const char *name;
+	};
+
+	// background writer (reference counted).
+	static void open();
+	static void close();
+
+	// any thread: record an instant event.
+	static void event(const char *name, int arg)
+		{ record(name, now(), 0, arg); }
+
+	// any thread: record a complete (begin + duration) event.
+	static void record(const char *name, uint64_t stamp, uint32_t dur, int arg);
+
+	// scoped complete event.
+	class Scope
+	{
+	public:
+
+		Scope(const char *name, int arg)
+			: m_name(name), m_arg(arg), m_stamp(now()) {}
+		~Scope()
+			{ record(m_name, m_stamp, uint32_t(now() - m_stamp) | 1, m_arg); }
+
+	private:
+
+		const char *m_name;
+		int         m_arg;
+		uint64_t    m_stamp;
+	};
+
+	// monotonic clock (nanoseconds).
+	static uint64_t now();
+};
+
+
+#define DRUMKV1_TRACE_CAT2(a, b)  a##b
+#define DRUMKV1_TRACE_CAT(a, b)   DRUMKV1_TRACE_CAT2(a, b)
+
+#define DRUMKV1_TRACE_SCOPE(name, arg) \
+	const drumkv1_trace::Scope DRUMKV1_TRACE_CAT(drumkv1_trace_, __LINE__)(name, int(arg))
+#define DRUMKV1_TRACE_EVENT(name, arg) \
+	drumkv1_trace::event(name, int(arg))
+#define DRUMKV1_TRACE_OPEN()  drumkv1_trace::open()
+#define DRUMKV1_TRACE_CLOSE() drumkv1_trace::close()
+
+#else	// !CONFIG_TRACE
+
+#define DRUMKV1_TRACE_SCOPE(name, arg)
+#define DRUMKV1_TRACE_EVENT(name, arg)
+#define DRUMKV1_TRACE_OPEN()
+#define DRUMKV1_TRACE_CLOSE()
+
+#endif	// CONFIG_TRACE
+
+
+#endif	// __drumkv1_trace_h
+
+// end of drumkv1_trace.h
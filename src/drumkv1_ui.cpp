@@ -168,6 +168,24 @@ drumkv1_programs *drumkv1_ui::programs (void) const
 }
 
 
+drumkv1_load *drumkv1_ui::load (void) const
+{
+	return m_pDrumk->load();
+}
+
+
+void drumkv1_ui::counters ( drumkv1::Counters& counters ) const
+{
+	m_pDrumk->counters(counters);
+}
+
+
+void drumkv1_ui::resetCounters (void)
+{
+	m_pDrumk->resetCounters();
+}
+
+
 void drumkv1_ui::resetParamValues ( bool bSwap )
 {
 	return m_pDrumk->resetParamValues(bSwap);
@@ -73,6 +73,10 @@ public:
 
 	drumkv1_controls *controls() const;
 	drumkv1_programs *programs() const;
+	drumkv1_load *load() const;
+
+	void counters(drumkv1::Counters& counters) const;
+	void resetCounters();
 
 	void resetParamValues(bool bSwap);
 	void reset();
@@ -20,6 +20,7 @@
 *****************************************************************************/
 
 #include "drumkv1_wave.h"
+#include "drumkv1_trace.h"
 
 #include <cstdlib>
 #include <cmath>
@@ -51,6 +52,8 @@ drumkv1_wave::~drumkv1_wave (void)
 // init.
 void drumkv1_wave::reset ( Shape shape, float width )
 {
+	DRUMKV1_TRACE_SCOPE("wave_reset", shape);
+
 	m_shape = shape;
 	m_width = width;;
 
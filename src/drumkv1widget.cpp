@@ -84,6 +84,10 @@ drumkv1widget::drumkv1widget ( QWidget *pParent )
 	// Init sched notifier.
 	m_sched_notifier = nullptr;
 
+	// Init DSP load meter refresh.
+	m_dsp_load_timer = new QTimer(this);
+	m_dsp_load_timer->setInterval(500);
+
 	// Init swapable params A/B to default.
 	for (uint32_t i = 0; i < drumkv1::NUM_PARAMS; ++i)
 		m_params_ab[i] = drumkv1_param::paramDefaultValue(drumkv1::ParamIndex(i));
@@ -549,6 +553,11 @@ drumkv1widget::drumkv1widget ( QWidget *pParent )
 	QObject::connect(m_ui.TabBar, SIGNAL(currentChanged(int)),
 		m_ui.StackedWidget, SLOT(setCurrentIndex(int)));
 
+	// DSP load meter refresh
+	QObject::connect(m_dsp_load_timer,
+		SIGNAL(timeout()),
+		SLOT(dspLoadTimeout()));
+
 	// Direct status-bar keyboard input
 	QObject::connect(m_ui.StatusBar->keybd(),
 		SIGNAL(noteOnClicked(int, int)),
@@ -614,6 +623,9 @@ void drumkv1widget::openSchedNotifier (void)
 		SLOT(updateSchedNotify(int, int)));
 
 	pDrumkUi->midiInEnabled(true);
+
+	m_dsp_load.reset();
+	m_dsp_load_timer->start();
 }
 
 
@@ -624,6 +636,8 @@ void drumkv1widget::closeSchedNotifier (void)
 		m_sched_notifier = nullptr;
 	}
 
+	m_dsp_load_timer->stop();
+
 	drumkv1_ui *pDrumkUi = ui_instance();
 	if (pDrumkUi)
 		pDrumkUi->midiInEnabled(false);
@@ -968,8 +982,12 @@ void drumkv1widget::swapParams ( bool bOn )
 void drumkv1widget::panic (void)
 {
 	drumkv1_ui *pDrumkUi = ui_instance();
-	if (pDrumkUi)
+	if (pDrumkUi) {
 		pDrumkUi->reset();
+		pDrumkUi->resetCounters();
+	}
+
+	m_dsp_load.reset();
 }
 
 
@@ -1720,6 +1738,12 @@ void drumkv1widget::updateSchedNotify ( int stype, int sid )
 		if (pProg) updateLoadPreset(pProg->name());
 		break;
 	}
+	case drumkv1_sched::State:
+		if (sid > 0)
+			m_ui.StatusBar->showMessage(tr("Loading state: %1%").arg(sid));
+		else
+			m_ui.StatusBar->clearMessage();
+		break;
 	case drumkv1_sched::Sample:
 		if (sid > 0) {
 		//	refreshElements();
@@ -1757,6 +1781,24 @@ void drumkv1widget::midiInLedTimeout (void)
 }
 
 
+// DSP load meter (and runtime counters) refresh.
+void drumkv1widget::dspLoadTimeout (void)
+{
+	drumkv1_ui *pDrumkUi = ui_instance();
+	if (pDrumkUi == nullptr)
+		return;
+
+	pDrumkUi->load()->update(m_dsp_load);
+
+	m_ui.StatusBar->dspLoad(m_dsp_load);
+
+	drumkv1::Counters counters;
+	pDrumkUi->counters(counters);
+
+	m_ui.StatusBar->counters(counters);
+}
+
+
 // Menu actions.
 void drumkv1widget::helpConfigure (void)
 {
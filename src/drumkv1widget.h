@@ -26,6 +26,7 @@
 #include "drumkv1_sched.h"
 
 #include "drumkv1_ui.h"
+#include "drumkv1_load.h"
 
 #include <QWidget>
 
@@ -37,6 +38,7 @@ class drumkv1widget_param;
 class drumkv1widget_sched;
 
 class QGroupBox;
+class QTimer;
 
 
 //-------------------------------------------------------------------------
@@ -155,6 +157,9 @@ protected slots:
 	// MIDI In LED timeout.
 	void midiInLedTimeout();
 
+	// DSP load meter refresh.
+	void dspLoadTimeout();
+
 	// Param knob context menu.
 	void paramContextMenu(const QPoint& pos);
 
@@ -231,6 +236,9 @@ private:
 
 	drumkv1widget_sched *m_sched_notifier;
 
+	QTimer *m_dsp_load_timer;
+	drumkv1_load::Stats m_dsp_load;
+
 	QHash<drumkv1::ParamIndex, drumkv1widget_param *> m_paramKnobs;
 	QHash<drumkv1widget_param *, drumkv1::ParamIndex> m_knobParams;
 
@@ -252,7 +260,11 @@ public:
 
 	// ctor.
 	drumkv1widget_sched(drumkv1 *pDrumk, QObject *pParent = nullptr)
-		: QObject(pParent), m_notifier(pDrumk, this) {}
+		: QObject(pParent), m_notifier(pDrumk, this) { m_notifier.open(); }
+
+	// dtor.
+	~drumkv1widget_sched()
+		{ m_notifier.close(); }
 
 signals:
 
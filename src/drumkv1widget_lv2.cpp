@@ -179,6 +179,11 @@ void drumkv1widget_lv2::closeEvent ( QCloseEvent *pCloseEvent )
 void drumkv1widget_lv2::port_event ( uint32_t port_index,
 	uint32_t buffer_size, uint32_t format, const void *buffer )
 {
+	// param ports only; the DSP load meter and counters are polled directly.
+	if (port_index < drumkv1_lv2::ParamBase ||
+		port_index >= drumkv1_lv2::LoadBase)
+		return;
+
 	if (format == 0 && buffer_size == sizeof(float)) {
 		const drumkv1::ParamIndex index
 			= drumkv1::ParamIndex(port_index - drumkv1_lv2::ParamBase);
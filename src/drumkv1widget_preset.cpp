@@ -22,6 +22,7 @@
 #include "drumkv1widget_preset.h"
 
 #include "drumkv1_config.h"
+#include "drumkv1_bundle.h"
 
 #include <QHBoxLayout>
 
@@ -236,7 +237,8 @@ void drumkv1widget_preset::openPreset (void)
 
 	const QString  sExt(DRUMKV1_TITLE);
 	const QString& sTitle  = tr("Open Preset");
-	const QString& sFilter = tr("Preset files (*.%1)").arg(sExt);
+	const QString& sFilter = tr("Preset files (*.%1 *.%2)")
+		.arg(sExt).arg(drumkv1_bundle::suffix());
 
 	QWidget *pParentWidget = nullptr;
 	QFileDialog::Options options;
@@ -84,6 +84,20 @@ drumkv1widget_status::drumkv1widget_status ( QWidget *pParent )
 	QStatusBar::addPermanentWidget(m_pKeybd);
 
 	const QFontMetrics fm(QStatusBar::font());
+	m_pVoicesLabel = new QLabel();
+	m_pVoicesLabel->setAlignment(Qt::AlignHCenter);
+	m_pVoicesLabel->setMinimumSize(QSize(fm.horizontalAdvance("64/64") + 4, fm.height()));
+	m_pVoicesLabel->setToolTip(tr("Voices"));
+	m_pVoicesLabel->setAutoFillBackground(true);
+	QStatusBar::addPermanentWidget(m_pVoicesLabel);
+
+	m_pDspLoadLabel = new QLabel();
+	m_pDspLoadLabel->setAlignment(Qt::AlignHCenter);
+	m_pDspLoadLabel->setMinimumSize(QSize(fm.horizontalAdvance("DSP 100%") + 4, fm.height()));
+	m_pDspLoadLabel->setToolTip(tr("DSP load"));
+	m_pDspLoadLabel->setAutoFillBackground(true);
+	QStatusBar::addPermanentWidget(m_pDspLoadLabel);
+
 	m_pModifiedLabel = new QLabel();
 	m_pModifiedLabel->setAlignment(Qt::AlignHCenter);
 	m_pModifiedLabel->setMinimumSize(QSize(fm.horizontalAdvance("MOD") + 4, fm.height()));
@@ -132,4 +146,70 @@ void drumkv1widget_status::modified ( bool bModified )
 }
 
 
+void drumkv1widget_status::dspLoad ( const drumkv1_load::Stats& stats )
+{
+	if (stats.cycles < 1) {
+		m_pDspLoadLabel->clear();
+		m_pDspLoadLabel->setToolTip(tr("DSP load"));
+		return;
+	}
+
+	m_pDspLoadLabel->setText(tr("DSP %1%").arg(int(stats.load + 0.5f)));
+
+	// per-stage breakdown and worst-case histogram...
+	static const char *s_stages[drumkv1_load::NumStages] = {
+		QT_TR_NOOP("Voices"),
+		QT_TR_NOOP("Effects"),
+		QT_TR_NOOP("Reverb"),
+		QT_TR_NOOP("Mix-down")
+	};
+
+	QString sToolTip = tr("DSP load: %1% (peak %2%)")
+		.arg(stats.load, 0, 'f', 1).arg(stats.peak, 0, 'f', 1);
+	for (uint32_t i = 0; i < drumkv1_load::NumStages; ++i) {
+		sToolTip += '\n' + tr("%1: %2%")
+			.arg(tr(s_stages[i])).arg(stats.stages[i], 0, 'f', 1);
+	}
+	sToolTip += '\n';
+	for (uint32_t i = 0; i < drumkv1_load::NumBins - 1; ++i) {
+		if (stats.bins[i] > 0) {
+			sToolTip += '\n' + tr("%1-%2%: %3")
+				.arg(i * 10).arg(i * 10 + 10).arg(stats.bins[i]);
+		}
+	}
+	sToolTip += '\n' + tr("Overruns: %1 of %2 cycles")
+		.arg(stats.overruns).arg(stats.cycles);
+
+	m_pDspLoadLabel->setToolTip(sToolTip);
+
+	QPalette pal(QStatusBar::palette());
+	if (stats.overruns > 0)
+		pal.setColor(QPalette::WindowText, Qt::red);
+	m_pDspLoadLabel->setPalette(pal);
+}
+
+
+void drumkv1widget_status::counters ( const drumkv1::Counters& counters )
+{
+	m_pVoicesLabel->setText(QString("%1/%2")
+		.arg(counters.voices).arg(counters.peak_voices));
+
+	QString sToolTip = tr("Voices: %1 (peak %2)")
+		.arg(counters.voices).arg(counters.peak_voices);
+	sToolTip += '\n' + tr("Dropped notes: %1").arg(counters.alloc_failures);
+	sToolTip += '\n' + tr("Group choke cuts: %1").arg(counters.choke_cuts);
+	sToolTip += '\n' + tr("Retrigger releases: %1").arg(counters.fast_releases);
+	sToolTip += '\n' + tr("Controller events: %1").arg(counters.cc_events);
+	sToolTip += '\n' + tr("Channel filtered: %1").arg(counters.filtered);
+	sToolTip += '\n' + tr("Overruns: %1").arg(counters.overruns);
+
+	m_pVoicesLabel->setToolTip(sToolTip);
+
+	QPalette pal(QStatusBar::palette());
+	if (counters.alloc_failures > 0)
+		pal.setColor(QPalette::WindowText, Qt::red);
+	m_pVoicesLabel->setPalette(pal);
+}
+
+
 // end of drumkv1widget_status.cpp
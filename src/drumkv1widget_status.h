@@ -22,6 +22,9 @@
 #ifndef __drumkv1widget_status_h
 #define __drumkv1widget_status_h
 
+#include "drumkv1.h"
+#include "drumkv1_load.h"
+
 #include <QStatusBar>
 
 
@@ -54,6 +57,9 @@ public:
 	void midiInNote(int iNote, int iVelocity);
 	void modified(bool bModified);
 
+	void dspLoad(const drumkv1_load::Stats& stats);
+	void counters(const drumkv1::Counters& counters);
+
 private:
 
 	// Permanent widgets.
@@ -61,6 +67,8 @@ private:
 
 	QLabel *m_pMidiInLedLabel;
 	QLabel *m_pModifiedLabel;
+	QLabel *m_pDspLoadLabel;
+	QLabel *m_pVoicesLabel;
 
 	drumkv1widget_keybd *m_pKeybd;
 };